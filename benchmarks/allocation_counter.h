@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Global 'operator new' and 'operator delete' are replaced here to count heap usage.
+ * Every block is prefixed with its size, so memory benchmarks can report
+ * how many bytes a structure really takes, smart pointer control blocks included.
+ * Counter is thread local, because benchmarks run in separate threads.
+ */
+namespace allocation_counter {
+/// Size of the block prefix, keeps default new alignment for the returned memory
+constexpr size_t kHeaderSize = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+/// Bytes allocated by the current thread and not released yet
+inline thread_local int64_t allocated_bytes = 0;
+
+/**
+ * @return Bytes allocated by the current thread and not released yet
+ */
+inline int64_t AllocatedBytes() {
+    return allocated_bytes;
+}
+}  // namespace allocation_counter
+
+void* operator new(size_t size) {
+    auto* block = static_cast<unsigned char*>(std::malloc(size + allocation_counter::kHeaderSize));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    allocation_counter::allocated_bytes += size;
+    return block + allocation_counter::kHeaderSize;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+    auto* block = static_cast<unsigned char*>(pointer) - allocation_counter::kHeaderSize;
+    allocation_counter::allocated_bytes -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
@@ -1,530 +1,1495 @@
-#pragma once
-#include <algorithm>
-#include <chrono>
-#include <fstream>
-#include <ostream>
-#include <random>
-#include <vector>
-
-#include "../trees/abstract_tree.h"
-#include "../trees/avl_tree.h"
-#include "../trees/cartesian_tree.h"
-#include "../trees/rb_tree.h"
-#include "../trees/skip_list.h"
-#include "../trees/splay_tree.h"
-#include "../trees/stdlib_set.h"
-
-/// Nanoseconds to milliseconds
-#define nanoMultiplier 1e-6
-
-/// All types of trees
-enum class ImplType { kAVL, kCartesian, kRB, kSkipList, kSplay, kSet };
-
-/**
- * Makes a tree of given type and returns a shared pointer on it
- * @tparam T Tree value type
- * @tparam Types Types of constructor parameters
- * @param type Type of tree to make
- * @param params Parameters for tree constructor
- * @return shared pointer on a new tree
- */
-template <class T, class... Types>
-std::shared_ptr<ITree<T>> MakeTree(ImplType type, Types... params) {
-    if (type == ImplType::kAVL) {
-        return std::make_shared<AVLTree<T>>(params...);
-    } else if (type == ImplType::kCartesian) {
-        return std::make_shared<CartesianTree<T>>(params...);
-    } else if (type == ImplType::kRB) {
-        return std::make_shared<RBTree<T>>(params...);
-    } else if (type == ImplType::kSkipList) {
-        return std::make_shared<SkipList<T>>(params...);
-    } else if (type == ImplType::kSplay) {
-        return std::make_shared<SplayTree<T>>(params...);
-    } else if (type == ImplType::kSet) {
-        return std::make_shared<StdlibSet<T>>(params...);
-    } else {
-        throw std::runtime_error("Impossible behaviour");
-    }
-}
-
-/**
- * All functions below are same
- *
- * Benchmark
- * @param type Type of tree to check
- * @param gen Mersenne Twister generator
- * @param op_count Number of operations to do
- * @return Operating time in milliseconds
- */
-double IncreasingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(i);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double DecreasingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(-i);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double ConvergingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i<op_count>> 1u; ++i) {
-        tree->insert(i);
-        tree->insert(op_count - i - 1);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double DivergingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = op_count >> 1u; i < op_count; ++i) {
-        tree->insert(i);
-        tree->insert(op_count - i - 1);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomSparseIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(dist(gen));
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomDenseIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(0ul, op_count / 5);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(dist(gen));
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomSparseStringsInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<std::string>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::ifstream fin("../experiments/some_text.txt");
-    std::string text;
-    getline(fin, text);
-    fin.close();
-    std::vector<std::string> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(text + std::to_string(dist(gen)));
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomDenseStringsInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<std::string>(type);
-    std::uniform_int_distribution dist(0ul, op_count / 5);
-    std::ifstream fin("../experiments/some_text.txt");
-    std::string text;
-    getline(fin, text);
-    fin.close();
-    std::vector<std::string> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(text + std::to_string(dist(gen)));
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double IncreasingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
-                                                           uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(i);
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(i);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double DecreasingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
-                                                           uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(i);
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = op_count - 1; i > 0; --i) {
-        tree->erase(i);
-    }
-    tree->erase(0);
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double ConvergingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
-                                                           uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(i);
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i<op_count>> 1u; ++i) {
-        tree->erase(i);
-        tree->erase(op_count - i - 1);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double DivergingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
-                                                          uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(i);
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = op_count >> 1u; i < op_count; ++i) {
-        tree->erase(i);
-        tree->erase(op_count - i - 1);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double NonexistentIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
-                                                            uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    for (uint64_t i = 0; i < op_count << 1u; i += 2) {
-        tree->insert(i);
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 1; i < op_count << 1u; i += 2) {
-        tree->erase(i);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
-                                                       uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(i);
-        elements.emplace_back(i);
-    }
-    std::shuffle(elements.begin(), elements.end(), gen);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double IncreasingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
-                                                             uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(dist(gen));
-        tree->insert(elements.back());
-    }
-    std::sort(elements.begin(), elements.end());
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double DecreasingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
-                                                             uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(dist(gen));
-        tree->insert(elements.back());
-    }
-    std::sort(elements.rbegin(), elements.rend());
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double ConvergingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
-                                                             uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(dist(gen));
-        tree->insert(elements.back());
-    }
-    std::sort(elements.begin(), elements.end());
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i<op_count>> 1u; ++i) {
-        tree->erase(elements[i]);
-        tree->erase(elements[op_count - i - 1]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double DivergingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
-                                                            uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(dist(gen));
-        tree->insert(elements.back());
-    }
-    std::sort(elements.begin(), elements.end());
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = op_count >> 1u; i < op_count; ++i) {
-        tree->erase(elements[i]);
-        tree->erase(elements[op_count - i - 1]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double NonexistentIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
-                                                              uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(dist(gen));
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(dist(gen));
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
-                                                         uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(dist(gen));
-        tree->insert(elements.back());
-    }
-    std::shuffle(elements.begin(), elements.end(), gen);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomStringsEraseAfterRandomInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<std::string>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::ifstream fin("../experiments/some_text.txt");
-    std::string text;
-    getline(fin, text);
-    fin.close();
-    std::vector<std::string> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(text + std::to_string(dist(gen)));
-        tree->insert(elements.back());
-    }
-    std::shuffle(elements.begin(), elements.end(), gen);
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(elements[i]);
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double NonexistentStringsEraseAfterRandomInsert(ImplType type, std::mt19937& gen,
-                                                uint64_t op_count) {
-    auto tree = MakeTree<std::string>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::ifstream fin("../experiments/some_text.txt");
-    std::string text;
-    getline(fin, text);
-    fin.close();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(text + std::to_string(dist(gen)));
-    }
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->erase(text + std::to_string(dist(gen)));
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double RandomInsertAndEraseIntAlternation(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    if (op_count < 10) {
-        return 0.0;
-    }
-    uint64_t step = op_count / 10;
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(0, static_cast<int>(3 * step));
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < step << 1u; ++i) {
-        tree->insert(dist(gen));
-    }
-    for (uint64_t i = 0; i < step; ++i) {
-        tree->erase(dist(gen));
-    }
-    for (uint64_t i = 0; i < step << 1u; ++i) {
-        tree->insert(dist(gen));
-    }
-    for (uint64_t i = 0; i < step << 1u; ++i) {
-        tree->erase(dist(gen));
-    }
-    for (uint64_t i = 0; i < step; ++i) {
-        tree->insert(dist(gen));
-    }
-    for (uint64_t i = 0; i < step << 1u; ++i) {
-        tree->erase(dist(gen));
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double FindIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    std::vector<int> elements;
-    for (uint64_t i = 0; i < op_count; ++i) {
-        elements.emplace_back(dist(gen));
-        tree->insert(elements.back());
-    }
-    std::shuffle(elements.begin(), elements.end(), gen);
-    // We use counter, so that compiler doesn't apply optimizations
-    int counter = 0;
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        auto it = tree->find(elements[i]);
-        if (it != tree->end()) {
-            counter += *it;
-        }
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    elements.emplace_back(counter);
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double FindRandomSparseIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen,
-                                                  uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(dist(gen));
-    }
-    // We use counter, so that compiler doesn't apply optimizations
-    int counter = 0;
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        auto it = tree->find(dist(gen));
-        if (it != tree->end()) {
-            counter += *it;
-        }
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    std::vector<int> useless(1, counter);
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
-
-double LowerBoundRandomSparseIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen,
-                                                        uint64_t op_count) {
-    auto tree = MakeTree<int>(type);
-    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
-                                       std::numeric_limits<int>::max());
-    for (uint64_t i = 0; i < op_count; ++i) {
-        tree->insert(dist(gen));
-    }
-    // We use counter, so that compiler doesn't apply optimizations
-    int counter = 0;
-    auto begin = std::chrono::high_resolution_clock::now();
-    for (uint64_t i = 0; i < op_count; ++i) {
-        auto it = tree->lower_bound(dist(gen));
-        if (it != tree->end()) {
-            counter += *it;
-        }
-    }
-    auto end = std::chrono::high_resolution_clock::now();
-    std::vector<int> useless(1, counter);
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
-           nanoMultiplier;
-}
\ No newline at end of file
+#pragma once
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "allocation_counter.h"
+
+#include "../trees/abstract_tree.h"
+#include "../trees/art_set.h"
+#include "../trees/avl_tree.h"
+#include "../trees/cartesian_tree.h"
+#include "../trees/durable_tree.h"
+#include "../trees/filtered_tree.h"
+#include "../trees/flat_set.h"
+#include "../trees/lsm_set.h"
+#include "../trees/frozen_tree.h"
+#include "../trees/mapped_tree.h"
+#include "../trees/mvcc_tree.h"
+#include "../trees/persistent_treap.h"
+#include "../trees/rb_tree.h"
+#include "../trees/scapegoat_tree.h"
+#include "../trees/serialization.h"
+#include "../trees/skip_list.h"
+#include "../trees/splay_tree.h"
+#include "../trees/stdlib_set.h"
+#include "../trees/veb_set.h"
+#include "../trees/wavl_tree.h"
+
+/// Nanoseconds to milliseconds
+#define nanoMultiplier 1e-6
+
+/// All types of trees
+enum class ImplType {
+    kART,
+    kAVL,
+    kCartesian,
+    kFlat,
+    kLSM,
+    kPersistent,
+    kRB,
+    kScapegoat,
+    kScapegoatTight,
+    kSkipList,
+    kSkipListQuarter,
+    kSkipListInvE,
+    kSplay,
+    kSplayTopDown,
+    kSplayReadEvery8th,
+    kSplayReadRandom,
+    kSplayReadDeep,
+    kSplayReadNever,
+    kVEB,
+    kWAVL,
+    kSet
+};
+
+/// Number of elements configured structures (e.g. skip list height cap) are tuned for
+constexpr size_t kExpectedSize = 1'000'000;
+
+/// Skew of Zipfian query streams
+constexpr double kZipfianSkew = 0.99;
+
+/**
+ * Constructor parameters, which are a single tree to copy
+ * @tparam T Tree value type
+ * @tparam Types Types of constructor parameters
+ */
+template <class T, class... Types>
+struct IsTreeCopy : std::is_same<std::tuple<std::decay_t<Types>...>,
+                                 std::tuple<std::shared_ptr<ITree<T>>>> {};
+
+/**
+ * Makes an empty skip list with the given promotion probability
+ * and the height cap tuned for 'kExpectedSize' elements
+ * @tparam T Tree value type
+ * @tparam Types Types of constructor parameters
+ * @param probability Probability of promoting a tower to the next level
+ * @param params Parameters for tree constructor, must be empty or a skip list to copy
+ * @return Shared pointer on a new tree
+ */
+template <class T, class... Types>
+std::shared_ptr<ITree<T>> MakeSkipList(double probability, Types... params) {
+    if constexpr (sizeof...(Types) == 0) {
+        return std::make_shared<SkipList<T>>(
+            probability, SkipList<T>::MaxLevelFor(probability, kExpectedSize));
+    } else if constexpr (IsTreeCopy<T, Types...>::value) {
+        // Copies keep the configuration of the original
+        return std::make_shared<SkipList<T>>(params...);
+    } else {
+        throw std::runtime_error("Configured skip lists are only made empty or copied");
+    }
+}
+
+/**
+ * Makes an empty scapegoat tree with the given balance
+ * @tparam T Tree value type
+ * @tparam Types Types of constructor parameters
+ * @param alpha Largest allowed share of a child subtree in its parent subtree
+ * @param params Parameters for tree constructor, must be empty or a scapegoat tree to copy
+ * @return Shared pointer on a new tree
+ */
+template <class T, class... Types>
+std::shared_ptr<ITree<T>> MakeScapegoatTree(double alpha, Types... params) {
+    if constexpr (sizeof...(Types) == 0) {
+        return std::make_shared<ScapegoatTree<T>>(alpha);
+    } else if constexpr (IsTreeCopy<T, Types...>::value) {
+        // Copies keep the balance of the original
+        return std::make_shared<ScapegoatTree<T>>(params...);
+    } else {
+        throw std::runtime_error("Configured scapegoat trees are only made empty or copied");
+    }
+}
+
+/**
+ * Makes a splay tree with the given read policy
+ * @tparam T Tree value type
+ * @tparam Types Types of constructor parameters
+ * @param policy When lookups splay
+ * @param parameter Parameter of the policy
+ * @param params Parameters for tree constructor
+ * @return Shared pointer on a new tree
+ */
+template <class T, class... Types>
+std::shared_ptr<ITree<T>> MakeSplayTree(typename SplayTree<T>::ReadSplayPolicy policy,
+                                        double parameter, Types... params) {
+    auto tree = std::make_shared<SplayTree<T>>(params...);
+    tree->SetReadSplayPolicy(policy, parameter);
+    return tree;
+}
+
+/**
+ * Makes a tree of given type and returns a shared pointer on it
+ * @tparam T Tree value type
+ * @tparam Types Types of constructor parameters
+ * @param type Type of tree to make
+ * @param params Parameters for tree constructor
+ * @return shared pointer on a new tree
+ */
+template <class T, class... Types>
+std::shared_ptr<ITree<T>> MakeTree(ImplType type, Types... params) {
+    if (type == ImplType::kART) {
+        return std::make_shared<ARTSet<T>>(params...);
+    } else if (type == ImplType::kAVL) {
+        return std::make_shared<AVLTree<T>>(params...);
+    } else if (type == ImplType::kCartesian) {
+        return std::make_shared<CartesianTree<T>>(params...);
+    } else if (type == ImplType::kFlat) {
+        return std::make_shared<FlatSet<T>>(params...);
+    } else if (type == ImplType::kLSM) {
+        return std::make_shared<LSMSet<T>>(params...);
+    } else if (type == ImplType::kPersistent) {
+        return std::make_shared<PersistentTreap<T>>(params...);
+    } else if (type == ImplType::kRB) {
+        return std::make_shared<RBTree<T>>(params...);
+    } else if (type == ImplType::kScapegoat) {
+        return std::make_shared<ScapegoatTree<T>>(params...);
+    } else if (type == ImplType::kScapegoatTight) {
+        return MakeScapegoatTree<T>(0.6, params...);
+    } else if (type == ImplType::kSkipList) {
+        return std::make_shared<SkipList<T>>(params...);
+    } else if (type == ImplType::kSkipListQuarter) {
+        return MakeSkipList<T>(0.25, params...);
+    } else if (type == ImplType::kSkipListInvE) {
+        return MakeSkipList<T>(std::exp(-1.0), params...);
+    } else if (type == ImplType::kSplay) {
+        return std::make_shared<SplayTree<T>>(params...);
+    } else if (type == ImplType::kSplayTopDown) {
+        auto tree = std::make_shared<SplayTree<T>>(params...);
+        tree->SetSplayMode(SplayTree<T>::SplayMode::kTopDown);
+        return tree;
+    } else if (type == ImplType::kSplayReadEvery8th) {
+        return MakeSplayTree<T>(SplayTree<T>::ReadSplayPolicy::kEveryKth, 8, params...);
+    } else if (type == ImplType::kSplayReadRandom) {
+        return MakeSplayTree<T>(SplayTree<T>::ReadSplayPolicy::kRandom, 0.125, params...);
+    } else if (type == ImplType::kSplayReadDeep) {
+        // About twice the height of a balanced tree with 'kExpectedSize' elements
+        return MakeSplayTree<T>(SplayTree<T>::ReadSplayPolicy::kDeep, 40, params...);
+    } else if (type == ImplType::kSplayReadNever) {
+        return MakeSplayTree<T>(SplayTree<T>::ReadSplayPolicy::kNever, 0, params...);
+    } else if (type == ImplType::kVEB) {
+        if constexpr (IsVEBKey<T>::value) {
+            return std::make_shared<VEBSet<T>>(params...);
+        } else {
+            throw std::invalid_argument("Van Emde Boas tree stores only integers");
+        }
+    } else if (type == ImplType::kWAVL) {
+        return std::make_shared<WAVLTree<T>>(params...);
+    } else if (type == ImplType::kSet) {
+        return std::make_shared<StdlibSet<T>>(params...);
+    } else {
+        throw std::runtime_error("Impossible behaviour");
+    }
+}
+
+/**
+ * Some trees store only particular value types (e.g. the van Emde Boas tree needs integers).
+ * Benchmarks on other value types report NaN for them, so the other trees are still measured
+ * @tparam T Tree value type
+ * @param type Type of tree
+ * @return True if the tree of given type can store values of type T
+ */
+template <class T>
+bool IsSupported(ImplType type) {
+    return type != ImplType::kVEB || IsVEBKey<T>::value;
+}
+
+/**
+ * All functions below are same
+ *
+ * Benchmark
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of operations to do
+ * @return Operating time in milliseconds
+ */
+double IncreasingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double DecreasingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(-i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double ConvergingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i<op_count>> 1u; ++i) {
+        tree->insert(i);
+        tree->insert(op_count - i - 1);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double DivergingIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = op_count >> 1u; i < op_count; ++i) {
+        tree->insert(i);
+        tree->insert(op_count - i - 1);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomSparseIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomDenseIntSeriesInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(0ul, op_count / 5);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomSparseStringsInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    if (!IsSupported<std::string>(type)) {
+        return std::nan("");
+    }
+    auto tree = MakeTree<std::string>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::ifstream fin("../experiments/some_text.txt");
+    std::string text;
+    getline(fin, text);
+    fin.close();
+    std::vector<std::string> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(text + std::to_string(dist(gen)));
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomDenseStringsInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    if (!IsSupported<std::string>(type)) {
+        return std::nan("");
+    }
+    auto tree = MakeTree<std::string>(type);
+    std::uniform_int_distribution dist(0ul, op_count / 5);
+    std::ifstream fin("../experiments/some_text.txt");
+    std::string text;
+    getline(fin, text);
+    fin.close();
+    std::vector<std::string> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(text + std::to_string(dist(gen)));
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double IncreasingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
+                                                           uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(i);
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double DecreasingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
+                                                           uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(i);
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = op_count - 1; i > 0; --i) {
+        tree->erase(i);
+    }
+    tree->erase(0);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double ConvergingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
+                                                           uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(i);
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i<op_count>> 1u; ++i) {
+        tree->erase(i);
+        tree->erase(op_count - i - 1);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double DivergingIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
+                                                          uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(i);
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = op_count >> 1u; i < op_count; ++i) {
+        tree->erase(i);
+        tree->erase(op_count - i - 1);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double NonexistentIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
+                                                            uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    for (uint64_t i = 0; i < op_count << 1u; i += 2) {
+        tree->insert(i);
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 1; i < op_count << 1u; i += 2) {
+        tree->erase(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomIntSeriesEraseAfterIncreasingSeriesInsert(ImplType type, std::mt19937& gen,
+                                                       uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(i);
+        elements.emplace_back(i);
+    }
+    std::shuffle(elements.begin(), elements.end(), gen);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double IncreasingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
+                                                             uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(dist(gen));
+        tree->insert(elements.back());
+    }
+    std::sort(elements.begin(), elements.end());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double DecreasingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
+                                                             uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(dist(gen));
+        tree->insert(elements.back());
+    }
+    std::sort(elements.rbegin(), elements.rend());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double ConvergingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
+                                                             uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(dist(gen));
+        tree->insert(elements.back());
+    }
+    std::sort(elements.begin(), elements.end());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i<op_count>> 1u; ++i) {
+        tree->erase(elements[i]);
+        tree->erase(elements[op_count - i - 1]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double DivergingIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
+                                                            uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(dist(gen));
+        tree->insert(elements.back());
+    }
+    std::sort(elements.begin(), elements.end());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = op_count >> 1u; i < op_count; ++i) {
+        tree->erase(elements[i]);
+        tree->erase(elements[op_count - i - 1]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double NonexistentIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
+                                                              uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(dist(gen));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomIntSeriesEraseAfterRandomSparseSeriesInsert(ImplType type, std::mt19937& gen,
+                                                         uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(dist(gen));
+        tree->insert(elements.back());
+    }
+    std::shuffle(elements.begin(), elements.end(), gen);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomStringsEraseAfterRandomInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    if (!IsSupported<std::string>(type)) {
+        return std::nan("");
+    }
+    auto tree = MakeTree<std::string>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::ifstream fin("../experiments/some_text.txt");
+    std::string text;
+    getline(fin, text);
+    fin.close();
+    std::vector<std::string> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(text + std::to_string(dist(gen)));
+        tree->insert(elements.back());
+    }
+    std::shuffle(elements.begin(), elements.end(), gen);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(elements[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double NonexistentStringsEraseAfterRandomInsert(ImplType type, std::mt19937& gen,
+                                                uint64_t op_count) {
+    if (!IsSupported<std::string>(type)) {
+        return std::nan("");
+    }
+    auto tree = MakeTree<std::string>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::ifstream fin("../experiments/some_text.txt");
+    std::string text;
+    getline(fin, text);
+    fin.close();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(text + std::to_string(dist(gen)));
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->erase(text + std::to_string(dist(gen)));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double RandomInsertAndEraseIntAlternation(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    if (op_count < 10) {
+        return 0.0;
+    }
+    uint64_t step = op_count / 10;
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(0, static_cast<int>(3 * step));
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < step << 1u; ++i) {
+        tree->insert(dist(gen));
+    }
+    for (uint64_t i = 0; i < step; ++i) {
+        tree->erase(dist(gen));
+    }
+    for (uint64_t i = 0; i < step << 1u; ++i) {
+        tree->insert(dist(gen));
+    }
+    for (uint64_t i = 0; i < step << 1u; ++i) {
+        tree->erase(dist(gen));
+    }
+    for (uint64_t i = 0; i < step; ++i) {
+        tree->insert(dist(gen));
+    }
+    for (uint64_t i = 0; i < step << 1u; ++i) {
+        tree->erase(dist(gen));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double FindIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> elements;
+    for (uint64_t i = 0; i < op_count; ++i) {
+        elements.emplace_back(dist(gen));
+        tree->insert(elements.back());
+    }
+    std::shuffle(elements.begin(), elements.end(), gen);
+    // We use counter, so that compiler doesn't apply optimizations
+    int counter = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        auto it = tree->find(elements[i]);
+        if (it != tree->end()) {
+            counter += *it;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    elements.emplace_back(counter);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double FindRandomSparseIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen,
+                                                  uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    // We use counter, so that compiler doesn't apply optimizations
+    int counter = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        auto it = tree->find(dist(gen));
+        if (it != tree->end()) {
+            counter += *it;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::vector<int> useless(1, counter);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double LowerBoundRandomSparseIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen,
+                                                        uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    // We use counter, so that compiler doesn't apply optimizations
+    int counter = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        auto it = tree->lower_bound(dist(gen));
+        if (it != tree->end()) {
+            counter += *it;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::vector<int> useless(1, counter);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * Generates indices in [0, size) with uniform distribution
+ * @param gen Mersenne Twister generator
+ * @param size Number of distinct indices, also the number of indices to generate
+ * @return Generated indices
+ */
+std::vector<uint64_t> UniformIndices(std::mt19937& gen, uint64_t size) {
+    std::uniform_int_distribution<uint64_t> dist(0, size - 1);
+    std::vector<uint64_t> result(size);
+    for (auto& index : result) {
+        index = dist(gen);
+    }
+    return result;
+}
+
+/**
+ * Generates indices in [0, size) with Zipfian distribution: index i is drawn
+ * with probability proportional to 1 / (i + 1)^skew
+ * @param gen Mersenne Twister generator
+ * @param size Number of distinct indices
+ * @param count Number of indices to generate
+ * @return Generated indices
+ */
+std::vector<uint64_t> ZipfianIndices(std::mt19937& gen, uint64_t size, uint64_t count) {
+    std::vector<double> cdf(size);
+    double sum = 0;
+    for (uint64_t i = 0; i < size; ++i) {
+        sum += std::pow(static_cast<double>(i + 1), -kZipfianSkew);
+        cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<uint64_t> result(count);
+    for (auto& index : result) {
+        index = std::lower_bound(cdf.begin(), cdf.end(), dist(gen)) - cdf.begin();
+        index = std::min(index, size - 1);
+    }
+    return result;
+}
+
+/**
+ * Looks up stored keys by the given indices
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert and lookups to do
+ * @param indices Function, which makes indices of keys to look up
+ * @param frozen Whether to look up in the frozen snapshot of the tree instead of the tree itself
+ * @return Operating time in milliseconds
+ */
+template <class IndexGenerator>
+double FindStoredInt(ImplType type, std::mt19937& gen, uint64_t op_count, IndexGenerator indices,
+                     bool frozen = false) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> keys(op_count);
+    for (auto& key : keys) {
+        key = dist(gen);
+        tree->insert(key);
+    }
+    if (frozen) {
+        tree = std::make_shared<FrozenTree<int>>(*tree);
+    }
+    std::vector<int> queries;
+    queries.reserve(op_count);
+    for (uint64_t index : indices(gen, op_count)) {
+        queries.emplace_back(keys[index]);
+    }
+    // We use counter, so that compiler doesn't apply optimizations
+    int counter = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int query : queries) {
+        auto it = tree->find(query);
+        if (it != tree->end()) {
+            counter += *it;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::vector<int> useless(1, counter);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+double FindUniformStoredIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen,
+                                                   uint64_t op_count) {
+    return FindStoredInt(type, gen, op_count, UniformIndices);
+}
+
+double FindZipfianStoredIntAfterRandomSparseInsert(ImplType type, std::mt19937& gen,
+                                                   uint64_t op_count) {
+    return FindStoredInt(type, gen, op_count, [](std::mt19937& gen, uint64_t size) {
+        return ZipfianIndices(gen, size, size);
+    });
+}
+
+/**
+ * Same as FindUniformStoredIntAfterRandomSparseInsert, but the lookups go to the frozen
+ * snapshot of the tree in van Emde Boas layout, so the result doesn't depend on the type
+ * of the live tree
+ */
+double FindUniformStoredIntInFrozenTree(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindStoredInt(type, gen, op_count, UniformIndices, true);
+}
+
+/**
+ * Same as LowerBoundRandomSparseIntAfterRandomSparseInsert on the frozen snapshot of the tree
+ */
+double LowerBoundRandomSparseIntInFrozenTree(ImplType type, std::mt19937& gen,
+                                             uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    FrozenTree<int> frozen(*tree);
+    tree.reset();
+    // We use counter, so that compiler doesn't apply optimizations
+    int counter = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        auto it = frozen.lower_bound(dist(gen));
+        if (it != frozen.end()) {
+            counter += *it;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::vector<int> useless(1, counter);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * Looks up keys, given share of which isn't stored: stored keys are even, absent ones are odd
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert and lookups to do
+ * @param miss_ratio Share of lookups for absent keys
+ * @param filtered Whether to put a Bloom filter in front of the tree
+ * @return Operating time in milliseconds
+ */
+double FindIntWithMisses(ImplType type, std::mt19937& gen, uint64_t op_count, double miss_ratio,
+                         bool filtered) {
+    std::shared_ptr<ITree<int>> tree;
+    if (filtered) {
+        tree = std::make_shared<FilteredTree<int>>([type] { return MakeTree<int>(type); });
+    } else {
+        tree = MakeTree<int>(type);
+    }
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> keys(op_count);
+    for (auto& key : keys) {
+        key = dist(gen) & ~1;
+        tree->insert(key);
+    }
+    std::bernoulli_distribution miss(miss_ratio);
+    std::uniform_int_distribution<uint64_t> index(0, op_count - 1);
+    std::vector<int> queries;
+    queries.reserve(op_count);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        queries.emplace_back(miss(gen) ? dist(gen) | 1 : keys[index(gen)]);
+    }
+    // We use counter, so that compiler doesn't apply optimizations
+    int counter = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int query : queries) {
+        auto it = tree->find(query);
+        if (it != tree->end()) {
+            counter += *it;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::vector<int> useless(1, counter);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * All functions below are same
+ *
+ * Miss ratio sweep of FindIntWithMisses without and with a Bloom filter
+ */
+double FindIntWith50PercentMisses(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindIntWithMisses(type, gen, op_count, 0.5, false);
+}
+
+double FindIntWith90PercentMisses(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindIntWithMisses(type, gen, op_count, 0.9, false);
+}
+
+double FindIntWith99PercentMisses(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindIntWithMisses(type, gen, op_count, 0.99, false);
+}
+
+double FindIntWith50PercentMissesFiltered(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindIntWithMisses(type, gen, op_count, 0.5, true);
+}
+
+double FindIntWith90PercentMissesFiltered(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindIntWithMisses(type, gen, op_count, 0.9, true);
+}
+
+double FindIntWith99PercentMissesFiltered(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    return FindIntWithMisses(type, gen, op_count, 0.99, true);
+}
+
+/**
+ * Inserts into an LSM set, whose memtable is a tree of the given type
+ * @param type Type of the memtable
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @return Operating time in milliseconds
+ */
+double RandomSparseIntInsertIntoLSM(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    LSMSet<int> tree([type] { return MakeTree<int>(type); });
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree.insert(dist(gen));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * Read amplification of an LSM set: half of the lookups are for stored keys,
+ * half are for random ones
+ * @param type Type of the memtable
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert and lookups to do
+ * @param bloom_bits Bloom filter bits per key
+ * @return Average number of sorted runs searched by a lookup instead of operating time
+ */
+double RunsProbedPerLSMLookup(ImplType type, std::mt19937& gen, uint64_t op_count,
+                              size_t bloom_bits) {
+    LSMSet<int> tree([type] { return MakeTree<int>(type); }, LSMSet<int>::kDefaultMemtableLimit,
+                     bloom_bits);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> keys(op_count);
+    for (auto& key : keys) {
+        key = dist(gen);
+        tree.insert(key);
+    }
+    uint64_t before = tree.RunProbes();
+    std::uniform_int_distribution<uint64_t> index(0, op_count - 1);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree.find(i % 2 ? keys[index(gen)] : dist(gen));
+    }
+    return op_count ? static_cast<double>(tree.RunProbes() - before) / op_count : 0.0;
+}
+
+double RunsProbedPerRandomSparseIntLookupInLSM(ImplType type, std::mt19937& gen,
+                                               uint64_t op_count) {
+    return RunsProbedPerLSMLookup(type, gen, op_count, LSMSet<int>::kDefaultBloomBits);
+}
+
+double RunsProbedPerRandomSparseIntLookupInLSMWithoutBloom(ImplType type, std::mt19937& gen,
+                                                           uint64_t op_count) {
+    return RunsProbedPerLSMLookup(type, gen, op_count, 0);
+}
+
+/// Number of snapshots a reader takes while the tree is filled
+constexpr uint64_t kSnapshotCount = 32;
+
+/**
+ * Update throughput under snapshots: a reader copies the tree every 'op_count / kSnapshotCount'
+ * inserts and keeps the latest copy. Copies of persistent treaps are O(1) snapshots,
+ * other trees run their full copy constructors
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @return Operating time in milliseconds
+ */
+double RandomSparseIntInsertWithSnapshots(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    auto tree = MakeTree<int>(type);
+    std::shared_ptr<ITree<int>> snapshot;
+    uint64_t period = std::max<uint64_t>(1, op_count / kSnapshotCount);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 1; i <= op_count; ++i) {
+        tree->insert(dist(gen));
+        if (i % period == 0) {
+            snapshot = MakeTree<int>(type, tree);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * Writer throughput under readers: reader threads scan snapshots of an MVCC tree
+ * over and over, while the writer inserts keys and publishes 'kSnapshotCount' times
+ * @tparam Tree Type of the tree inside the MVCC wrapper
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @param reader_count Number of scanning threads
+ * @return Operating time of the writer in milliseconds
+ */
+template <class Tree>
+double InsertIntoMVCCWithScanningReaders(std::mt19937& gen, uint64_t op_count,
+                                         int reader_count) {
+    MVCCTree<int, Tree> tree(std::max<uint64_t>(1, op_count / kSnapshotCount));
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < reader_count; ++i) {
+        readers.emplace_back([&tree, &done] {
+            int64_t sum = 0;
+            while (!done) {
+                auto snapshot = tree.Snapshot();
+                for (auto it = snapshot->begin(); it != snapshot->end() && !done; ++it) {
+                    sum += *it;
+                }
+            }
+            return sum;
+        });
+    }
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree.insert(dist(gen));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * MVCC wrapper is measured around AVL and Red-Black trees, which publish full copies,
+ * and around the persistent treap, which publishes O(1) snapshots. Other types report NaN
+ * @param type Type of the tree inside the MVCC wrapper
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @param reader_count Number of scanning threads
+ * @return Operating time of the writer in milliseconds
+ */
+double RandomSparseIntInsertWithScanningReaders(ImplType type, std::mt19937& gen,
+                                                uint64_t op_count, int reader_count) {
+    if (type == ImplType::kAVL) {
+        return InsertIntoMVCCWithScanningReaders<AVLTree<int>>(gen, op_count, reader_count);
+    } else if (type == ImplType::kRB) {
+        return InsertIntoMVCCWithScanningReaders<RBTree<int>>(gen, op_count, reader_count);
+    } else if (type == ImplType::kPersistent) {
+        return InsertIntoMVCCWithScanningReaders<PersistentTreap<int>>(gen, op_count,
+                                                                       reader_count);
+    }
+    return std::nan("");
+}
+
+double RandomSparseIntInsertWith1ScanningReader(ImplType type, std::mt19937& gen,
+                                                uint64_t op_count) {
+    return RandomSparseIntInsertWithScanningReaders(type, gen, op_count, 1);
+}
+
+double RandomSparseIntInsertWith4ScanningReaders(ImplType type, std::mt19937& gen,
+                                                 uint64_t op_count) {
+    return RandomSparseIntInsertWithScanningReaders(type, gen, op_count, 4);
+}
+
+/**
+ * Throughput of saving a tree to a string stream or of loading it back into an empty one
+ * @tparam T Tree value type
+ * @tparam ValueGenerator Functor type, which makes random values
+ * @param type Type of tree to check
+ * @param op_count Number of elements in the tree
+ * @param next_value Makes random values
+ * @param load Whether loading is measured instead of saving
+ * @return Megabytes per second instead of operating time
+ */
+template <class T, class ValueGenerator>
+double SaveOrLoadThroughput(ImplType type, uint64_t op_count, ValueGenerator next_value,
+                            bool load) {
+    if (!IsSupported<T>(type)) {
+        return std::nan("");
+    }
+    auto tree = MakeTree<T>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(next_value());
+    }
+    std::stringstream stream;
+    auto begin = std::chrono::high_resolution_clock::now();
+    SaveTree(*tree, stream);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (load) {
+        auto loaded = MakeTree<T>(type);
+        begin = std::chrono::high_resolution_clock::now();
+        LoadTree(*loaded, stream);
+        end = std::chrono::high_resolution_clock::now();
+    }
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return seconds > 0 ? static_cast<double>(stream.tellp()) * 1e-6 / seconds : 0.0;
+}
+
+/**
+ * All functions below are same
+ *
+ * Throughput benchmark
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements in the tree
+ * @return Megabytes per second instead of operating time
+ */
+double SaveRandomSparseIntTree(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    return SaveOrLoadThroughput<int>(type, op_count, [&] { return dist(gen); }, false);
+}
+
+double LoadRandomSparseIntTree(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    return SaveOrLoadThroughput<int>(type, op_count, [&] { return dist(gen); }, true);
+}
+
+double SaveRandomSparseStringTree(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    return SaveOrLoadThroughput<std::string>(
+        type, op_count, [&] { return std::to_string(dist(gen)); }, false);
+}
+
+double LoadRandomSparseStringTree(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    return SaveOrLoadThroughput<std::string>(
+        type, op_count, [&] { return std::to_string(dist(gen)); }, true);
+}
+
+/// Lookups done in a cold tree before its resident memory is measured
+constexpr uint64_t kColdQueryCount = 1000;
+
+/**
+ * @param name Name of the file
+ * @return Path of a scratch file, which is unique for the calling thread
+ */
+std::string ScratchFilePath(const std::string& name) {
+    auto thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return (std::filesystem::temp_directory_path() / (std::to_string(thread) + "_" + name))
+        .string();
+}
+
+/**
+ * Writes the file to disk and evicts it from the page cache, so the next read of it is cold.
+ * Eviction is a hint, the kernel may keep some pages
+ * @param path Path to the file
+ */
+void DropFromPageCache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/**
+ * @param path Path to a mapped file
+ * @return Bytes of the file mapped to resident pages of this process
+ */
+int64_t ResidentBytesOfMapping(const std::string& path) {
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    int64_t kilobytes = 0;
+    while (std::getline(smaps, line)) {
+        // Every mapping starts with its address range, fields of it follow as "Name: value"
+        if (line.find(':') == std::string::npos || line.find('-') < line.find(':')) {
+            inside = line.size() >= path.size() &&
+                     line.compare(line.size() - path.size(), path.size(), path) == 0;
+        } else if (inside && line.rfind("Rss:", 0) == 0) {
+            kilobytes += std::stoll(line.substr(4));
+        }
+    }
+    return kilobytes * 1024;
+}
+
+/**
+ * Cold start: the tree is written to a file and evicted from the page cache, then
+ * the file is either mapped by MappedTree or loaded into a red-black tree
+ * @param type Type of tree to write, the result hardly depends on it
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements in the tree
+ * @param mapped Whether the file is mapped instead of loaded
+ * @param measure Functor called with the opened tree, returns the result of the benchmark
+ */
+template <class Measure>
+double OpenColdRandomSparseIntTree(ImplType type, std::mt19937& gen, uint64_t op_count,
+                                   bool mapped, Measure measure) {
+    auto tree = MakeTree<int>(type);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    std::string path = ScratchFilePath(mapped ? "cold_tree.mapped" : "cold_tree.bin");
+    if (mapped) {
+        WriteMappedTree(*tree, path);
+    } else {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        SaveTree(*tree, out);
+    }
+    tree.reset();
+    DropFromPageCache(path);
+    int64_t before = allocation_counter::AllocatedBytes();
+    auto begin = std::chrono::high_resolution_clock::now();
+    if (mapped) {
+        tree = std::make_shared<MappedTree<int>>(path);
+    } else {
+        std::ifstream in(path, std::ios::binary);
+        tree = std::make_shared<RBTree<int>>();
+        LoadTree(*tree, in);
+    }
+    double result = measure(tree, dist, begin, before, path);
+    std::remove(path.c_str());
+    return result;
+}
+
+/**
+ * Time from opening the cold file to the answer of the first lookup
+ * @param mapped Whether the file is mapped instead of loaded into a red-black tree
+ * @return Operating time in milliseconds
+ */
+double TimeToFirstQueryOfColdRandomSparseIntTree(ImplType type, std::mt19937& gen,
+                                                 uint64_t op_count, bool mapped) {
+    return OpenColdRandomSparseIntTree(
+        type, gen, op_count, mapped,
+        [&gen](const std::shared_ptr<ITree<int>>& tree, auto& dist, auto begin, int64_t,
+               const std::string&) {
+            auto it = tree->lower_bound(dist(gen));
+            auto end = std::chrono::high_resolution_clock::now();
+            std::vector<bool> useless(1, it == tree->end());
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+                   nanoMultiplier;
+        });
+}
+
+/**
+ * Memory taken by the cold tree after 'kColdQueryCount' lookups: resident pages of the mapping
+ * or heap of the red-black tree, which is all resident after loading
+ * @param mapped Whether the file is mapped instead of loaded into a red-black tree
+ * @return Resident bytes per stored key instead of operating time
+ */
+double ResidentBytesPerKeyOfColdRandomSparseIntTree(ImplType type, std::mt19937& gen,
+                                                    uint64_t op_count, bool mapped) {
+    return OpenColdRandomSparseIntTree(
+        type, gen, op_count, mapped,
+        [&gen, mapped](const std::shared_ptr<ITree<int>>& tree, auto& dist, auto, int64_t before,
+                       const std::string& path) {
+            // We use counter, so that compiler doesn't apply optimizations
+            int counter = 0;
+            for (uint64_t i = 0; i < kColdQueryCount; ++i) {
+                auto it = tree->lower_bound(dist(gen));
+                if (it != tree->end()) {
+                    counter += *it;
+                }
+            }
+            std::vector<int> useless(1, counter);
+            int64_t used = mapped ? ResidentBytesOfMapping(path)
+                                  : allocation_counter::AllocatedBytes() - before;
+            return tree->empty() ? 0.0 : static_cast<double>(used) / tree->size();
+        });
+}
+
+/**
+ * All functions below are same
+ *
+ * Cold start benchmark
+ * @param type Type of tree to write
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements in the tree
+ * @return Operating time in milliseconds or resident bytes per key
+ */
+double FirstQueryInMappedRandomSparseIntTree(ImplType type, std::mt19937& gen,
+                                             uint64_t op_count) {
+    return TimeToFirstQueryOfColdRandomSparseIntTree(type, gen, op_count, true);
+}
+
+double FirstQueryAfterLoadingRandomSparseIntTreeIntoRB(ImplType type, std::mt19937& gen,
+                                                       uint64_t op_count) {
+    return TimeToFirstQueryOfColdRandomSparseIntTree(type, gen, op_count, false);
+}
+
+double ResidentBytesPerKeyOfMappedRandomSparseIntTree(ImplType type, std::mt19937& gen,
+                                                      uint64_t op_count) {
+    return ResidentBytesPerKeyOfColdRandomSparseIntTree(type, gen, op_count, true);
+}
+
+double ResidentBytesPerKeyOfRandomSparseIntTreeLoadedIntoRB(ImplType type, std::mt19937& gen,
+                                                            uint64_t op_count) {
+    return ResidentBytesPerKeyOfColdRandomSparseIntTree(type, gen, op_count, false);
+}
+
+/**
+ * Inserts into a durable tree, which syncs its log once per 'commit_batch' inserts.
+ * Checkpoints are turned off, so only logging is measured
+ * @param type Type of the wrapped tree
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @param commit_batch Number of inserts synced together
+ * @return Operating time in milliseconds
+ */
+double RandomSparseIntInsertIntoDurableTree(ImplType type, std::mt19937& gen, uint64_t op_count,
+                                            size_t commit_batch) {
+    std::string directory = ScratchFilePath("durable_tree");
+    std::filesystem::remove_all(directory);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<int> values(op_count);
+    for (auto& value : values) {
+        value = dist(gen);
+    }
+    std::chrono::high_resolution_clock::time_point begin, end;
+    {
+        DurableTree<int> tree(
+            directory, [type] { return MakeTree<int>(type); }, commit_batch,
+            std::numeric_limits<size_t>::max());
+        begin = std::chrono::high_resolution_clock::now();
+        for (int value : values) {
+            tree.insert(value);
+        }
+        tree.Commit();
+        end = std::chrono::high_resolution_clock::now();
+    }
+    std::filesystem::remove_all(directory);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * All functions below are same
+ *
+ * Group commit benchmark
+ * @param type Type of the wrapped tree
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @return Operating time in milliseconds
+ */
+double RandomSparseIntInsertIntoDurableTreeWithCommitBatch1(ImplType type, std::mt19937& gen,
+                                                            uint64_t op_count) {
+    return RandomSparseIntInsertIntoDurableTree(type, gen, op_count, 1);
+}
+
+double RandomSparseIntInsertIntoDurableTreeWithCommitBatch16(ImplType type, std::mt19937& gen,
+                                                             uint64_t op_count) {
+    return RandomSparseIntInsertIntoDurableTree(type, gen, op_count, 16);
+}
+
+double RandomSparseIntInsertIntoDurableTreeWithCommitBatch256(ImplType type, std::mt19937& gen,
+                                                              uint64_t op_count) {
+    return RandomSparseIntInsertIntoDurableTree(type, gen, op_count, 256);
+}
+
+/**
+ * Time to reopen a durable tree after 'op_count' inserts, its files are in the page cache
+ * @param type Type of the wrapped tree
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of inserts, so the length of the log
+ * @param checkpoint Whether the inserts are checkpointed, so recovery loads them instead
+ * of replaying the log
+ * @return Operating time in milliseconds
+ */
+double RecoveryOfDurableRandomSparseIntTree(ImplType type, std::mt19937& gen, uint64_t op_count,
+                                            bool checkpoint) {
+    std::string directory = ScratchFilePath("durable_tree");
+    std::filesystem::remove_all(directory);
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    auto make_tree = [type] { return MakeTree<int>(type); };
+    {
+        DurableTree<int> tree(directory, make_tree, 4096, std::numeric_limits<size_t>::max());
+        for (uint64_t i = 0; i < op_count; ++i) {
+            tree.insert(dist(gen));
+        }
+        if (checkpoint) {
+            tree.Checkpoint();
+        }
+    }
+    auto begin = std::chrono::high_resolution_clock::now();
+    DurableTree<int> tree(directory, make_tree);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::vector<size_t> useless(1, tree.size());
+    std::filesystem::remove_all(directory);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() *
+           nanoMultiplier;
+}
+
+/**
+ * All functions below are same
+ *
+ * Recovery benchmark
+ * @param type Type of the wrapped tree
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of inserts before recovery
+ * @return Operating time in milliseconds
+ */
+double RecoveryOfDurableRandomSparseIntTreeFromLog(ImplType type, std::mt19937& gen,
+                                                   uint64_t op_count) {
+    return RecoveryOfDurableRandomSparseIntTree(type, gen, op_count, false);
+}
+
+double RecoveryOfDurableRandomSparseIntTreeFromCheckpoint(ImplType type, std::mt19937& gen,
+                                                          uint64_t op_count) {
+    return RecoveryOfDurableRandomSparseIntTree(type, gen, op_count, true);
+}
+
+/// Number of versions the memory-per-version benchmark keeps
+constexpr uint64_t kVersionCount = 8;
+
+/**
+ * Memory of versions: every version is a copy of the previous one with one more key,
+ * all of them are kept. Persistent treaps share all but O(log n) nodes between versions,
+ * other trees copy every node
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements in the first version
+ * @return Heap bytes per version instead of operating time
+ */
+double BytesPerVersionOfRandomSparseIntTree(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    std::vector<std::shared_ptr<ITree<int>>> versions{MakeTree<int>(type)};
+    for (uint64_t i = 0; i < op_count; ++i) {
+        versions.back()->insert(dist(gen));
+    }
+    versions.reserve(kVersionCount + 1);
+    int64_t before = allocation_counter::AllocatedBytes();
+    for (uint64_t i = 0; i < kVersionCount; ++i) {
+        versions.push_back(MakeTree<int>(type, versions.back()));
+        versions.back()->insert(dist(gen));
+    }
+    int64_t used = allocation_counter::AllocatedBytes() - before;
+    return static_cast<double>(used) / kVersionCount;
+}
+
+/**
+ * All functions below are same
+ *
+ * Memory benchmark
+ * @param type Type of tree to check
+ * @param gen Mersenne Twister generator
+ * @param op_count Number of elements to insert
+ * @return Heap bytes per stored key instead of operating time
+ */
+double BytesPerRandomSparseIntKey(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    int64_t before = allocation_counter::AllocatedBytes();
+    auto tree = MakeTree<int>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        tree->insert(dist(gen));
+    }
+    int64_t used = allocation_counter::AllocatedBytes() - before;
+    return tree->empty() ? 0.0 : static_cast<double>(used) / tree->size();
+}
+
+double BytesPerRandomSparseStringKey(ImplType type, std::mt19937& gen, uint64_t op_count) {
+    if (!IsSupported<std::string>(type)) {
+        return std::nan("");
+    }
+    std::uniform_int_distribution dist(std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max());
+    int64_t before = allocation_counter::AllocatedBytes();
+    auto tree = MakeTree<std::string>(type);
+    for (uint64_t i = 0; i < op_count; ++i) {
+        // Short strings fit into small string buffer, so only the structure itself is measured
+        tree->insert(std::to_string(dist(gen)));
+    }
+    int64_t used = allocation_counter::AllocatedBytes() - before;
+    return tree->empty() ? 0.0 : static_cast<double>(used) / tree->size();
+}
@@ -1,603 +1,1677 @@
-#pragma once
-#include <exception>
-#include <iostream>
-#include <random>
-#include <set>
-#include <string>
-#include <utility>
-#include <vector>
-
-#include "../trees/abstract_tree.h"
-#include "../trees/avl_tree.h"
-#include "../trees/cartesian_tree.h"
-#include "../trees/rb_tree.h"
-#include "../trees/skip_list.h"
-#include "../trees/splay_tree.h"
-#include "../trees/stdlib_set.h"
-
-#define RELEASE_BUILD
-
-/// All types of trees
-enum class ImplType { kAVL, kCartesian, kRB, kSkipList, kSplay, kSet };
-
-/**
- * Makes a tree of given type and returns a shared pointer on it
- * @tparam T Tree value type
- * @tparam Types Types of constructor parameters
- * @param type Type of tree to make
- * @param params Parameters for tree constructor
- * @return Shared pointer on a new tree
- */
-template <class T, class... Types>
-std::shared_ptr<ITree<T>> MakeTree(ImplType type, Types... params) {
-    if (type == ImplType::kAVL) {
-        return std::make_shared<AVLTree<T>>(params...);
-    } else if (type == ImplType::kCartesian) {
-        return std::make_shared<CartesianTree<T>>(params...);
-    } else if (type == ImplType::kRB) {
-        return std::make_shared<RBTree<T>>(params...);
-    } else if (type == ImplType::kSkipList) {
-        return std::make_shared<SkipList<T>>(params...);
-    } else if (type == ImplType::kSplay) {
-        return std::make_shared<SplayTree<T>>(params...);
-    } else if (type == ImplType::kSet) {
-        return std::make_shared<StdlibSet<T>>(params...);
-    } else {
-        throw std::runtime_error("Impossible behaviour");
-    }
-}
-
-/**
- * Replacement for ITree operator=(const ITree& other)
- *
- * Makes a copy of given in @param rhs tree and assigns it to @param lhs
- * @tparam T Tree value type
- * @param type Type of tree to copy
- * @param lhs Used to return a copy
- * @param rhs Given tree
- */
-template <class T>
-void MakeCopyAssignment(ImplType type, std::shared_ptr<ITree<T>>& lhs,
-                        std::shared_ptr<ITree<T>> rhs) {
-    if (type == ImplType::kAVL) {
-        *dynamic_cast<AVLTree<T>*>(lhs.get()) = *dynamic_cast<AVLTree<T>*>(rhs.get());
-    } else if (type == ImplType::kCartesian) {
-        *dynamic_cast<CartesianTree<T>*>(lhs.get()) = *dynamic_cast<CartesianTree<T>*>(rhs.get());
-    } else if (type == ImplType::kRB) {
-        *dynamic_cast<RBTree<T>*>(lhs.get()) = *dynamic_cast<RBTree<T>*>(rhs.get());
-    } else if (type == ImplType::kSkipList) {
-        *dynamic_cast<SkipList<T>*>(lhs.get()) = *dynamic_cast<SkipList<T>*>(rhs.get());
-    } else if (type == ImplType::kSplay) {
-        *dynamic_cast<SplayTree<T>*>(lhs.get()) = *dynamic_cast<SplayTree<T>*>(rhs.get());
-    } else if (type == ImplType::kSet) {
-        *dynamic_cast<StdlibSet<T>*>(lhs.get()) = *dynamic_cast<StdlibSet<T>*>(rhs.get());
-    } else {
-        throw std::runtime_error("Impossible behaviour");
-    }
-}
-
-/**
- * Checks if std::set<T> and ITree<T> had the same elements
- * @tparam T Tree value type
- * @param set Std::set for comparison
- * @param tree ITree object for comparison
- * @return True if elements in both structures are same
- */
-template <class T>
-bool operator==(std::set<T> set, std::shared_ptr<ITree<T>> tree) {
-    if (set.size() != tree->size()) {
-        return false;
-    }
-    auto tree_it = tree->begin();
-    for (const T& elem : set) {
-        REQUIRE_NOTHROW(*tree_it);
-        if (elem != *tree_it) {
-            return false;
-        }
-        REQUIRE_NOTHROW(++tree_it);
-    }
-    REQUIRE(tree_it == tree->end());
-    return true;
-}
-
-/**
- * Checks if std::set<T> and ITree<T> gave the same answers on find() and lower_bound() queries.
- * @tparam T Tree value type
- * @param set Std::set for comparison
- * @param tree ITree object for comparison
- * @param value Value for find() and lower_bound() queries
- */
-template <class T>
-void CheckFindAndLB(const std::set<T>& set, std::shared_ptr<ITree<T>> tree, const T& value) {
-    auto set_it = set.find(value);
-    if (set_it == set.end()) {
-        REQUIRE(tree->find(value) == tree->end());
-    } else {
-        auto it = tree->find(value);
-        REQUIRE(*it == *set_it);
-        if (set_it != set.begin()) {
-            REQUIRE(it != tree->begin());
-            REQUIRE(*(--it) == *(--set_it));
-            ++it, ++set_it;
-        }
-        ++set_it, ++it;
-        if (set_it != set.end()) {
-            REQUIRE(it != tree->end());
-            REQUIRE(*it == *set_it);
-        }
-    }
-
-    set_it = set.lower_bound(value);
-    if (set_it == set.end()) {
-        auto it = tree->lower_bound(value);
-        REQUIRE(it == tree->end());
-        if (set_it != set.begin()) {
-            REQUIRE(it != tree->begin());
-            REQUIRE(*(--set_it) == *(--it));
-        }
-    } else {
-        auto it = tree->lower_bound(value);
-        REQUIRE(*it == *set_it);
-        if (set_it != set.begin()) {
-            REQUIRE(it != tree->begin());
-            REQUIRE(*(--set_it) == *(--it));
-            ++set_it, ++it;
-        }
-        ++set_it, ++it;
-        if (set_it != set.end()) {
-            REQUIRE(it != tree->end());
-            REQUIRE(*set_it == *it);
-        }
-    }
-}
-
-/**
- * Random number generator functor.
- * Uses singleton pattern.
- */
-class Random {
-public:
-    /**
-     * Generates random number in the interval [from, to]
-     * @tparam T Integral type parameter
-     * @param from Start of the interval
-     * @param to End of the interval
-     * @return Number in the interval [from, to]
-     */
-    template <class T>
-    static uint32_t Next(const T& from, const T& to) {
-        static Random rand = Random();
-        std::uniform_int_distribution<T> dist(from, to);
-        return dist(rand.gen_);
-    }
-
-private:
-    /**
-     * If the build is DEBUG, it generates a predictable identical sequence.
-     */
-    Random() {
-#ifdef RELEASE_BUILD
-        /// GOOD INIT
-        std::random_device device;
-        gen_ = std::mt19937(device());
-#else
-        /// BAD INIT
-        gen_ = std::mt19937(0u);
-#endif
-    }
-
-    std::mt19937 gen_;
-};
-
-/**
- * All functions below are same
- *
- * Test
- * @param type Type of tree to check
- */
-void SomeTest(ImplType type) {
-    auto tree = MakeTree<int>(type);
-    tree->insert(1);
-    REQUIRE(*tree->begin() == 1);
-}
-
-void EmptinessTest(ImplType type) {
-    auto tree = MakeTree<int>(type);
-    REQUIRE(tree->size() == 0);
-    REQUIRE(tree->empty());
-    REQUIRE_NOTHROW(tree->clear());
-    REQUIRE(tree->size() == 0);
-    REQUIRE_NOTHROW(tree->erase(5));
-    REQUIRE(tree->empty());
-}
-
-void EmptyIteratorsTest(ImplType type) {
-    auto tree = MakeTree<int>(type);
-    REQUIRE(tree->begin() == tree->end());
-    REQUIRE(tree->find(10) == tree->end());
-    REQUIRE(tree->lower_bound(0) == tree->end());
-    {
-        auto it = tree->begin();
-        REQUIRE_THROWS_AS(--it, std::exception);
-    }
-    {
-        auto it = tree->begin();
-        REQUIRE_THROWS_AS(++it, std::exception);
-    }
-    {
-        auto it = tree->end();
-        REQUIRE_THROWS_AS(it--, std::exception);
-    }
-    {
-        auto it = tree->begin();
-        REQUIRE_THROWS_AS(it++, std::exception);
-    }
-    {
-        auto it = tree->end();
-        REQUIRE_THROWS_AS(++it, std::exception);
-    }
-    REQUIRE(tree->empty());
-}
-
-void EmptyCopyingTest(ImplType type) {
-    auto tree1 = MakeTree<int>(type);
-    auto tree2 = MakeTree<int, std::shared_ptr<ITree<int>>>(type, tree1);
-    REQUIRE(tree1->empty());
-    REQUIRE(tree2->empty());
-    REQUIRE(tree1->begin() != tree2->begin());
-    REQUIRE(tree1->end() != tree2->end());
-    auto tree3 = MakeTree<int, std::shared_ptr<ITree<int>>>(type, tree1);
-    MakeCopyAssignment(type, tree3, tree2);
-    REQUIRE(tree2->empty());
-    REQUIRE(tree3->empty());
-    REQUIRE(tree3->begin() != tree2->begin());
-    REQUIRE(tree3->end() != tree2->end());
-    REQUIRE_NOTHROW(MakeCopyAssignment(type, tree3, tree3));
-}
-
-void FewElementsTest(ImplType type) {
-    std::vector<int> fill = {1, 0};
-    auto tree = MakeTree<int>(type);
-    std::set<int> set;
-    for (int& value : fill) {
-        tree->insert(value);
-        set.insert(value);
-        REQUIRE(!tree->empty());
-    }
-    REQUIRE(set == tree);
-    set.clear();
-    REQUIRE_NOTHROW(tree->clear());
-    REQUIRE(set == tree);
-    REQUIRE(tree->empty());
-}
-
-void FewElementsIteratorTest(ImplType type) {
-    {
-        std::vector<int> fill = {3, 4, 2, 5, 1};
-        std::set<int> set(fill.begin(), fill.end());
-        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
-        REQUIRE(set == tree);
-        REQUIRE(tree->find(10) == tree->end());
-        REQUIRE(tree->lower_bound(0) == tree->begin());
-    }
-    {
-        std::vector<int> fill = {3, 4, 2, 5, 1};
-        std::set<int> set(fill.begin(), fill.end());
-        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
-        auto it = tree->end();
-        REQUIRE_THROWS_AS(*it, std::exception);
-        REQUIRE_THROWS_AS(it++, std::exception);
-        it = tree->begin();
-        REQUIRE_THROWS_AS(--it, std::exception);
-    }
-    {
-        std::vector<std::pair<std::string, int>> fill = {
-            {"one", 1}, {"two", 2}, {"three", 3}, {"four", 4}};
-        std::set<std::pair<std::string, int>> set(fill.begin(), fill.end());
-        auto tree = MakeTree<std::pair<std::string, int>>(type, fill.begin(), fill.end());
-        auto it = tree->begin();
-        REQUIRE(it->first == "four");
-        REQUIRE(it->second == 4);
-        ++it, ++it;
-        REQUIRE(it->first == "three");
-        REQUIRE(it->second == 3);
-        it = tree->begin();
-        REQUIRE_THROWS_AS(it--, std::exception);
-        it = tree->end();
-        REQUIRE_THROWS_AS(*it, std::exception);
-        REQUIRE_THROWS_AS(it->first, std::exception);
-        REQUIRE_THROWS_AS(it->second, std::exception);
-        REQUIRE_THROWS_AS(++it, std::exception);
-    }
-    {
-        auto tree = MakeTree<std::pair<int, int>, std::initializer_list<std::pair<int, int>>>(
-            type, {{0, 1},
-                   {-5, 0},
-                   {3, 11},
-                   {std::numeric_limits<int>::max(), std::numeric_limits<int>::min()}});
-        REQUIRE(tree->begin()->first == -5);
-        REQUIRE((--tree->end())->second == std::numeric_limits<int>::min());
-        tree->clear();
-        tree->insert(std::make_pair(1, 1));
-        tree->insert(std::make_pair(-1, 1));
-        REQUIRE(tree->size() == 2);
-        REQUIRE(tree->begin()->first == -1);
-    }
-}
-
-void FewElementsCopyingTest(ImplType type) {
-    {
-        std::set<int> fill = {123, 532, 635, 13, 256, 986};
-        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
-        auto tree2 = MakeTree<int>(type, tree);
-        REQUIRE(tree2->size() == tree->size());
-        tree2->erase(532);
-        REQUIRE(tree2->size() == 5);
-        REQUIRE(tree->size() == 6);
-        tree->insert(1);
-        tree2->insert(100);
-        REQUIRE(tree2->size() == 6);
-        REQUIRE(tree->size() == 7);
-        REQUIRE(tree->find(1) != tree->end());
-        REQUIRE(*tree2->lower_bound(99) == 100);
-        tree->clear();
-        REQUIRE(tree2->size() == 6);
-    }
-    {
-        std::set<int> fill = {123, 532, 635, 13, 256, 986};
-        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
-        auto tree2 = MakeTree<int>(type);
-        MakeCopyAssignment(type, tree2, tree);
-        REQUIRE(tree2->size() == tree->size());
-        tree2->erase(532);
-        REQUIRE(tree2->size() == 5);
-        REQUIRE(tree->size() == 6);
-        tree->insert(1);
-        tree2->insert(100);
-        REQUIRE(tree2->size() == 6);
-        REQUIRE(tree->size() == 7);
-        REQUIRE(tree->find(1) != tree->end());
-        REQUIRE(*tree2->lower_bound(99) == 100);
-        tree->clear();
-        REQUIRE(tree2->size() == 6);
-    }
-    {
-        auto tree = MakeTree<int>(type);
-        auto tree2 = MakeTree<int>(type);
-        MakeCopyAssignment(type, tree2, tree);
-        REQUIRE(tree->empty());
-        REQUIRE(tree2->empty());
-        tree->insert(10);
-        REQUIRE(tree2->empty());
-        tree->erase(10);
-        REQUIRE(tree2->empty());
-        tree2->insert(15);
-        tree2->insert(20);
-        auto tree3 = MakeTree<int>(type);
-        MakeCopyAssignment(type, tree3, tree2);
-        tree2->clear();
-        REQUIRE(tree3->size() == 2);
-    }
-    {
-        std::vector<int> fill = {3, 3, -1, 6, 0, 0, 17, -5, 4, 2};
-        std::set<int> set(fill.begin(), fill.end());
-        auto tree1 = MakeTree<int>(type, fill.begin(), fill.end());
-        auto tree2 = MakeTree<int>(type);
-        MakeCopyAssignment(type, tree2, tree1);
-        tree2->insert(5);
-        tree2->insert(18);
-        tree2->insert(-2);
-        auto tree1_it = tree1->begin(), tree2_it = tree2->begin();
-        auto it = set.begin();
-        while (tree1_it != tree1->end() || tree2_it != tree2->end() || it != set.end()) {
-            if (*tree2_it == 5 || *tree2_it == 18 || *tree2_it == -2) {
-                ++tree2_it;
-                continue;
-            }
-            if (tree1_it == tree1->end() || tree2_it == tree2->end() || it == set.end()) {
-                REQUIRE(tree1_it == tree1->end());
-                REQUIRE(tree2_it == tree2->end());
-                REQUIRE(it == set.end());
-            } else {
-                REQUIRE(*tree1_it == *tree2_it);
-                REQUIRE(*tree1_it == *it);
-                ++tree1_it, ++tree2_it, ++it;
-            }
-        }
-    }
-}
-
-
-/**
- * @class for testing.
- * It helps to check if the memory is released properly after removing each object.
- * It also has only `less` operator for comparison.
- */
-class StrangeInt {
-public:
-    static int counter;
-
-    StrangeInt() : value_() {
-        ++counter;
-    }
-    StrangeInt(int value) : value_(value) {
-        ++counter;
-    }
-    StrangeInt(const StrangeInt& other) : value_(other.value_) {
-        ++counter;
-    }
-    StrangeInt(StrangeInt&& other) noexcept : value_(other.value_) {
-        ++counter;
-    }
-
-    bool operator<(const StrangeInt& other) const {
-        return value_ < other.value_;
-    }
-
-    static void init() {
-        counter = 0;
-    }
-
-    ~StrangeInt() {
-        --counter;
-    }
-private:
-    int value_;
-};
-int StrangeInt::counter;
-
-void StrangeTest(ImplType type) {
-    {
-        int count = StrangeInt::counter;
-        auto tree = MakeTree<StrangeInt>(type);
-        tree->insert(2);
-        tree->insert(42);
-        tree->clear();
-        REQUIRE(count == StrangeInt::counter);
-    }
-    {
-        int count = StrangeInt::counter;
-        std::set<int> fill = {123, 532, 635, 13, 256, 986};
-        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
-        for (auto& value : *tree) {
-            tree->erase(value);
-        }
-        REQUIRE(count == StrangeInt::counter);
-    }
-    int count = StrangeInt::counter;
-    {
-        std::set<int> fill = {123, 532, 635, 13, 256, 986};
-        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
-    }
-    REQUIRE(count == StrangeInt::counter);
-}
-
-void StrangeCopyTest(ImplType type) {
-    {
-        int count = StrangeInt::counter;
-        std::set<int> fill = {123, 532, 635, 13, 256, 986};
-        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
-        auto tree2 = MakeTree<StrangeInt>(type, tree);
-        tree2->insert(1000);
-        auto tree3 = MakeTree<StrangeInt>(type);
-        MakeCopyAssignment(type, tree3, tree2);
-        tree3->erase(1000);
-        REQUIRE(tree3->size() == tree->size());
-        REQUIRE(tree->size() + 1 == tree2->size());
-        tree->clear();
-        tree2->clear();
-        tree3->clear();
-        REQUIRE(count == StrangeInt::counter);
-    }
-    int count = StrangeInt::counter;
-    {
-        std::set<int> fill = {123, 532, 635, 13, 256, 986};
-        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
-        auto tree2 = MakeTree<StrangeInt>(type, tree);
-        tree2->insert(1000);
-        auto tree3 = MakeTree<StrangeInt>(type);
-        MakeCopyAssignment(type, tree3, tree2);
-        tree3->erase(1000);
-        REQUIRE(tree3->size() == tree->size());
-        REQUIRE(tree->size() + 1 == tree2->size());
-    }
-    REQUIRE(count == StrangeInt::counter);
-}
-
-void FindAndLBTest(ImplType type) {
-    for (int count = 0; count < 100; ++count) {
-        std::vector<int> fill;
-        for (int i = 0; i < 10; ++i) {
-            fill.emplace_back(Random::Next(-10, 10));
-        }
-        std::set<int> set(fill.begin(), fill.end());
-        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
-        for (int i = 0; i < 40; ++i) {
-            CheckFindAndLB<int>(set, tree, Random::Next(-10, 10));
-        }
-    }
-}
-
-void InsertAndEraseTest(ImplType type) {
-    for (int count = 0; count < 100; ++count) {
-        std::vector<int> fill;
-        for (int i = 0; i < 10; ++i) {
-            fill.emplace_back(Random::Next(-10, 10));
-        }
-        std::set<int> set(fill.begin(), fill.end());
-        auto tree = MakeTree<int>(type);
-        for (const int& value : fill) {
-            tree->insert(value);
-        }
-        for (int i = 0; i < 10; ++i) {
-            int value = Random::Next(-10, 10);
-            if (Random::Next(0, 1)) {
-                set.insert(value);
-                tree->insert(value);
-            } else {
-                set.erase(value);
-                tree->erase(value);
-            }
-            CheckFindAndLB(set, tree, value);
-        }
-        auto it = set.begin();
-        while (!set.empty()) {
-            if (Random::Next(0, 5)) {
-                ++it;
-            } else {
-                int value = *it;
-                tree->erase(value);
-                it = set.erase(it);
-                CheckFindAndLB(set, tree, value);
-            }
-            if (it == set.end()) {
-                it = set.begin();
-            }
-        }
-    }
-}
-
-void RBBlackHeightTest(ImplType type) {
-    if (type != ImplType::kRB) {
-        std::cout << "Test is only designed for RB trees. ";
-        return;
-    }
-    for (int count = 0; count < 100; ++count) {
-        std::vector<int> fill;
-        for (int i = 0; i < 10; ++i) {
-            fill.emplace_back(Random::Next(-100, 100));
-        }
-        std::set<int> set(fill.begin(), fill.end());
-        auto tree = std::make_shared<RBTree<int>>();
-        for (const int& value : fill) {
-            tree->insert(value);
-            REQUIRE_NOTHROW(tree->CheckRB());
-        }
-
-        for (int i = 0; i < 10; ++i) {
-            int value = Random::Next(-100, 100);
-            if (Random::Next(0, 1)) {
-                set.insert(value);
-                tree->insert(value);
-            } else {
-                set.erase(value);
-                tree->erase(value);
-            }
-            REQUIRE_NOTHROW(tree->CheckRB());
-        }
-        auto it = set.begin();
-        while (!set.empty()) {
-            if (Random::Next(0, 5)) {
-                ++it;
-            } else {
-                int value = *it;
-                tree->erase(value);
-                it = set.erase(it);
-                REQUIRE_NOTHROW(tree->CheckRB());
-            }
-            if (it == set.end()) {
-                it = set.begin();
-            }
-        }
-    }
-}
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../trees/abstract_tree.h"
+#include "../trees/art_set.h"
+#include "../trees/avl_tree.h"
+#include "../trees/cartesian_tree.h"
+#include "../trees/durable_tree.h"
+#include "../trees/filtered_tree.h"
+#include "../trees/flat_set.h"
+#include "../trees/lsm_set.h"
+#include "../trees/frozen_tree.h"
+#include "../trees/mapped_tree.h"
+#include "../trees/mvcc_tree.h"
+#include "../trees/persistent_treap.h"
+#include "../trees/rb_tree.h"
+#include "../trees/scapegoat_tree.h"
+#include "../trees/serialization.h"
+#include "../trees/skip_list.h"
+#include "../trees/splay_tree.h"
+#include "../trees/stdlib_set.h"
+#include "../trees/veb_set.h"
+#include "../trees/wavl_tree.h"
+
+#define RELEASE_BUILD
+
+/// All types of trees
+enum class ImplType {
+    kART,
+    kAVL,
+    kCartesian,
+    kFiltered,
+    kFlat,
+    kLSM,
+    kMVCC,
+    kPersistent,
+    kRB,
+    kScapegoat,
+    kSkipList,
+    kSplay,
+    kSplayTopDown,
+    kVEB,
+    kWAVL,
+    kSet
+};
+
+/**
+ * Makes a tree of given type and returns a shared pointer on it
+ * @tparam T Tree value type
+ * @tparam Types Types of constructor parameters
+ * @param type Type of tree to make
+ * @param params Parameters for tree constructor
+ * @return Shared pointer on a new tree
+ */
+template <class T, class... Types>
+std::shared_ptr<ITree<T>> MakeTree(ImplType type, Types... params) {
+    if (type == ImplType::kART) {
+        if constexpr (IsARTKey<T>::value) {
+            return std::make_shared<ARTSet<T>>(params...);
+        } else {
+            throw std::invalid_argument("Adaptive radix tree stores only integers and strings");
+        }
+    } else if (type == ImplType::kAVL) {
+        return std::make_shared<AVLTree<T>>(params...);
+    } else if (type == ImplType::kCartesian) {
+        return std::make_shared<CartesianTree<T>>(params...);
+    } else if (type == ImplType::kFiltered) {
+        return std::make_shared<FilteredTree<T>>(params...);
+    } else if (type == ImplType::kFlat) {
+        if constexpr (IsFlatValue<T>::value) {
+            return std::make_shared<FlatSet<T>>(params...);
+        } else {
+            throw std::invalid_argument("Flat set stores only move assignable values");
+        }
+    } else if (type == ImplType::kLSM) {
+        return std::make_shared<LSMSet<T>>(params...);
+    } else if (type == ImplType::kMVCC) {
+        return std::make_shared<MVCCTree<T>>(params...);
+    } else if (type == ImplType::kPersistent) {
+        return std::make_shared<PersistentTreap<T>>(params...);
+    } else if (type == ImplType::kRB) {
+        return std::make_shared<RBTree<T>>(params...);
+    } else if (type == ImplType::kScapegoat) {
+        return std::make_shared<ScapegoatTree<T>>(params...);
+    } else if (type == ImplType::kSkipList) {
+        return std::make_shared<SkipList<T>>(params...);
+    } else if (type == ImplType::kSplay) {
+        return std::make_shared<SplayTree<T>>(params...);
+    } else if (type == ImplType::kSplayTopDown) {
+        auto tree = std::make_shared<SplayTree<T>>(params...);
+        tree->SetSplayMode(SplayTree<T>::SplayMode::kTopDown);
+        return tree;
+    } else if (type == ImplType::kVEB) {
+        if constexpr (IsVEBKey<T>::value) {
+            return std::make_shared<VEBSet<T>>(params...);
+        } else {
+            throw std::invalid_argument("Van Emde Boas tree stores only integers");
+        }
+    } else if (type == ImplType::kWAVL) {
+        return std::make_shared<WAVLTree<T>>(params...);
+    } else if (type == ImplType::kSet) {
+        return std::make_shared<StdlibSet<T>>(params...);
+    } else {
+        throw std::runtime_error("Impossible behaviour");
+    }
+}
+
+/**
+ * Some trees store only particular value types (e.g. the adaptive radix tree needs values
+ * with a byte encoding, the flat set needs values it can move around and the van Emde Boas tree
+ * needs integers), tests skip them
+ * for other value types
+ * @tparam T Tree value type
+ * @param type Type of tree
+ * @return True if the tree of given type can store values of type T
+ */
+template <class T>
+bool IsSupported(ImplType type) {
+    if (type == ImplType::kART) {
+        return IsARTKey<T>::value;
+    } else if (type == ImplType::kFlat) {
+        return IsFlatValue<T>::value;
+    } else if (type == ImplType::kVEB) {
+        return IsVEBKey<T>::value;
+    }
+    return true;
+}
+
+/**
+ * Replacement for ITree operator=(const ITree& other)
+ *
+ * Makes a copy of given in @param rhs tree and assigns it to @param lhs
+ * @tparam T Tree value type
+ * @param type Type of tree to copy
+ * @param lhs Used to return a copy
+ * @param rhs Given tree
+ */
+template <class T>
+void MakeCopyAssignment(ImplType type, std::shared_ptr<ITree<T>>& lhs,
+                        std::shared_ptr<ITree<T>> rhs) {
+    if (type == ImplType::kART) {
+        if constexpr (IsARTKey<T>::value) {
+            *dynamic_cast<ARTSet<T>*>(lhs.get()) = *dynamic_cast<ARTSet<T>*>(rhs.get());
+        } else {
+            throw std::invalid_argument("Adaptive radix tree stores only integers and strings");
+        }
+    } else if (type == ImplType::kAVL) {
+        *dynamic_cast<AVLTree<T>*>(lhs.get()) = *dynamic_cast<AVLTree<T>*>(rhs.get());
+    } else if (type == ImplType::kCartesian) {
+        *dynamic_cast<CartesianTree<T>*>(lhs.get()) = *dynamic_cast<CartesianTree<T>*>(rhs.get());
+    } else if (type == ImplType::kFiltered) {
+        *dynamic_cast<FilteredTree<T>*>(lhs.get()) = *dynamic_cast<FilteredTree<T>*>(rhs.get());
+    } else if (type == ImplType::kFlat) {
+        if constexpr (IsFlatValue<T>::value) {
+            *dynamic_cast<FlatSet<T>*>(lhs.get()) = *dynamic_cast<FlatSet<T>*>(rhs.get());
+        } else {
+            throw std::invalid_argument("Flat set stores only move assignable values");
+        }
+    } else if (type == ImplType::kLSM) {
+        *dynamic_cast<LSMSet<T>*>(lhs.get()) = *dynamic_cast<LSMSet<T>*>(rhs.get());
+    } else if (type == ImplType::kMVCC) {
+        *dynamic_cast<MVCCTree<T>*>(lhs.get()) = *dynamic_cast<MVCCTree<T>*>(rhs.get());
+    } else if (type == ImplType::kPersistent) {
+        *dynamic_cast<PersistentTreap<T>*>(lhs.get()) =
+            *dynamic_cast<PersistentTreap<T>*>(rhs.get());
+    } else if (type == ImplType::kRB) {
+        *dynamic_cast<RBTree<T>*>(lhs.get()) = *dynamic_cast<RBTree<T>*>(rhs.get());
+    } else if (type == ImplType::kScapegoat) {
+        *dynamic_cast<ScapegoatTree<T>*>(lhs.get()) = *dynamic_cast<ScapegoatTree<T>*>(rhs.get());
+    } else if (type == ImplType::kSkipList) {
+        *dynamic_cast<SkipList<T>*>(lhs.get()) = *dynamic_cast<SkipList<T>*>(rhs.get());
+    } else if (type == ImplType::kSplay || type == ImplType::kSplayTopDown) {
+        *dynamic_cast<SplayTree<T>*>(lhs.get()) = *dynamic_cast<SplayTree<T>*>(rhs.get());
+    } else if (type == ImplType::kVEB) {
+        if constexpr (IsVEBKey<T>::value) {
+            *dynamic_cast<VEBSet<T>*>(lhs.get()) = *dynamic_cast<VEBSet<T>*>(rhs.get());
+        } else {
+            throw std::invalid_argument("Van Emde Boas tree stores only integers");
+        }
+    } else if (type == ImplType::kWAVL) {
+        *dynamic_cast<WAVLTree<T>*>(lhs.get()) = *dynamic_cast<WAVLTree<T>*>(rhs.get());
+    } else if (type == ImplType::kSet) {
+        *dynamic_cast<StdlibSet<T>*>(lhs.get()) = *dynamic_cast<StdlibSet<T>*>(rhs.get());
+    } else {
+        throw std::runtime_error("Impossible behaviour");
+    }
+}
+
+/**
+ * Calls @param function with a reference to the concrete tree stored in @param tree.
+ * Used to reach members which are not a part of ITree interface (e.g. heterogeneous lookup)
+ * @tparam T Tree value type
+ * @tparam Function Functor type, which accepts any tree type
+ * @param type Type of the given tree
+ * @param tree Given tree
+ * @param function Functor to call
+ * @return Result of the functor call
+ */
+template <class T, class Function>
+auto ApplyToTree(ImplType type, std::shared_ptr<ITree<T>> tree, Function function) {
+    if (type == ImplType::kART) {
+        return function(*dynamic_cast<ARTSet<T>*>(tree.get()));
+    } else if (type == ImplType::kAVL) {
+        return function(*dynamic_cast<AVLTree<T>*>(tree.get()));
+    } else if (type == ImplType::kCartesian) {
+        return function(*dynamic_cast<CartesianTree<T>*>(tree.get()));
+    } else if (type == ImplType::kFiltered) {
+        return function(*dynamic_cast<FilteredTree<T>*>(tree.get()));
+    } else if (type == ImplType::kFlat) {
+        if constexpr (IsFlatValue<T>::value) {
+            return function(*dynamic_cast<FlatSet<T>*>(tree.get()));
+        } else {
+            throw std::invalid_argument("Flat set stores only move assignable values");
+        }
+    } else if (type == ImplType::kLSM) {
+        return function(*dynamic_cast<LSMSet<T>*>(tree.get()));
+    } else if (type == ImplType::kMVCC) {
+        return function(*dynamic_cast<MVCCTree<T>*>(tree.get()));
+    } else if (type == ImplType::kPersistent) {
+        return function(*dynamic_cast<PersistentTreap<T>*>(tree.get()));
+    } else if (type == ImplType::kRB) {
+        return function(*dynamic_cast<RBTree<T>*>(tree.get()));
+    } else if (type == ImplType::kScapegoat) {
+        return function(*dynamic_cast<ScapegoatTree<T>*>(tree.get()));
+    } else if (type == ImplType::kSkipList) {
+        return function(*dynamic_cast<SkipList<T>*>(tree.get()));
+    } else if (type == ImplType::kSplay || type == ImplType::kSplayTopDown) {
+        return function(*dynamic_cast<SplayTree<T>*>(tree.get()));
+    } else if (type == ImplType::kVEB) {
+        if constexpr (IsVEBKey<T>::value) {
+            return function(*dynamic_cast<VEBSet<T>*>(tree.get()));
+        } else {
+            throw std::invalid_argument("Van Emde Boas tree stores only integers");
+        }
+    } else if (type == ImplType::kWAVL) {
+        return function(*dynamic_cast<WAVLTree<T>*>(tree.get()));
+    } else if (type == ImplType::kSet) {
+        return function(*dynamic_cast<StdlibSet<T>*>(tree.get()));
+    } else {
+        throw std::runtime_error("Impossible behaviour");
+    }
+}
+
+/**
+ * Checks if std::set<T> and ITree<T> had the same elements
+ * @tparam T Tree value type
+ * @param set Std::set for comparison
+ * @param tree ITree object for comparison
+ * @return True if elements in both structures are same
+ */
+template <class T>
+bool operator==(std::set<T> set, std::shared_ptr<ITree<T>> tree) {
+    if (set.size() != tree->size()) {
+        return false;
+    }
+    auto tree_it = tree->begin();
+    for (const T& elem : set) {
+        REQUIRE_NOTHROW(*tree_it);
+        if (elem != *tree_it) {
+            return false;
+        }
+        REQUIRE_NOTHROW(++tree_it);
+    }
+    REQUIRE(tree_it == tree->end());
+    return true;
+}
+
+/**
+ * Checks if std::set<T> and ITree<T> gave the same answers on find() and lower_bound() queries.
+ * @tparam T Tree value type
+ * @param set Std::set for comparison
+ * @param tree ITree object for comparison
+ * @param value Value for find() and lower_bound() queries
+ */
+template <class T>
+void CheckFindAndLB(const std::set<T>& set, std::shared_ptr<ITree<T>> tree, const T& value) {
+    auto set_it = set.find(value);
+    if (set_it == set.end()) {
+        REQUIRE(tree->find(value) == tree->end());
+    } else {
+        auto it = tree->find(value);
+        REQUIRE(*it == *set_it);
+        if (set_it != set.begin()) {
+            REQUIRE(it != tree->begin());
+            REQUIRE(*(--it) == *(--set_it));
+            ++it, ++set_it;
+        }
+        ++set_it, ++it;
+        if (set_it != set.end()) {
+            REQUIRE(it != tree->end());
+            REQUIRE(*it == *set_it);
+        }
+    }
+
+    set_it = set.lower_bound(value);
+    if (set_it == set.end()) {
+        auto it = tree->lower_bound(value);
+        REQUIRE(it == tree->end());
+        if (set_it != set.begin()) {
+            REQUIRE(it != tree->begin());
+            REQUIRE(*(--set_it) == *(--it));
+        }
+    } else {
+        auto it = tree->lower_bound(value);
+        REQUIRE(*it == *set_it);
+        if (set_it != set.begin()) {
+            REQUIRE(it != tree->begin());
+            REQUIRE(*(--set_it) == *(--it));
+            ++set_it, ++it;
+        }
+        ++set_it, ++it;
+        if (set_it != set.end()) {
+            REQUIRE(it != tree->end());
+            REQUIRE(*set_it == *it);
+        }
+    }
+}
+
+/**
+ * Random number generator functor.
+ * Uses singleton pattern.
+ */
+class Random {
+public:
+    /**
+     * Generates random number in the interval [from, to]
+     * @tparam T Integral type parameter
+     * @param from Start of the interval
+     * @param to End of the interval
+     * @return Number in the interval [from, to]
+     */
+    template <class T>
+    static uint32_t Next(const T& from, const T& to) {
+        static Random rand = Random();
+        std::uniform_int_distribution<T> dist(from, to);
+        return dist(rand.gen_);
+    }
+
+private:
+    /**
+     * If the build is DEBUG, it generates a predictable identical sequence.
+     */
+    Random() {
+#ifdef RELEASE_BUILD
+        /// GOOD INIT
+        std::random_device device;
+        gen_ = std::mt19937(device());
+#else
+        /// BAD INIT
+        gen_ = std::mt19937(0u);
+#endif
+    }
+
+    std::mt19937 gen_;
+};
+
+/**
+ * All functions below are same
+ *
+ * Test
+ * @param type Type of tree to check
+ */
+void SomeTest(ImplType type) {
+    auto tree = MakeTree<int>(type);
+    tree->insert(1);
+    REQUIRE(*tree->begin() == 1);
+}
+
+void EmptinessTest(ImplType type) {
+    auto tree = MakeTree<int>(type);
+    REQUIRE(tree->size() == 0);
+    REQUIRE(tree->empty());
+    REQUIRE_NOTHROW(tree->clear());
+    REQUIRE(tree->size() == 0);
+    REQUIRE_NOTHROW(tree->erase(5));
+    REQUIRE(tree->empty());
+}
+
+void EmptyIteratorsTest(ImplType type) {
+    auto tree = MakeTree<int>(type);
+    REQUIRE(tree->begin() == tree->end());
+    REQUIRE(tree->find(10) == tree->end());
+    REQUIRE(tree->lower_bound(0) == tree->end());
+    {
+        auto it = tree->begin();
+        REQUIRE_THROWS_AS(--it, std::exception);
+    }
+    {
+        auto it = tree->begin();
+        REQUIRE_THROWS_AS(++it, std::exception);
+    }
+    {
+        auto it = tree->end();
+        REQUIRE_THROWS_AS(it--, std::exception);
+    }
+    {
+        auto it = tree->begin();
+        REQUIRE_THROWS_AS(it++, std::exception);
+    }
+    {
+        auto it = tree->end();
+        REQUIRE_THROWS_AS(++it, std::exception);
+    }
+    REQUIRE(tree->empty());
+}
+
+void EmptyCopyingTest(ImplType type) {
+    auto tree1 = MakeTree<int>(type);
+    auto tree2 = MakeTree<int, std::shared_ptr<ITree<int>>>(type, tree1);
+    REQUIRE(tree1->empty());
+    REQUIRE(tree2->empty());
+    REQUIRE(tree1->begin() != tree2->begin());
+    REQUIRE(tree1->end() != tree2->end());
+    auto tree3 = MakeTree<int, std::shared_ptr<ITree<int>>>(type, tree1);
+    MakeCopyAssignment(type, tree3, tree2);
+    REQUIRE(tree2->empty());
+    REQUIRE(tree3->empty());
+    REQUIRE(tree3->begin() != tree2->begin());
+    REQUIRE(tree3->end() != tree2->end());
+    REQUIRE_NOTHROW(MakeCopyAssignment(type, tree3, tree3));
+}
+
+void FewElementsTest(ImplType type) {
+    std::vector<int> fill = {1, 0};
+    auto tree = MakeTree<int>(type);
+    std::set<int> set;
+    for (int& value : fill) {
+        tree->insert(value);
+        set.insert(value);
+        REQUIRE(!tree->empty());
+    }
+    REQUIRE(set == tree);
+    set.clear();
+    REQUIRE_NOTHROW(tree->clear());
+    REQUIRE(set == tree);
+    REQUIRE(tree->empty());
+}
+
+void FewElementsIteratorTest(ImplType type) {
+    {
+        std::vector<int> fill = {3, 4, 2, 5, 1};
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
+        REQUIRE(set == tree);
+        REQUIRE(tree->find(10) == tree->end());
+        REQUIRE(tree->lower_bound(0) == tree->begin());
+    }
+    {
+        std::vector<int> fill = {3, 4, 2, 5, 1};
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
+        auto it = tree->end();
+        REQUIRE_THROWS_AS(*it, std::exception);
+        REQUIRE_THROWS_AS(it++, std::exception);
+        it = tree->begin();
+        REQUIRE_THROWS_AS(--it, std::exception);
+    }
+    if (!IsSupported<std::pair<std::string, int>>(type)) {
+        return;
+    }
+    {
+        std::vector<std::pair<std::string, int>> fill = {
+            {"one", 1}, {"two", 2}, {"three", 3}, {"four", 4}};
+        std::set<std::pair<std::string, int>> set(fill.begin(), fill.end());
+        auto tree = MakeTree<std::pair<std::string, int>>(type, fill.begin(), fill.end());
+        auto it = tree->begin();
+        REQUIRE(it->first == "four");
+        REQUIRE(it->second == 4);
+        ++it, ++it;
+        REQUIRE(it->first == "three");
+        REQUIRE(it->second == 3);
+        it = tree->begin();
+        REQUIRE_THROWS_AS(it--, std::exception);
+        it = tree->end();
+        REQUIRE_THROWS_AS(*it, std::exception);
+        REQUIRE_THROWS_AS(it->first, std::exception);
+        REQUIRE_THROWS_AS(it->second, std::exception);
+        REQUIRE_THROWS_AS(++it, std::exception);
+    }
+    {
+        auto tree = MakeTree<std::pair<int, int>, std::initializer_list<std::pair<int, int>>>(
+            type, {{0, 1},
+                   {-5, 0},
+                   {3, 11},
+                   {std::numeric_limits<int>::max(), std::numeric_limits<int>::min()}});
+        REQUIRE(tree->begin()->first == -5);
+        REQUIRE((--tree->end())->second == std::numeric_limits<int>::min());
+        tree->clear();
+        tree->insert(std::make_pair(1, 1));
+        tree->insert(std::make_pair(-1, 1));
+        REQUIRE(tree->size() == 2);
+        REQUIRE(tree->begin()->first == -1);
+    }
+}
+
+void FewElementsCopyingTest(ImplType type) {
+    {
+        std::set<int> fill = {123, 532, 635, 13, 256, 986};
+        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
+        auto tree2 = MakeTree<int>(type, tree);
+        REQUIRE(tree2->size() == tree->size());
+        tree2->erase(532);
+        REQUIRE(tree2->size() == 5);
+        REQUIRE(tree->size() == 6);
+        tree->insert(1);
+        tree2->insert(100);
+        REQUIRE(tree2->size() == 6);
+        REQUIRE(tree->size() == 7);
+        REQUIRE(tree->find(1) != tree->end());
+        REQUIRE(*tree2->lower_bound(99) == 100);
+        tree->clear();
+        REQUIRE(tree2->size() == 6);
+    }
+    {
+        std::set<int> fill = {123, 532, 635, 13, 256, 986};
+        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
+        auto tree2 = MakeTree<int>(type);
+        MakeCopyAssignment(type, tree2, tree);
+        REQUIRE(tree2->size() == tree->size());
+        tree2->erase(532);
+        REQUIRE(tree2->size() == 5);
+        REQUIRE(tree->size() == 6);
+        tree->insert(1);
+        tree2->insert(100);
+        REQUIRE(tree2->size() == 6);
+        REQUIRE(tree->size() == 7);
+        REQUIRE(tree->find(1) != tree->end());
+        REQUIRE(*tree2->lower_bound(99) == 100);
+        tree->clear();
+        REQUIRE(tree2->size() == 6);
+    }
+    {
+        auto tree = MakeTree<int>(type);
+        auto tree2 = MakeTree<int>(type);
+        MakeCopyAssignment(type, tree2, tree);
+        REQUIRE(tree->empty());
+        REQUIRE(tree2->empty());
+        tree->insert(10);
+        REQUIRE(tree2->empty());
+        tree->erase(10);
+        REQUIRE(tree2->empty());
+        tree2->insert(15);
+        tree2->insert(20);
+        auto tree3 = MakeTree<int>(type);
+        MakeCopyAssignment(type, tree3, tree2);
+        tree2->clear();
+        REQUIRE(tree3->size() == 2);
+    }
+    {
+        std::vector<int> fill = {3, 3, -1, 6, 0, 0, 17, -5, 4, 2};
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree1 = MakeTree<int>(type, fill.begin(), fill.end());
+        auto tree2 = MakeTree<int>(type);
+        MakeCopyAssignment(type, tree2, tree1);
+        tree2->insert(5);
+        tree2->insert(18);
+        tree2->insert(-2);
+        auto tree1_it = tree1->begin(), tree2_it = tree2->begin();
+        auto it = set.begin();
+        while (tree1_it != tree1->end() || tree2_it != tree2->end() || it != set.end()) {
+            if (*tree2_it == 5 || *tree2_it == 18 || *tree2_it == -2) {
+                ++tree2_it;
+                continue;
+            }
+            if (tree1_it == tree1->end() || tree2_it == tree2->end() || it == set.end()) {
+                REQUIRE(tree1_it == tree1->end());
+                REQUIRE(tree2_it == tree2->end());
+                REQUIRE(it == set.end());
+            } else {
+                REQUIRE(*tree1_it == *tree2_it);
+                REQUIRE(*tree1_it == *it);
+                ++tree1_it, ++tree2_it, ++it;
+            }
+        }
+    }
+}
+
+
+/**
+ * @class for testing.
+ * It helps to check if the memory is released properly after removing each object.
+ * It also has only `less` operator for comparison.
+ */
+class StrangeInt {
+public:
+    static int counter;
+
+    StrangeInt() : value_() {
+        ++counter;
+    }
+    StrangeInt(int value) : value_(value) {
+        ++counter;
+    }
+    StrangeInt(const StrangeInt& other) : value_(other.value_) {
+        ++counter;
+    }
+    StrangeInt(StrangeInt&& other) noexcept : value_(other.value_) {
+        ++counter;
+    }
+
+    bool operator<(const StrangeInt& other) const {
+        return value_ < other.value_;
+    }
+
+    static void init() {
+        counter = 0;
+    }
+
+    ~StrangeInt() {
+        --counter;
+    }
+private:
+    int value_;
+};
+int StrangeInt::counter;
+
+void StrangeTest(ImplType type) {
+    if (!IsSupported<StrangeInt>(type)) {
+        return;
+    }
+    {
+        int count = StrangeInt::counter;
+        auto tree = MakeTree<StrangeInt>(type);
+        tree->insert(2);
+        tree->insert(42);
+        tree->clear();
+        REQUIRE(count == StrangeInt::counter);
+    }
+    {
+        int count = StrangeInt::counter;
+        std::set<int> fill = {123, 532, 635, 13, 256, 986};
+        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
+        for (auto& value : *tree) {
+            tree->erase(value);
+        }
+        REQUIRE(count == StrangeInt::counter);
+    }
+    int count = StrangeInt::counter;
+    {
+        std::set<int> fill = {123, 532, 635, 13, 256, 986};
+        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
+    }
+    REQUIRE(count == StrangeInt::counter);
+}
+
+void StrangeCopyTest(ImplType type) {
+    if (!IsSupported<StrangeInt>(type)) {
+        return;
+    }
+    {
+        int count = StrangeInt::counter;
+        std::set<int> fill = {123, 532, 635, 13, 256, 986};
+        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
+        auto tree2 = MakeTree<StrangeInt>(type, tree);
+        tree2->insert(1000);
+        auto tree3 = MakeTree<StrangeInt>(type);
+        MakeCopyAssignment(type, tree3, tree2);
+        tree3->erase(1000);
+        REQUIRE(tree3->size() == tree->size());
+        REQUIRE(tree->size() + 1 == tree2->size());
+        tree->clear();
+        tree2->clear();
+        tree3->clear();
+        REQUIRE(count == StrangeInt::counter);
+    }
+    int count = StrangeInt::counter;
+    {
+        std::set<int> fill = {123, 532, 635, 13, 256, 986};
+        auto tree = MakeTree<StrangeInt>(type, fill.begin(), fill.end());
+        auto tree2 = MakeTree<StrangeInt>(type, tree);
+        tree2->insert(1000);
+        auto tree3 = MakeTree<StrangeInt>(type);
+        MakeCopyAssignment(type, tree3, tree2);
+        tree3->erase(1000);
+        REQUIRE(tree3->size() == tree->size());
+        REQUIRE(tree->size() + 1 == tree2->size());
+    }
+    REQUIRE(count == StrangeInt::counter);
+}
+
+void FindAndLBTest(ImplType type) {
+    for (int count = 0; count < 100; ++count) {
+        std::vector<int> fill;
+        for (int i = 0; i < 10; ++i) {
+            fill.emplace_back(Random::Next(-10, 10));
+        }
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = MakeTree<int>(type, fill.begin(), fill.end());
+        for (int i = 0; i < 40; ++i) {
+            CheckFindAndLB<int>(set, tree, Random::Next(-10, 10));
+        }
+    }
+}
+
+void InsertAndEraseTest(ImplType type) {
+    for (int count = 0; count < 100; ++count) {
+        std::vector<int> fill;
+        for (int i = 0; i < 10; ++i) {
+            fill.emplace_back(Random::Next(-10, 10));
+        }
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = MakeTree<int>(type);
+        for (const int& value : fill) {
+            tree->insert(value);
+        }
+        for (int i = 0; i < 10; ++i) {
+            int value = Random::Next(-10, 10);
+            if (Random::Next(0, 1)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB(set, tree, value);
+        }
+        auto it = set.begin();
+        while (!set.empty()) {
+            if (Random::Next(0, 5)) {
+                ++it;
+            } else {
+                int value = *it;
+                tree->erase(value);
+                it = set.erase(it);
+                CheckFindAndLB(set, tree, value);
+            }
+            if (it == set.end()) {
+                it = set.begin();
+            }
+        }
+    }
+}
+
+void HeterogeneousLookupTest(ImplType type) {
+    if (!IsSupported<std::string>(type)) {
+        return;
+    }
+    std::vector<std::string> fill = {"delta", "alpha", "echo", "charlie", "bravo"};
+    std::set<std::string> set(fill.begin(), fill.end());
+    auto tree = MakeTree<std::string>(type, fill.begin(), fill.end());
+    for (const std::string& value : set) {
+        std::string_view key(value);
+        auto it = ApplyToTree(type, tree, [&key](auto& impl) { return impl.find(key); });
+        REQUIRE(it != tree->end());
+        REQUIRE(*it == value);
+        it = ApplyToTree(type, tree, [&key](auto& impl) { return impl.lower_bound(key); });
+        REQUIRE(*it == value);
+    }
+    auto it = ApplyToTree(type, tree, [](auto& impl) { return impl.find("foxtrot"); });
+    REQUIRE(it == tree->end());
+    std::string_view prefix("d");
+    it = ApplyToTree(type, tree, [&prefix](auto& impl) { return impl.lower_bound(prefix); });
+    REQUIRE(*it == "delta");
+    prefix = "z";
+    it = ApplyToTree(type, tree, [&prefix](auto& impl) { return impl.lower_bound(prefix); });
+    REQUIRE(it == tree->end());
+    ApplyToTree(type, tree, [](auto& impl) { impl.erase(std::string_view("charlie")); });
+    ApplyToTree(type, tree, [](auto& impl) { impl.erase(std::string_view("zulu")); });
+    set.erase("charlie");
+    REQUIRE(set == tree);
+}
+
+void SkipListShapeTest(ImplType type) {
+    if (type != ImplType::kSkipList) {
+        std::cout << "Test is only designed for skip lists. ";
+        return;
+    }
+    REQUIRE_THROWS_AS(SkipList<int>(0.0, 10), std::exception);
+    REQUIRE_THROWS_AS(SkipList<int>(0.5, 0), std::exception);
+    REQUIRE(SkipList<int>::MaxLevelFor(0.5, 1'000'000) == 20);
+    REQUIRE(SkipList<int>::MaxLevelFor(0.25, 1'000'000) == 10);
+    std::vector<std::pair<double, uint32_t>> shapes = {
+        {0.25, SkipList<int>::MaxLevelFor(0.25, 100)}, {std::exp(-1.0), 3}, {0.5, 1}, {0.9, 64}};
+    for (const auto& shape : shapes) {
+        std::set<int> set;
+        auto tree = std::make_shared<SkipList<int>>(shape.first, shape.second);
+        for (int i = 0; i < 200; ++i) {
+            int value = Random::Next(-50, 50);
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB<int>(set, tree, value);
+        }
+        REQUIRE(set == std::shared_ptr<ITree<int>>(tree));
+        auto copy = std::make_shared<SkipList<int>>(*tree);
+        REQUIRE(set == std::shared_ptr<ITree<int>>(copy));
+    }
+}
+
+void SplayReadPolicyTest(ImplType type) {
+    if (type != ImplType::kSplay) {
+        std::cout << "Test is only designed for splay trees. ";
+        return;
+    }
+    using Policy = SplayTree<int>::ReadSplayPolicy;
+    REQUIRE_THROWS_AS(SplayTree<int>().SetReadSplayPolicy(Policy::kEveryKth, 0), std::exception);
+    REQUIRE_THROWS_AS(SplayTree<int>().SetReadSplayPolicy(Policy::kRandom, 1.5), std::exception);
+    REQUIRE_THROWS_AS(SplayTree<int>().SetReadSplayPolicy(Policy::kDeep, -1), std::exception);
+    std::vector<std::pair<Policy, double>> policies = {{Policy::kAlways, 0},
+                                                       {Policy::kEveryKth, 3},
+                                                       {Policy::kRandom, 0.5},
+                                                       {Policy::kDeep, 2},
+                                                       {Policy::kNever, 0}};
+    for (const auto& policy : policies) {
+        std::set<int> set;
+        auto tree = std::make_shared<SplayTree<int>>();
+        tree->SetReadSplayPolicy(policy.first, policy.second);
+        for (int i = 0; i < 300; ++i) {
+            int value = Random::Next(-50, 50);
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else if (Random::Next(0, 1)) {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB<int>(set, tree, value);
+        }
+        REQUIRE(set == std::shared_ptr<ITree<int>>(tree));
+        auto copy = std::make_shared<SplayTree<int>>(*tree);
+        REQUIRE(copy->GetReadSplayPolicy() == policy.first);
+        REQUIRE(set == std::shared_ptr<ITree<int>>(copy));
+    }
+}
+
+void AVLBalanceTest(ImplType type) {
+    if (type != ImplType::kAVL) {
+        std::cout << "Test is only designed for AVL trees. ";
+        return;
+    }
+    for (int count = 0; count < 100; ++count) {
+        std::vector<int> fill;
+        for (int i = 0; i < 50; ++i) {
+            fill.emplace_back(Random::Next(-100, 100));
+        }
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = std::make_shared<AVLTree<int>>();
+        for (const int& value : fill) {
+            tree->insert(value);
+            REQUIRE_NOTHROW(tree->CheckAVL());
+        }
+
+        for (int i = 0; i < 50; ++i) {
+            int value = Random::Next(-100, 100);
+            if (Random::Next(0, 1)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            REQUIRE_NOTHROW(tree->CheckAVL());
+        }
+        auto it = set.begin();
+        while (!set.empty()) {
+            if (Random::Next(0, 5)) {
+                ++it;
+            } else {
+                int value = *it;
+                tree->erase(value);
+                it = set.erase(it);
+                REQUIRE_NOTHROW(tree->CheckAVL());
+            }
+            if (it == set.end()) {
+                it = set.begin();
+            }
+        }
+    }
+}
+
+void WAVLRankTest(ImplType type) {
+    if (type != ImplType::kWAVL) {
+        std::cout << "Test is only designed for WAVL trees. ";
+        return;
+    }
+    for (int count = 0; count < 100; ++count) {
+        std::vector<int> fill;
+        for (int i = 0; i < 50; ++i) {
+            fill.emplace_back(Random::Next(-100, 100));
+        }
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = std::make_shared<WAVLTree<int>>();
+        for (const int& value : fill) {
+            tree->insert(value);
+            REQUIRE_NOTHROW(tree->CheckWAVL());
+        }
+
+        for (int i = 0; i < 50; ++i) {
+            int value = Random::Next(-100, 100);
+            if (Random::Next(0, 1)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            REQUIRE_NOTHROW(tree->CheckWAVL());
+        }
+        auto it = set.begin();
+        while (!set.empty()) {
+            if (Random::Next(0, 5)) {
+                ++it;
+            } else {
+                int value = *it;
+                tree->erase(value);
+                it = set.erase(it);
+                REQUIRE_NOTHROW(tree->CheckWAVL());
+            }
+            if (it == set.end()) {
+                it = set.begin();
+            }
+        }
+    }
+}
+
+void ScapegoatBalanceTest(ImplType type) {
+    if (type != ImplType::kScapegoat) {
+        std::cout << "Test is only designed for scapegoat trees. ";
+        return;
+    }
+    for (double alpha : {0.5, 0.6, 0.75, 0.9}) {
+        for (int count = 0; count < 25; ++count) {
+            std::vector<int> fill;
+            for (int i = 0; i < 50; ++i) {
+                fill.emplace_back(Random::Next(-100, 100));
+            }
+            std::set<int> set(fill.begin(), fill.end());
+            auto tree = std::make_shared<ScapegoatTree<int>>(alpha);
+            for (const int& value : fill) {
+                tree->insert(value);
+                REQUIRE_NOTHROW(tree->CheckScapegoat());
+            }
+
+            for (int i = 0; i < 50; ++i) {
+                int value = Random::Next(-100, 100);
+                if (Random::Next(0, 1)) {
+                    set.insert(value);
+                    tree->insert(value);
+                } else {
+                    set.erase(value);
+                    tree->erase(value);
+                }
+                REQUIRE_NOTHROW(tree->CheckScapegoat());
+            }
+            REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+        }
+    }
+    REQUIRE_THROWS(ScapegoatTree<int>(0.4));
+    REQUIRE_THROWS(ScapegoatTree<int>(1.0));
+}
+
+void RBBlackHeightTest(ImplType type) {
+    if (type != ImplType::kRB) {
+        std::cout << "Test is only designed for RB trees. ";
+        return;
+    }
+    for (int count = 0; count < 100; ++count) {
+        std::vector<int> fill;
+        for (int i = 0; i < 10; ++i) {
+            fill.emplace_back(Random::Next(-100, 100));
+        }
+        std::set<int> set(fill.begin(), fill.end());
+        auto tree = std::make_shared<RBTree<int>>();
+        for (const int& value : fill) {
+            tree->insert(value);
+            REQUIRE_NOTHROW(tree->CheckRB());
+        }
+
+        for (int i = 0; i < 10; ++i) {
+            int value = Random::Next(-100, 100);
+            if (Random::Next(0, 1)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            REQUIRE_NOTHROW(tree->CheckRB());
+        }
+        auto it = set.begin();
+        while (!set.empty()) {
+            if (Random::Next(0, 5)) {
+                ++it;
+            } else {
+                int value = *it;
+                tree->erase(value);
+                it = set.erase(it);
+                REQUIRE_NOTHROW(tree->CheckRB());
+            }
+            if (it == set.end()) {
+                it = set.begin();
+            }
+        }
+    }
+}
+
+void ARTKeysTest(ImplType type) {
+    if (type != ImplType::kART) {
+        std::cout << "Test is only designed for adaptive radix trees. ";
+        return;
+    }
+    {
+        // Dense and sparse integers make nodes of every size grow and shrink
+        std::set<int> set;
+        auto tree = std::make_shared<ARTSet<int>>();
+        for (int i = 0; i < 2000; ++i) {
+            int value = Random::Next(0, 1) ? Random::Next(-300, 300)
+                                           : Random::Next(std::numeric_limits<int>::min(),
+                                                          std::numeric_limits<int>::max());
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB(set, std::static_pointer_cast<ITree<int>>(tree), value);
+        }
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+    }
+    {
+        // Strings which are prefixes of each other and paths longer than the stored prefix
+        std::vector<std::string> fill = {"",
+                                         "a",
+                                         "ab",
+                                         "abc",
+                                         "abd",
+                                         "b",
+                                         "http://example.com/a/very/long/path/1",
+                                         "http://example.com/a/very/long/path/2",
+                                         "http://example.com/a/very/long/path",
+                                         "http://example.com/a/very/short",
+                                         std::string("\0\xff", 2)};
+        std::set<std::string> set;
+        auto tree = std::make_shared<ARTSet<std::string>>();
+        for (int count = 0; count < 200; ++count) {
+            std::string value = fill[Random::Next<size_t>(0, fill.size() - 1)];
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            auto shared = std::static_pointer_cast<ITree<std::string>>(tree);
+            for (const std::string& key : {value, value + "a", value.substr(0, value.size() / 2),
+                                           std::string("http://example.com/a/very/long/o"),
+                                           std::string("http://example.com/b")}) {
+                CheckFindAndLB(set, shared, key);
+            }
+        }
+        REQUIRE(set == std::static_pointer_cast<ITree<std::string>>(tree));
+    }
+}
+
+void VEBUniverseTest(ImplType type) {
+    if (type != ImplType::kVEB) {
+        std::cout << "Test is only designed for van Emde Boas trees. ";
+        return;
+    }
+    {
+        // Both ends of the universe and the sign boundary of the mapping
+        std::vector<int> fill = {std::numeric_limits<int>::min(), std::numeric_limits<int>::max(),
+                                 -1, 0, 1, 65535, 65536, -65536};
+        std::set<int> set;
+        auto tree = std::make_shared<VEBSet<int>>();
+        for (int count = 0; count < 500; ++count) {
+            int value = fill[Random::Next<size_t>(0, fill.size() - 1)];
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB(set, std::static_pointer_cast<ITree<int>>(tree), value);
+        }
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+    }
+    {
+        // Universes of other widths
+        std::set<uint64_t> wide;
+        std::set<uint8_t> narrow;
+        VEBSet<uint64_t> wide_tree;
+        VEBSet<uint8_t> narrow_tree;
+        for (int count = 0; count < 2000; ++count) {
+            uint64_t value = uint64_t(Random::Next(0u, ~0u)) << Random::Next(0, 32) |
+                             Random::Next(0u, ~0u);
+            wide.insert(value);
+            wide_tree.insert(value);
+            narrow.insert(static_cast<uint8_t>(value));
+            narrow_tree.insert(static_cast<uint8_t>(value));
+        }
+        REQUIRE(wide == std::shared_ptr<ITree<uint64_t>>(std::make_shared<VEBSet<uint64_t>>(
+                            std::move(wide_tree))));
+        REQUIRE(narrow == std::shared_ptr<ITree<uint8_t>>(std::make_shared<VEBSet<uint8_t>>(
+                              std::move(narrow_tree))));
+    }
+}
+
+void FlatBufferTest(ImplType type) {
+    if (type != ImplType::kFlat) {
+        std::cout << "Test is only designed for flat sets. ";
+        return;
+    }
+    {
+        // Enough updates to merge the buffer into the main array many times
+        std::set<int> set;
+        auto tree = std::make_shared<FlatSet<int>>();
+        auto shared = std::static_pointer_cast<ITree<int>>(tree);
+        for (int i = 0; i < 5000; ++i) {
+            int value = Random::Next(-1000, 1000);
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB(set, shared, value);
+            if (!Random::Next(0, 1000)) {
+                tree->Merge();
+            }
+        }
+        REQUIRE(set == shared);
+    }
+    {
+        // Iterators find their place again after the set is modified
+        std::set<int> set;
+        auto tree = std::make_shared<FlatSet<int>>();
+        for (int i = 0; i < 1000; i += 2) {
+            set.insert(i);
+            tree->insert(i);
+        }
+        for (int count = 0; count < 200; ++count) {
+            int value = Random::Next(0, 999);
+            auto set_it = set.lower_bound(value);
+            auto it = tree->lower_bound(value);
+            for (int i = 0; i < 50; ++i) {
+                int other = Random::Next(0, 999);
+                if (set_it != set.end() && other == *set_it) {
+                    continue;
+                }
+                if (Random::Next(0, 1)) {
+                    set.insert(other);
+                    tree->insert(other);
+                } else {
+                    set.erase(other);
+                    tree->erase(other);
+                }
+            }
+            if (set_it == set.end()) {
+                REQUIRE(it == tree->end());
+                continue;
+            }
+            REQUIRE(*it == *set_it);
+            if (set_it != set.begin()) {
+                REQUIRE(*(--it) == *std::prev(set_it));
+                ++it;
+                REQUIRE(*it == *set_it);
+            }
+            int current = *set_it;
+            ++set_it;
+            set.erase(current);
+            tree->erase(current);
+            ++it;
+            REQUIRE((set_it == set.end() ? it == tree->end() : *it == *set_it));
+        }
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+    }
+}
+
+void LSMRunsTest(ImplType type) {
+    if (type != ImplType::kLSM) {
+        std::cout << "Test is only designed for LSM sets. ";
+        return;
+    }
+    // Tiny memtables of every kind make lots of flushes and merges
+    for (ImplType memtable : {ImplType::kAVL, ImplType::kRB, ImplType::kSkipList, ImplType::kSet}) {
+        for (size_t bloom_bits : {size_t(0), LSMSet<int>::kDefaultBloomBits}) {
+            std::set<int> set;
+            auto tree = std::make_shared<LSMSet<int>>(
+                [memtable] { return MakeTree<int>(memtable); }, 8, bloom_bits);
+            auto shared = std::static_pointer_cast<ITree<int>>(tree);
+            for (int i = 0; i < 2000; ++i) {
+                int value = Random::Next(-300, 300);
+                if (Random::Next(0, 2)) {
+                    set.insert(value);
+                    tree->insert(value);
+                } else {
+                    set.erase(value);
+                    tree->erase(value);
+                }
+                CheckFindAndLB(set, shared, value);
+                REQUIRE(tree->size() == set.size());
+                if (!Random::Next(0, 100)) {
+                    REQUIRE_NOTHROW(tree->CheckRuns());
+                }
+            }
+            REQUIRE(tree->RunCount() > 0);
+            REQUIRE(set == shared);
+            // Copies share the runs, but not the updates
+            auto copy = std::make_shared<LSMSet<int>>(*tree);
+            for (int value = -300; value <= 300; value += 3) {
+                copy->erase(value);
+            }
+            copy->Flush();
+            REQUIRE_NOTHROW(copy->CheckRuns());
+            REQUIRE(set == shared);
+        }
+    }
+}
+
+void FilteredRebuildTest(ImplType type) {
+    if (type != ImplType::kFiltered) {
+        std::cout << "Test is only designed for filtered trees. ";
+        return;
+    }
+    // Filters in front of trees of other types
+    for (ImplType inner : {ImplType::kRB, ImplType::kSkipList, ImplType::kSet}) {
+        std::set<int> set;
+        auto tree = std::make_shared<FilteredTree<int>>([inner] { return MakeTree<int>(inner); });
+        auto shared = std::static_pointer_cast<ITree<int>>(tree);
+        for (int i = 0; i < 3000; ++i) {
+            int value = Random::Next(-2000, 2000);
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            CheckFindAndLB(set, shared, value);
+            REQUIRE(tree->StaleValues() <= tree->size());
+        }
+        REQUIRE(set == shared);
+    }
+    {
+        // Erased values leave the filter, when it is rebuilt
+        auto tree = std::make_shared<FilteredTree<int>>();
+        for (int value = 0; value < 1000; ++value) {
+            tree->insert(value);
+        }
+        for (int value = 0; value < 1000; ++value) {
+            REQUIRE(tree->MayContain(value));
+            tree->erase(value);
+        }
+        REQUIRE(tree->empty());
+        int passed = 0;
+        for (int value = 0; value < 1000; ++value) {
+            passed += tree->MayContain(value);
+        }
+        REQUIRE(passed < 100);
+    }
+}
+
+void PersistentVersionsTest(ImplType type) {
+    if (type != ImplType::kPersistent) {
+        std::cout << "Test is only designed for persistent treaps. ";
+        return;
+    }
+    // Every update makes a new version, all of them must stay as they were
+    std::vector<std::set<int>> sets(1);
+    std::vector<PersistentTreap<int>> versions(1);
+    for (int i = 0; i < 1000; ++i) {
+        size_t base = Random::Next(0, static_cast<int>(versions.size()) - 1);
+        std::set<int> set = sets[base];
+        int value = Random::Next(-200, 200);
+        if (Random::Next(0, 2)) {
+            set.insert(value);
+            auto version = versions[base].Inserted(value);
+            versions.push_back(std::move(version));
+        } else {
+            set.erase(value);
+            auto version = versions[base].Erased(value);
+            versions.push_back(std::move(version));
+        }
+        sets.push_back(std::move(set));
+        REQUIRE_NOTHROW(versions.back().CheckTreap());
+    }
+    for (size_t i = 0; i < versions.size(); ++i) {
+        auto shared = std::make_shared<PersistentTreap<int>>(versions[i]);
+        REQUIRE(sets[i] == std::static_pointer_cast<ITree<int>>(shared));
+        CheckFindAndLB<int>(sets[i], shared, Random::Next(-210, 210));
+    }
+    {
+        // Iterators keep traversing their version, while the tree changes
+        PersistentTreap<int> tree{1, 2, 3, 4, 5};
+        PersistentTreap<int> snapshot(tree);
+        auto it = tree.find(3);
+        tree.erase(3);
+        tree.erase(4);
+        tree.insert(10);
+        REQUIRE(*it == 3);
+        ++it;
+        REQUIRE(*it == 4);
+        REQUIRE(tree.find(3) == tree.end());
+        REQUIRE(snapshot.size() == 5);
+        REQUIRE(*snapshot.lower_bound(3) == 3);
+        REQUIRE_NOTHROW(tree.CheckTreap());
+        REQUIRE_NOTHROW(snapshot.CheckTreap());
+    }
+}
+
+/**
+ * Writers insert disjoint values, while readers scan snapshots
+ * and check that every one of them is sorted, complete and not older than the previous one
+ * @tparam Tree Type of the tree inside the wrapper
+ * @param publish_interval Number of updates between publications
+ */
+template <class Tree>
+void CheckConcurrentSnapshots(size_t publish_interval) {
+    constexpr int kThreads = 2;
+    constexpr int kValuesPerWriter = 3000;
+    MVCCTree<int, Tree> tree(publish_interval);
+    std::atomic<bool> done = false;
+    // Catch assertions aren't thread safe, so readers only count failures
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kThreads; ++i) {
+        readers.emplace_back([&tree, &done, &failures] {
+            size_t last_size = 0;
+            while (!done) {
+                auto snapshot = tree.Snapshot();
+                size_t count = 0;
+                int previous = 0;
+                for (int value : *snapshot) {
+                    failures += count && value <= previous;
+                    previous = value;
+                    ++count;
+                }
+                failures += count != snapshot->size() || count < last_size;
+                last_size = count;
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int i = 0; i < kThreads; ++i) {
+        writers.emplace_back([&tree, i] {
+            for (int value = i; value < kThreads * kValuesPerWriter; value += kThreads) {
+                tree.insert(value);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    REQUIRE(failures == 0);
+    tree.Publish();
+    REQUIRE(tree.Snapshot()->size() == kThreads * kValuesPerWriter);
+}
+
+void MVCCSnapshotTest(ImplType type) {
+    if (type != ImplType::kMVCC) {
+        std::cout << "Test is only designed for MVCC trees. ";
+        return;
+    }
+    {
+        // Readers see only published versions, which never change
+        MVCCTree<int> tree(4);
+        auto empty = tree.Snapshot();
+        for (int value = 0; value < 3; ++value) {
+            tree.insert(value);
+        }
+        REQUIRE(tree.size() == 3);
+        REQUIRE(tree.Snapshot()->empty());
+        REQUIRE(tree.UnpublishedUpdates() == 3);
+        tree.insert(3);
+        auto published = tree.Snapshot();
+        REQUIRE(published->size() == 4);
+        REQUIRE(tree.UnpublishedUpdates() == 0);
+        tree.erase(0);
+        tree.Publish();
+        REQUIRE(empty->empty());
+        REQUIRE(published->size() == 4);
+        REQUIRE(*published->begin() == 0);
+        REQUIRE(*tree.Snapshot()->begin() == 1);
+    }
+    CheckConcurrentSnapshots<AVLTree<int>>(100);
+    CheckConcurrentSnapshots<RBTree<int>>(100);
+    CheckConcurrentSnapshots<PersistentTreap<int>>(1);
+}
+
+void FrozenSnapshotTest(ImplType type) {
+    for (int count = 0; count < 100; ++count) {
+        // Sizes around powers of two give trees with incomplete last levels of every kind
+        int size = Random::Next(0, 1) ? Random::Next(0, 300) : (1 << Random::Next(0, 8)) - 1;
+        std::set<int> set;
+        auto tree = MakeTree<int>(type);
+        for (int i = 0; i < size; ++i) {
+            int value = Random::Next(-500, 500);
+            set.insert(value);
+            tree->insert(value);
+        }
+        auto frozen = std::make_shared<FrozenTree<int>>(*tree);
+        REQUIRE_NOTHROW(frozen->CheckLayout());
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(frozen));
+        for (int i = 0; i < 50; ++i) {
+            CheckFindAndLB<int>(set, frozen, Random::Next(-510, 510));
+        }
+        // The snapshot doesn't follow the live tree and can't be modified itself
+        tree->insert(1000);
+        tree->erase(*tree->begin());
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(frozen));
+        REQUIRE_THROWS_AS(frozen->insert(1000), std::exception);
+        REQUIRE_THROWS_AS(frozen->erase(0), std::exception);
+        REQUIRE_THROWS_AS(frozen->clear(), std::exception);
+    }
+    {
+        // Unsorted input with duplicates
+        std::vector<int> fill = {5, 3, 5, -1, 8, 3, 0};
+        std::set<int> set(fill.begin(), fill.end());
+        auto frozen = std::make_shared<FrozenTree<int>>(fill.begin(), fill.end());
+        REQUIRE_NOTHROW(frozen->CheckLayout());
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(frozen));
+    }
+}
+
+void MappedTreeTest(ImplType type) {
+    std::string path = (std::filesystem::temp_directory_path() / "trees_mapped_test.bin").string();
+    for (int count = 0; count < 50; ++count) {
+        int size = Random::Next(0, 1) ? Random::Next(0, 300) : (1 << Random::Next(0, 8)) - 1;
+        std::set<int> set;
+        auto tree = MakeTree<int>(type);
+        for (int i = 0; i < size; ++i) {
+            int value = Random::Next(-500, 500);
+            set.insert(value);
+            tree->insert(value);
+        }
+        WriteMappedTree(*tree, path);
+        auto mapped = std::make_shared<MappedTree<int>>(path);
+        REQUIRE_NOTHROW(mapped->CheckLayout());
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(mapped));
+        for (int i = 0; i < 50; ++i) {
+            CheckFindAndLB<int>(set, mapped, Random::Next(-510, 510));
+        }
+        // The mapping outlives the file name and is shared by copies
+        std::remove(path.c_str());
+        auto copy = std::make_shared<MappedTree<int>>(*mapped);
+        mapped.reset();
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(copy));
+        REQUIRE_THROWS_AS(copy->insert(1000), std::exception);
+        REQUIRE_THROWS_AS(copy->erase(0), std::exception);
+        REQUIRE_THROWS_AS(copy->clear(), std::exception);
+    }
+    if (!IsSupported<double>(type)) {
+        return;
+    }
+    {
+        auto tree = MakeTree<double>(type);
+        std::set<double> set;
+        for (int i = 0; i < 100; ++i) {
+            double value = Random::Next(-1000, 1000) / 8.0;
+            set.insert(value);
+            tree->insert(value);
+        }
+        WriteMappedTree(*tree, path);
+        auto mapped = std::make_shared<MappedTree<double>>(path);
+        REQUIRE(set == std::static_pointer_cast<ITree<double>>(mapped));
+        // Values of another type are rejected by the header
+        REQUIRE_THROWS_AS(MappedTree<int>(path), std::runtime_error);
+    }
+    {
+        // Truncated file, garbage and a missing file are rejected when opened
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(bytes.data(), bytes.size() - 1);
+        REQUIRE_THROWS_AS(MappedTree<double>(path), std::runtime_error);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << std::string(100, 'x');
+        REQUIRE_THROWS_AS(MappedTree<double>(path), std::runtime_error);
+        std::remove(path.c_str());
+        REQUIRE_THROWS_AS(MappedTree<double>(path), std::runtime_error);
+    }
+}
+
+/**
+ * Runs the checker of the tree, if its type has one
+ * @param type Type of the given tree
+ * @param tree Given tree
+ */
+void CheckStructure(ImplType type, std::shared_ptr<ITree<int>> tree) {
+    if (type == ImplType::kAVL) {
+        dynamic_cast<AVLTree<int>*>(tree.get())->CheckAVL();
+    } else if (type == ImplType::kLSM) {
+        dynamic_cast<LSMSet<int>*>(tree.get())->CheckRuns();
+    } else if (type == ImplType::kPersistent) {
+        dynamic_cast<PersistentTreap<int>*>(tree.get())->CheckTreap();
+    } else if (type == ImplType::kRB) {
+        dynamic_cast<RBTree<int>*>(tree.get())->CheckRB();
+    } else if (type == ImplType::kScapegoat) {
+        dynamic_cast<ScapegoatTree<int>*>(tree.get())->CheckScapegoat();
+    } else if (type == ImplType::kWAVL) {
+        dynamic_cast<WAVLTree<int>*>(tree.get())->CheckWAVL();
+    }
+}
+
+void SaveLoadTest(ImplType type) {
+    for (int count = 0; count < 50; ++count) {
+        // Sizes around powers of two give balanced builds with incomplete last levels
+        int size = Random::Next(0, 1) ? Random::Next(0, 300) : (1 << Random::Next(0, 10)) - 1;
+        std::set<int> set;
+        auto tree = MakeTree<int>(type);
+        for (int i = 0; i < size; ++i) {
+            int value = Random::Next(-5000, 5000);
+            set.insert(value);
+            tree->insert(value);
+        }
+        std::stringstream stream;
+        SaveTree(*tree, stream);
+        // Loading replaces the old content
+        auto loaded = MakeTree<int>(type);
+        loaded->insert(Random::Next(-5000, 5000));
+        LoadTree(*loaded, stream);
+        REQUIRE(set == loaded);
+        REQUIRE_NOTHROW(CheckStructure(type, loaded));
+        // Built trees go on working as usual
+        for (int i = 0; i < 100; ++i) {
+            int value = Random::Next(-5000, 5000);
+            if (Random::Next(0, 1)) {
+                set.insert(value);
+                loaded->insert(value);
+            } else {
+                set.erase(value);
+                loaded->erase(value);
+            }
+            CheckFindAndLB(set, loaded, value);
+        }
+        REQUIRE(set == loaded);
+        REQUIRE_NOTHROW(CheckStructure(type, loaded));
+    }
+    if (IsSupported<std::string>(type)) {
+        std::set<std::string> set;
+        auto tree = MakeTree<std::string>(type);
+        for (int i = 0; i < 500; ++i) {
+            // Both short strings and ones longer than the small string buffer
+            std::string value(Random::Next(0, 40), 'a' + Random::Next(0, 25));
+            value += std::to_string(Random::Next(0, 1000));
+            set.insert(value);
+            tree->insert(value);
+        }
+        std::stringstream stream;
+        SaveTree(*tree, stream);
+        auto loaded = MakeTree<std::string>(type);
+        LoadTree(*loaded, stream);
+        REQUIRE(set == loaded);
+    }
+    {
+        auto tree = MakeTree<int>(type);
+        for (int value = 0; value < 10; ++value) {
+            tree->insert(value);
+        }
+        std::stringstream stream;
+        SaveTree(*tree, stream);
+        std::string saved = stream.str();
+        auto loaded = MakeTree<int>(type);
+        std::stringstream truncated(saved.substr(0, saved.size() - 1));
+        REQUIRE_THROWS_AS(LoadTree(*loaded, truncated), std::runtime_error);
+        std::stringstream garbage("garbage");
+        REQUIRE_THROWS_AS(LoadTree(*loaded, garbage), std::runtime_error);
+        if (IsSupported<std::string>(type)) {
+            auto strings = MakeTree<std::string>(type);
+            std::stringstream other_type(saved);
+            REQUIRE_THROWS_AS(LoadTree(*strings, other_type), std::runtime_error);
+        }
+        REQUIRE_THROWS_AS(loaded->build_from_sorted({1, 3, 2}), std::invalid_argument);
+    }
+}
+
+void DurableTreeTest(ImplType type) {
+    auto directory = std::filesystem::temp_directory_path() / "trees_durable_test";
+    auto crashed = std::filesystem::temp_directory_path() / "trees_durable_test_crashed";
+    std::filesystem::remove_all(directory);
+    auto make_tree = [type] { return MakeTree<int>(type); };
+    std::set<int> set;
+    {
+        auto tree = std::make_shared<DurableTree<int>>(directory.string(), make_tree, 8, 50);
+        auto shared = std::static_pointer_cast<ITree<int>>(tree);
+        for (int i = 0; i < 1000; ++i) {
+            int value = Random::Next(-100, 100);
+            if (Random::Next(0, 2)) {
+                set.insert(value);
+                tree->insert(value);
+            } else {
+                set.erase(value);
+                tree->erase(value);
+            }
+            REQUIRE(tree->UncommittedUpdates() < 8);
+            REQUIRE(tree->LoggedRecords() < 50);
+            if (i % 250 == 0) {
+                tree.reset();
+                shared.reset();
+                tree = std::make_shared<DurableTree<int>>(directory.string(), make_tree, 8, 50);
+                shared = tree;
+                REQUIRE(set == shared);
+            }
+        }
+        // A crash keeps committed updates only
+        tree->Commit();
+        std::filesystem::remove_all(crashed);
+        std::filesystem::copy(directory, crashed);
+        for (int value = 1000; value < 1005; ++value) {
+            tree->insert(value);
+        }
+        REQUIRE(tree->UncommittedUpdates() == 5);
+        auto recovered = std::make_shared<DurableTree<int>>(crashed.string(), make_tree);
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(recovered));
+        for (int value = 1000; value < 1005; ++value) {
+            set.insert(value);
+        }
+        REQUIRE(set == shared);
+    }
+    {
+        // Torn record at the end of the log is cut off
+        std::ofstream(directory / "log", std::ios::binary | std::ios::app) << '\x01' << "ab";
+        auto size = std::filesystem::file_size(directory / "log");
+        auto tree = std::make_shared<DurableTree<int>>(directory.string(), make_tree);
+        REQUIRE(std::filesystem::file_size(directory / "log") == size - 3);
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+        tree->clear();
+        set.clear();
+        tree->insert(7);
+        set.insert(7);
+    }
+    {
+        auto tree = std::make_shared<DurableTree<int>>(directory.string(), make_tree);
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+        // Built trees are checkpointed instead of logged
+        tree->build_from_sorted({-3, 0, 5, 8});
+        REQUIRE(tree->LoggedRecords() == 0);
+        set = {-3, 0, 5, 8};
+    }
+    {
+        auto tree = std::make_shared<DurableTree<int>>(directory.string(), make_tree);
+        REQUIRE(set == std::static_pointer_cast<ITree<int>>(tree));
+        REQUIRE_THROWS_AS(DurableTree<double>(directory.string()), std::runtime_error);
+    }
+    if (IsSupported<std::string>(type)) {
+        std::filesystem::remove_all(directory);
+        auto make_strings = [type] { return MakeTree<std::string>(type); };
+        std::set<std::string> strings;
+        {
+            DurableTree<std::string> tree(directory.string(), make_strings, 4, 10);
+            for (int i = 0; i < 30; ++i) {
+                std::string value(Random::Next(0, 20), 'a' + Random::Next(0, 25));
+                strings.insert(value);
+                tree.insert(value);
+            }
+        }
+        auto tree = std::make_shared<DurableTree<std::string>>(directory.string(), make_strings);
+        REQUIRE(strings == std::static_pointer_cast<ITree<std::string>>(tree));
+    }
+    std::filesystem::remove_all(directory);
+    std::filesystem::remove_all(crashed);
+}
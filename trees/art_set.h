@@ -0,0 +1,1200 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+template <class T>
+class ITree;
+
+/**
+ * Value types with a binary-comparable byte encoding:
+ * integral types other than bool and 'std::string'
+ */
+template <class T>
+struct IsARTKey
+    : std::bool_constant<(std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+                         std::is_same_v<T, std::string>> {};
+
+/**
+ * Adaptive radix tree (Leis et al.): a trie over the bytes of the key
+ * with inner nodes of 4, 16, 48 and 256 children and path compression.
+ * Integers are stored big-endian with the sign bit flipped and strings byte by byte,
+ * so the byte order of the keys matches operator<. A string which is a prefix of other keys
+ * is kept in the inner node where it ends.
+ *
+ * Leaves are also linked into a sorted list, which is used for iteration and to step
+ * from a subtree to the next key in lower_bound(). The list is owned the same way
+ * as the bottom level of the skip list: the forward link owns the next leaf,
+ * so a leaf erased while an iterator points to it still leads to the rest of the list.
+ */
+template <class T>
+class ARTSet : public ITree<T> {
+    static_assert(IsARTKey<T>::value, "ARTSet supports only integral and string values");
+
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// Number of prefix bytes stored in an inner node, the rest is read from a leaf
+    static constexpr uint32_t kMaxPrefix = 8;
+
+    enum class NodeType : uint8_t { kLeaf, kNode4, kNode16, kNode48, kNode256 };
+
+    struct NodeBase {
+        explicit NodeBase(NodeType type) : type_(type) {
+        }
+
+        NodeType type_;
+    };
+
+    /**
+     * Leaf holding a value. Sentinels (head and end of the list) have no value:
+     * end is the only leaf without a forward link and head is the only one without a backward one
+     */
+    struct Leaf : NodeBase {
+        Leaf() : NodeBase(NodeType::kLeaf) {
+        }
+        explicit Leaf(const T& value) : NodeBase(NodeType::kLeaf), has_value_(true), value_(value) {
+        }
+
+        bool has_value_ = false;
+        /// Number of owners: the previous leaf and iterators
+        uint32_t links_ = 1;
+        Leaf* prev_ = nullptr;
+        Leaf* next_ = nullptr;
+        T value_{};
+    };
+
+    struct InnerNode : NodeBase {
+        explicit InnerNode(NodeType type) : NodeBase(type) {
+        }
+
+        uint16_t count_ = 0;
+        /// Length of the compressed path, only the first 'kMaxPrefix' bytes are stored
+        uint32_t prefix_len_ = 0;
+        uint8_t prefix_[kMaxPrefix]{};
+        /// Leaf with the key ending in this node, strings only
+        Leaf* value_ = nullptr;
+    };
+
+    /// Up to 4 children with sorted keys
+    struct Node4 : InnerNode {
+        Node4() : InnerNode(NodeType::kNode4) {
+        }
+
+        uint8_t keys_[4]{};
+        NodeBase* children_[4]{};
+    };
+
+    /// Up to 16 children with sorted keys
+    struct Node16 : InnerNode {
+        Node16() : InnerNode(NodeType::kNode16) {
+        }
+
+        uint8_t keys_[16]{};
+        NodeBase* children_[16]{};
+    };
+
+    /// Up to 48 children, indexed by the key byte through 'child_index_' (0 stands for none)
+    struct Node48 : InnerNode {
+        Node48() : InnerNode(NodeType::kNode48) {
+        }
+
+        uint8_t child_index_[256]{};
+        NodeBase* children_[48]{};
+    };
+
+    /// Child for every key byte
+    struct Node256 : InnerNode {
+        Node256() : InnerNode(NodeType::kNode256) {
+        }
+
+        NodeBase* children_[256]{};
+    };
+
+    ARTSet() {
+        Init();
+    }
+
+    template <class InitIterator>
+    ARTSet(InitIterator begin, InitIterator end) : ARTSet() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    ARTSet(std::initializer_list<T> list) : ARTSet() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    ARTSet(const ARTSet& other) : ARTSet() {
+        for (const T& value : other) {
+            Insert(value);
+        }
+    }
+    ARTSet(ARTSet&& other) noexcept : ARTSet() {
+        Swap(other);
+    }
+    ARTSet(std::shared_ptr<ITree<T>> other) : ARTSet(*dynamic_cast<ARTSet<T>*>(other.get())) {
+    }
+    ARTSet& operator=(const ARTSet& other) {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Clear();
+        for (const T& value : other) {
+            Insert(value);
+        }
+        return *this;
+    }
+    ARTSet& operator=(ARTSet&& other) noexcept {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Swap(other);
+        return *this;
+    }
+
+    ~ARTSet() override {
+        FreeNode(root_);
+        Release(head_);
+        Release(end_);
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !size_;
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        if (InsertImpl(value)) {
+            ++size_;
+        }
+    }
+    void Erase(const T& value) override {
+        if (EraseImpl(value)) {
+            --size_;
+        }
+    }
+
+    void Clear() override {
+        FreeNode(root_);
+        Release(head_);
+        Release(end_);
+        Init();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type convertible to 'std::string_view' for strings or to T for integers
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        if (EraseImpl(key)) {
+            --size_;
+        }
+    }
+
+private:
+    NodeBase* root_;
+    Leaf* head_;
+    Leaf* end_;
+    size_t size_;
+
+    /// Bytes of an integer key: big-endian with the sign bit flipped
+    class IntegerKey {
+    public:
+        explicit IntegerKey(T value) {
+            using Unsigned = std::make_unsigned_t<T>;
+            auto bits = static_cast<Unsigned>(value);
+            if constexpr (std::is_signed_v<T>) {
+                bits ^= static_cast<Unsigned>(Unsigned(1) << (8 * sizeof(T) - 1));
+            }
+            for (size_t i = sizeof(T); i-- > 0;) {
+                bytes_[i] = static_cast<uint8_t>(bits);
+                bits = static_cast<Unsigned>(bits >> 8);
+            }
+        }
+
+        uint8_t operator[](size_t index) const {
+            return bytes_[index];
+        }
+        [[nodiscard]] static constexpr size_t Size() {
+            return sizeof(T);
+        }
+
+    private:
+        uint8_t bytes_[sizeof(T)];
+    };
+
+    /// Bytes of a string key, the key must outlive it
+    class StringKey {
+    public:
+        explicit StringKey(std::string_view view) : view_(view) {
+        }
+
+        uint8_t operator[](size_t index) const {
+            return static_cast<uint8_t>(view_[index]);
+        }
+        [[nodiscard]] size_t Size() const {
+            return view_.size();
+        }
+
+    private:
+        std::string_view view_;
+    };
+
+    using Key = std::conditional_t<std::is_integral_v<T>, IntegerKey, StringKey>;
+
+    template <class K>
+    static Key MakeKey(const K& key) {
+        if constexpr (std::is_integral_v<T>) {
+            return Key(static_cast<T>(key));
+        } else {
+            return Key(std::string_view(key));
+        }
+    }
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class ARTSetItImpl : public BaseImpl {
+    private:
+        Leaf* it_;
+
+    public:
+        ARTSetItImpl() = delete;
+
+        explicit ARTSetItImpl(Leaf* ptr) : it_(ptr) {
+            ++it_->links_;
+        }
+
+        ARTSetItImpl(const ARTSetItImpl& other) : it_(other.it_) {
+            ++it_->links_;
+        }
+
+        ~ARTSetItImpl() override {
+            Release(it_);
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<ARTSetItImpl>(*this);
+        }
+
+        void Increment() override {
+            Leaf* next = it_->next_;
+            if (!next) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            ++next->links_;
+            Release(it_);
+            it_ = next;
+        }
+
+        void Decrement() override {
+            Leaf* prev = it_->prev_;
+            if (!prev || !prev->prev_) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            ++prev->links_;
+            Release(it_);
+            it_ = prev;
+        }
+
+        const T Dereferencing() const override {
+            if (!it_->has_value_) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return it_->value_;
+        }
+
+        const T* Arrow() const override {
+            if (!it_->has_value_) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &it_->value_;
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<ARTSetItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<ARTSetItImpl>(head_->next_);
+    }
+
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<ARTSetItImpl>(end_);
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    /**
+     * Drops one reference to the leaf.
+     * Leaves without owners are destroyed along with the rest of the list they own.
+     * It works iteratively, so long lists don't overflow the stack.
+     * @param leaf Leaf to release
+     */
+    static void Release(Leaf* leaf) {
+        while (leaf && --leaf->links_ == 0) {
+            Leaf* next = leaf->next_;
+            delete leaf;
+            leaf = next;
+        }
+    }
+
+    /**
+     * Destroys inner nodes of the subtree, leaves are owned by the list
+     * @param node Root of the subtree
+     */
+    static void FreeNode(NodeBase* node) {
+        if (!node || node->type_ == NodeType::kLeaf) {
+            return;
+        }
+        ForEachChild(static_cast<InnerNode*>(node), [](uint8_t, NodeBase* child) {
+            FreeNode(child);
+        });
+        DeleteInner(static_cast<InnerNode*>(node));
+    }
+
+    static void DeleteInner(InnerNode* node) {
+        switch (node->type_) {
+            case NodeType::kNode4:
+                delete static_cast<Node4*>(node);
+                break;
+            case NodeType::kNode16:
+                delete static_cast<Node16*>(node);
+                break;
+            case NodeType::kNode48:
+                delete static_cast<Node48*>(node);
+                break;
+            default:
+                delete static_cast<Node256*>(node);
+        }
+    }
+
+    void Init() {
+        root_ = nullptr;
+        head_ = new Leaf();
+        end_ = new Leaf();
+        head_->next_ = end_;
+        // One reference from the head and one from the tree itself
+        ++end_->links_;
+        end_->prev_ = head_;
+        size_ = 0;
+    }
+
+    void Swap(ARTSet& other) {
+        std::swap(root_, other.root_);
+        std::swap(head_, other.head_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+    }
+
+    /**
+     * Calls function(byte, child) for every child in the key order
+     * @param node Inner node
+     * @param function Functor to call
+     */
+    template <class Function>
+    static void ForEachChild(InnerNode* node, Function function) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                for (uint16_t i = 0; i < casted->count_; ++i) {
+                    function(casted->keys_[i], casted->children_[i]);
+                }
+                break;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                for (uint16_t i = 0; i < casted->count_; ++i) {
+                    function(casted->keys_[i], casted->children_[i]);
+                }
+                break;
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                for (int byte = 0; byte < 256; ++byte) {
+                    if (casted->child_index_[byte]) {
+                        function(static_cast<uint8_t>(byte),
+                                 casted->children_[casted->child_index_[byte] - 1]);
+                    }
+                }
+                break;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                for (int byte = 0; byte < 256; ++byte) {
+                    if (casted->children_[byte]) {
+                        function(static_cast<uint8_t>(byte), casted->children_[byte]);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @param node Inner node
+     * @param byte Key byte
+     * @return Link to the child for the byte, nullptr if there is none
+     */
+    static NodeBase** FindChild(InnerNode* node, uint8_t byte) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                for (uint16_t i = 0; i < casted->count_; ++i) {
+                    if (casted->keys_[i] == byte) {
+                        return &casted->children_[i];
+                    }
+                }
+                return nullptr;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                auto end = casted->keys_ + casted->count_;
+                auto pos = std::lower_bound(casted->keys_, end, byte);
+                if (pos == end || *pos != byte) {
+                    return nullptr;
+                }
+                return &casted->children_[pos - casted->keys_];
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                uint8_t index = casted->child_index_[byte];
+                return index ? &casted->children_[index - 1] : nullptr;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                return casted->children_[byte] ? &casted->children_[byte] : nullptr;
+            }
+        }
+    }
+
+    /**
+     * @param node Inner node
+     * @param byte Key byte
+     * @return Child with the least key byte greater than the given one, nullptr if there is none
+     */
+    static NodeBase* ChildAfter(InnerNode* node, uint8_t byte) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                for (uint16_t i = 0; i < casted->count_; ++i) {
+                    if (casted->keys_[i] > byte) {
+                        return casted->children_[i];
+                    }
+                }
+                return nullptr;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                auto end = casted->keys_ + casted->count_;
+                auto pos = std::upper_bound(casted->keys_, end, byte);
+                return pos == end ? nullptr : casted->children_[pos - casted->keys_];
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                for (int next = byte + 1; next < 256; ++next) {
+                    if (casted->child_index_[next]) {
+                        return casted->children_[casted->child_index_[next] - 1];
+                    }
+                }
+                return nullptr;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                for (int next = byte + 1; next < 256; ++next) {
+                    if (casted->children_[next]) {
+                        return casted->children_[next];
+                    }
+                }
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     * @param node Inner node
+     * @param byte Key byte
+     * @return Child with the greatest key byte less than the given one, nullptr if there is none
+     */
+    static NodeBase* ChildBefore(InnerNode* node, uint8_t byte) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                for (uint16_t i = casted->count_; i-- > 0;) {
+                    if (casted->keys_[i] < byte) {
+                        return casted->children_[i];
+                    }
+                }
+                return nullptr;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                auto pos = std::lower_bound(casted->keys_, casted->keys_ + casted->count_, byte);
+                return pos == casted->keys_ ? nullptr : casted->children_[pos - casted->keys_ - 1];
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                for (int prev = byte - 1; prev >= 0; --prev) {
+                    if (casted->child_index_[prev]) {
+                        return casted->children_[casted->child_index_[prev] - 1];
+                    }
+                }
+                return nullptr;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                for (int prev = byte - 1; prev >= 0; --prev) {
+                    if (casted->children_[prev]) {
+                        return casted->children_[prev];
+                    }
+                }
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     * @param node Inner node
+     * @return Child with the greatest key byte, nullptr if there are no children
+     */
+    static NodeBase* LastChild(InnerNode* node) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                return casted->count_ ? casted->children_[casted->count_ - 1] : nullptr;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                return casted->count_ ? casted->children_[casted->count_ - 1] : nullptr;
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                for (int byte = 255; byte >= 0; --byte) {
+                    if (casted->child_index_[byte]) {
+                        return casted->children_[casted->child_index_[byte] - 1];
+                    }
+                }
+                return nullptr;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                for (int byte = 255; byte >= 0; --byte) {
+                    if (casted->children_[byte]) {
+                        return casted->children_[byte];
+                    }
+                }
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     * @param node Root of a non-empty subtree
+     * @return Leaf with the least key in the subtree
+     */
+    static Leaf* Minimum(NodeBase* node) {
+        while (node->type_ != NodeType::kLeaf) {
+            auto inner = static_cast<InnerNode*>(node);
+            if (inner->value_) {
+                return inner->value_;
+            }
+            NodeBase** zero = FindChild(inner, 0);
+            node = zero ? *zero : ChildAfter(inner, 0);
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    /**
+     * @param node Root of a non-empty subtree
+     * @return Leaf with the greatest key in the subtree
+     */
+    static Leaf* Maximum(NodeBase* node) {
+        while (node->type_ != NodeType::kLeaf) {
+            auto inner = static_cast<InnerNode*>(node);
+            NodeBase* last = LastChild(inner);
+            if (!last) {
+                return inner->value_;
+            }
+            node = last;
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    /**
+     * Moves the header of an inner node to a node of another size
+     * @param from Node to take the header from
+     * @param to Node to copy the header to
+     */
+    static void CopyHeader(const InnerNode* from, InnerNode* to) {
+        to->count_ = from->count_;
+        to->prefix_len_ = from->prefix_len_;
+        std::memcpy(to->prefix_, from->prefix_, kMaxPrefix);
+        to->value_ = from->value_;
+    }
+
+    /**
+     * Adds a child to an inner node which has no child for the byte,
+     * a full node is replaced with a larger one
+     * @param link Link to the node
+     * @param node Inner node
+     * @param byte Key byte
+     * @param child New child
+     */
+    static void AddChild(NodeBase** link, InnerNode* node, uint8_t byte, NodeBase* child) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                if (casted->count_ < 4) {
+                    InsertSorted(casted->keys_, casted->children_, casted->count_, byte, child);
+                    return;
+                }
+                auto grown = new Node16();
+                CopyHeader(casted, grown);
+                std::copy(casted->keys_, casted->keys_ + 4, grown->keys_);
+                std::copy(casted->children_, casted->children_ + 4, grown->children_);
+                delete casted;
+                *link = grown;
+                InsertSorted(grown->keys_, grown->children_, grown->count_, byte, child);
+                return;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                if (casted->count_ < 16) {
+                    InsertSorted(casted->keys_, casted->children_, casted->count_, byte, child);
+                    return;
+                }
+                auto grown = new Node48();
+                CopyHeader(casted, grown);
+                for (uint8_t i = 0; i < 16; ++i) {
+                    grown->child_index_[casted->keys_[i]] = i + 1;
+                    grown->children_[i] = casted->children_[i];
+                }
+                delete casted;
+                *link = grown;
+                grown->child_index_[byte] = 17;
+                grown->children_[16] = child;
+                ++grown->count_;
+                return;
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                if (casted->count_ < 48) {
+                    uint8_t slot = 0;
+                    while (casted->children_[slot]) {
+                        ++slot;
+                    }
+                    casted->child_index_[byte] = slot + 1;
+                    casted->children_[slot] = child;
+                    ++casted->count_;
+                    return;
+                }
+                auto grown = new Node256();
+                CopyHeader(casted, grown);
+                for (int next = 0; next < 256; ++next) {
+                    if (casted->child_index_[next]) {
+                        grown->children_[next] = casted->children_[casted->child_index_[next] - 1];
+                    }
+                }
+                delete casted;
+                *link = grown;
+                grown->children_[byte] = child;
+                ++grown->count_;
+                return;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                casted->children_[byte] = child;
+                ++casted->count_;
+            }
+        }
+    }
+
+    /**
+     * Inserts a child into sorted arrays of Node4 or Node16, which have room for it
+     */
+    static void InsertSorted(uint8_t* keys, NodeBase** children, uint16_t& count, uint8_t byte,
+                             NodeBase* child) {
+        uint16_t pos = count;
+        while (pos > 0 && keys[pos - 1] > byte) {
+            keys[pos] = keys[pos - 1];
+            children[pos] = children[pos - 1];
+            --pos;
+        }
+        keys[pos] = byte;
+        children[pos] = child;
+        ++count;
+    }
+
+    /**
+     * Removes the child for the byte from an inner node.
+     * Underfull nodes are replaced with smaller ones, a node left with a single entry
+     * is merged into it.
+     * @param link Link to the node
+     * @param node Inner node
+     * @param byte Key byte of an existing child
+     */
+    static void RemoveChild(NodeBase** link, InnerNode* node, uint8_t byte) {
+        switch (node->type_) {
+            case NodeType::kNode4: {
+                auto casted = static_cast<Node4*>(node);
+                RemoveSorted(casted->keys_, casted->children_, casted->count_, byte);
+                Collapse(link, casted);
+                return;
+            }
+            case NodeType::kNode16: {
+                auto casted = static_cast<Node16*>(node);
+                RemoveSorted(casted->keys_, casted->children_, casted->count_, byte);
+                if (casted->count_ > 3) {
+                    return;
+                }
+                auto shrunk = new Node4();
+                CopyHeader(casted, shrunk);
+                std::copy(casted->keys_, casted->keys_ + casted->count_, shrunk->keys_);
+                std::copy(casted->children_, casted->children_ + casted->count_,
+                          shrunk->children_);
+                delete casted;
+                *link = shrunk;
+                return;
+            }
+            case NodeType::kNode48: {
+                auto casted = static_cast<Node48*>(node);
+                casted->children_[casted->child_index_[byte] - 1] = nullptr;
+                casted->child_index_[byte] = 0;
+                if (--casted->count_ > 12) {
+                    return;
+                }
+                auto shrunk = new Node16();
+                CopyHeader(casted, shrunk);
+                shrunk->count_ = 0;
+                ForEachChild(casted, [shrunk](uint8_t key, NodeBase* child) {
+                    shrunk->keys_[shrunk->count_] = key;
+                    shrunk->children_[shrunk->count_++] = child;
+                });
+                delete casted;
+                *link = shrunk;
+                return;
+            }
+            default: {
+                auto casted = static_cast<Node256*>(node);
+                casted->children_[byte] = nullptr;
+                if (--casted->count_ > 37) {
+                    return;
+                }
+                auto shrunk = new Node48();
+                CopyHeader(casted, shrunk);
+                shrunk->count_ = 0;
+                ForEachChild(casted, [shrunk](uint8_t key, NodeBase* child) {
+                    shrunk->child_index_[key] = ++shrunk->count_;
+                    shrunk->children_[shrunk->count_ - 1] = child;
+                });
+                delete casted;
+                *link = shrunk;
+            }
+        }
+    }
+
+    static void RemoveSorted(uint8_t* keys, NodeBase** children, uint16_t& count, uint8_t byte) {
+        uint16_t pos = 0;
+        while (keys[pos] != byte) {
+            ++pos;
+        }
+        for (--count; pos < count; ++pos) {
+            keys[pos] = keys[pos + 1];
+            children[pos] = children[pos + 1];
+        }
+    }
+
+    /**
+     * Replaces a Node4 holding a single entry with this entry.
+     * The only child inherits the path of the node, so the path stays compressed.
+     * @param link Link to the node
+     * @param node Node to check
+     */
+    static void Collapse(NodeBase** link, Node4* node) {
+        if (node->count_ == 0) {
+            *link = node->value_;
+        } else if (node->count_ == 1 && !node->value_) {
+            NodeBase* child = node->children_[0];
+            if (child->type_ != NodeType::kLeaf) {
+                auto inner = static_cast<InnerNode*>(child);
+                uint8_t prefix[kMaxPrefix];
+                uint32_t len = 0;
+                for (; len < std::min(node->prefix_len_, kMaxPrefix); ++len) {
+                    prefix[len] = node->prefix_[len];
+                }
+                if (len < kMaxPrefix) {
+                    prefix[len++] = node->keys_[0];
+                }
+                for (uint32_t i = 0; len < kMaxPrefix && i < inner->prefix_len_; ++i) {
+                    prefix[len++] = inner->prefix_[i];
+                }
+                std::memcpy(inner->prefix_, prefix, len);
+                inner->prefix_len_ += node->prefix_len_ + 1;
+            }
+            *link = child;
+        } else {
+            return;
+        }
+        delete node;
+    }
+
+    /**
+     * Byte of the compressed path, bytes past 'kMaxPrefix' are read from the least leaf
+     * @param node Inner node
+     * @param depth Depth the path of the node starts at
+     * @param index Index in the path
+     * @return Byte of the path
+     */
+    static uint8_t PrefixByte(InnerNode* node, size_t depth, uint32_t index) {
+        if (index < kMaxPrefix) {
+            return node->prefix_[index];
+        }
+        return MakeKey(Minimum(node)->value_)[depth + index];
+    }
+
+    /**
+     * Compares the key with the whole compressed path of the node
+     * @param node Inner node
+     * @param key Key to compare
+     * @param depth Depth the path of the node starts at
+     * @return Length of the common part of the path and the key
+     */
+    static uint32_t PrefixMismatch(InnerNode* node, const Key& key, size_t depth) {
+        uint32_t inline_len = std::min(node->prefix_len_, kMaxPrefix);
+        uint32_t index = 0;
+        for (; index < inline_len; ++index) {
+            if (depth + index == key.Size() || node->prefix_[index] != key[depth + index]) {
+                return index;
+            }
+        }
+        if (index < node->prefix_len_) {
+            Key least = MakeKey(Minimum(node)->value_);
+            for (; index < node->prefix_len_; ++index) {
+                if (depth + index == key.Size() || least[depth + index] != key[depth + index]) {
+                    return index;
+                }
+            }
+        }
+        return index;
+    }
+
+    /**
+     * Descends to the only leaf which may hold the key. Only the stored part of every
+     * compressed path is checked, the leaf is compared with the key in the end.
+     */
+    template <class K>
+    Leaf* FindLeaf(const K& value) const {
+        Key key = MakeKey(value);
+        NodeBase* node = root_;
+        size_t depth = 0;
+        while (node) {
+            if (node->type_ == NodeType::kLeaf) {
+                auto leaf = static_cast<Leaf*>(node);
+                return leaf->value_ == value ? leaf : nullptr;
+            }
+            auto inner = static_cast<InnerNode*>(node);
+            uint32_t inline_len = std::min(inner->prefix_len_, kMaxPrefix);
+            for (uint32_t i = 0; i < inline_len; ++i) {
+                if (depth + i >= key.Size() || inner->prefix_[i] != key[depth + i]) {
+                    return nullptr;
+                }
+            }
+            depth += inner->prefix_len_;
+            if (depth >= key.Size()) {
+                Leaf* leaf = depth == key.Size() ? inner->value_ : nullptr;
+                return leaf && leaf->value_ == value ? leaf : nullptr;
+            }
+            NodeBase** child = FindChild(inner, key[depth]);
+            node = child ? *child : nullptr;
+            ++depth;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @return First leaf with the value not less than the key, end sentinel if there is none
+     */
+    template <class K>
+    Leaf* LowerBoundLeaf(const K& value) const {
+        Key key = MakeKey(value);
+        NodeBase* node = root_;
+        size_t depth = 0;
+        if (!node) {
+            return end_;
+        }
+        while (node->type_ != NodeType::kLeaf) {
+            auto inner = static_cast<InnerNode*>(node);
+            uint32_t common = PrefixMismatch(inner, key, depth);
+            if (common < inner->prefix_len_) {
+                // The key either ends inside the path or differs from it
+                if (depth + common == key.Size() ||
+                    key[depth + common] < PrefixByte(inner, depth, common)) {
+                    return Minimum(inner);
+                }
+                return Maximum(inner)->next_;
+            }
+            depth += inner->prefix_len_;
+            if (depth == key.Size()) {
+                return Minimum(inner);
+            }
+            NodeBase** child = FindChild(inner, key[depth]);
+            if (!child) {
+                NodeBase* after = ChildAfter(inner, key[depth]);
+                return after ? Minimum(after) : Maximum(inner)->next_;
+            }
+            node = *child;
+            ++depth;
+        }
+        auto leaf = static_cast<Leaf*>(node);
+        return leaf->value_ < value ? leaf->next_ : leaf;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        Leaf* leaf = FindLeaf(key);
+        return std::make_shared<ARTSetItImpl>(leaf ? leaf : end_);
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        return std::make_shared<ARTSetItImpl>(LowerBoundLeaf(key));
+    }
+
+    /**
+     * Inserts the value unless it is already in the tree. The new leaf is linked into the list
+     * after the greatest leaf of the deepest node on the path which has entries less than it.
+     * @param value Value to insert
+     * @return True if the value was inserted
+     */
+    bool InsertImpl(const T& value) {
+        Key key = MakeKey(value);
+        NodeBase** link = &root_;
+        size_t depth = 0;
+        InnerNode* lesser = nullptr;
+        uint8_t lesser_byte = 0;
+        while (true) {
+            NodeBase* node = *link;
+            if (!node) {
+                *link = LinkLeaf(value, head_);
+                return true;
+            }
+            if (node->type_ == NodeType::kLeaf) {
+                // Two leaves are split by a new node holding their common path
+                auto other = static_cast<Leaf*>(node);
+                if (other->value_ == value) {
+                    return false;
+                }
+                Key other_key = MakeKey(other->value_);
+                uint32_t common = 0;
+                while (depth + common < key.Size() && depth + common < other_key.Size() &&
+                       key[depth + common] == other_key[depth + common]) {
+                    ++common;
+                }
+                Leaf* leaf = LinkLeaf(value, other->value_ < value
+                                                 ? other
+                                                 : Predecessor(lesser, lesser_byte));
+                auto parent = new Node4();
+                SetPrefix(parent, key, depth, common);
+                depth += common;
+                HangEntry(parent, other, other_key, depth);
+                HangEntry(parent, leaf, key, depth);
+                *link = parent;
+                return true;
+            }
+            auto inner = static_cast<InnerNode*>(node);
+            uint32_t common = PrefixMismatch(inner, key, depth);
+            if (common < inner->prefix_len_) {
+                // The path of the node is split by a new node holding its common part
+                uint8_t byte = PrefixByte(inner, depth, common);
+                bool after = depth + common < key.Size() && byte < key[depth + common];
+                Leaf* leaf =
+                    LinkLeaf(value, after ? Maximum(inner) : Predecessor(lesser, lesser_byte));
+                auto parent = new Node4();
+                SetPrefix(parent, key, depth, common);
+                uint8_t prefix[kMaxPrefix];
+                uint32_t rest = inner->prefix_len_ - common - 1;
+                for (uint32_t i = 0; i < std::min(rest, kMaxPrefix); ++i) {
+                    prefix[i] = PrefixByte(inner, depth, common + 1 + i);
+                }
+                std::memcpy(inner->prefix_, prefix, std::min(rest, kMaxPrefix));
+                inner->prefix_len_ = rest;
+                parent->keys_[0] = byte;
+                parent->children_[0] = inner;
+                parent->count_ = 1;
+                HangEntry(parent, leaf, key, depth + common);
+                *link = parent;
+                return true;
+            }
+            depth += inner->prefix_len_;
+            if (depth == key.Size()) {
+                if (inner->value_) {
+                    return false;
+                }
+                inner->value_ = LinkLeaf(value, Predecessor(lesser, lesser_byte));
+                return true;
+            }
+            uint8_t byte = key[depth];
+            if (inner->value_ || ChildBefore(inner, byte)) {
+                lesser = inner;
+                lesser_byte = byte;
+            }
+            NodeBase** child = FindChild(inner, byte);
+            if (!child) {
+                AddChild(link, inner, byte, LinkLeaf(value, Predecessor(lesser, lesser_byte)));
+                return true;
+            }
+            link = child;
+            ++depth;
+        }
+    }
+
+    /**
+     * Makes a new leaf and links it into the list
+     * @param value Value of the leaf
+     * @param prev Leaf to link the new one after
+     * @return New leaf
+     */
+    static Leaf* LinkLeaf(const T& value, Leaf* prev) {
+        auto leaf = new Leaf(value);
+        // The new leaf takes over the reference to its successor from the predecessor
+        leaf->prev_ = prev;
+        leaf->next_ = prev->next_;
+        prev->next_ = leaf;
+        leaf->next_->prev_ = leaf;
+        return leaf;
+    }
+
+    /**
+     * @param node Inner node with entries less than the byte, nullptr if there is none
+     * @param byte Key byte
+     * @return Greatest leaf of the node less than the byte, head sentinel for no node
+     */
+    Leaf* Predecessor(InnerNode* node, uint8_t byte) const {
+        if (!node) {
+            return head_;
+        }
+        NodeBase* before = ChildBefore(node, byte);
+        return before ? Maximum(before) : node->value_;
+    }
+
+    static void SetPrefix(InnerNode* node, const Key& key, size_t depth, uint32_t len) {
+        node->prefix_len_ = len;
+        for (uint32_t i = 0; i < std::min(len, kMaxPrefix); ++i) {
+            node->prefix_[i] = key[depth + i];
+        }
+    }
+
+    /**
+     * Adds a leaf to a new Node4 as a child or as the key ending in the node
+     */
+    static void HangEntry(Node4* node, Leaf* leaf, const Key& key, size_t depth) {
+        if (depth == key.Size()) {
+            node->value_ = leaf;
+        } else {
+            InsertSorted(node->keys_, node->children_, node->count_, key[depth], leaf);
+        }
+    }
+
+    template <class K>
+    bool EraseImpl(const K& value) {
+        Key key = MakeKey(value);
+        NodeBase** link = &root_;
+        NodeBase** parent_link = nullptr;
+        size_t depth = 0;
+        Leaf* leaf = nullptr;
+        while (*link) {
+            NodeBase* node = *link;
+            if (node->type_ == NodeType::kLeaf) {
+                leaf = static_cast<Leaf*>(node);
+                if (!(leaf->value_ == value)) {
+                    return false;
+                }
+                if (parent_link) {
+                    RemoveChild(parent_link, static_cast<InnerNode*>(*parent_link),
+                                key[depth - 1]);
+                } else {
+                    root_ = nullptr;
+                }
+                break;
+            }
+            auto inner = static_cast<InnerNode*>(node);
+            uint32_t inline_len = std::min(inner->prefix_len_, kMaxPrefix);
+            for (uint32_t i = 0; i < inline_len; ++i) {
+                if (depth + i >= key.Size() || inner->prefix_[i] != key[depth + i]) {
+                    return false;
+                }
+            }
+            depth += inner->prefix_len_;
+            if (depth >= key.Size()) {
+                leaf = depth == key.Size() ? inner->value_ : nullptr;
+                if (!leaf || !(leaf->value_ == value)) {
+                    return false;
+                }
+                inner->value_ = nullptr;
+                if (inner->type_ == NodeType::kNode4) {
+                    Collapse(link, static_cast<Node4*>(inner));
+                }
+                break;
+            }
+            NodeBase** child = FindChild(inner, key[depth]);
+            if (!child) {
+                return false;
+            }
+            parent_link = link;
+            link = child;
+            ++depth;
+        }
+        if (!leaf) {
+            return false;
+        }
+        // Erased leaf keeps owning its successor, the predecessor gets one more reference
+        Leaf* next = leaf->next_;
+        ++next->links_;
+        next->prev_ = leaf->prev_;
+        leaf->prev_->next_ = next;
+        Release(leaf);
+        return true;
+    }
+};
@@ -1,541 +1,687 @@
-#pragma once
-#include <initializer_list>
-#include <memory>
-
-template <class T>
-class ITree;
-
-template <class T>
-class AVLTree : public ITree<T> {
-private:
-    typedef typename ITree<T>::ITreeItImpl BaseImpl;
-
-public:
-    struct Node {
-        Node() {
-            left_ = nullptr;
-            right_ = nullptr;
-            parent_ = std::weak_ptr<Node>();
-            value_ = std::nullopt;
-            height_ = 1;
-        }
-
-        explicit Node(const T &value) : value_(value) {
-            left_ = nullptr;
-            right_ = nullptr;
-            parent_ = std::weak_ptr<Node>();
-            height_ = 1;
-        }
-
-        Node(const Node &other) : value_(other.value_) {
-            left_ = other.left_;
-            right_ = other.right_;
-            parent_ = other.parent_;
-            height_ = other.height_;
-        }
-
-        std::shared_ptr<Node> left_;
-        std::shared_ptr<Node> right_;
-        std::weak_ptr<Node> parent_;
-        std::optional<T> value_;
-        uint8_t height_;
-    };
-
-    AVLTree() {
-        end_ = std::make_shared<Node>();
-        begin_ = end_;
-        root_ = end_;
-        size_ = 0;
-    }
-
-    template <class InitIterator>
-    AVLTree(InitIterator begin, InitIterator end) : AVLTree() {
-        for (InitIterator cur(begin); cur != end; ++cur) {
-            Insert(*cur);
-        }
-    }
-    AVLTree(std::initializer_list<T> list) : AVLTree() {
-        for (const T &value : list) {
-            Insert(value);
-        }
-    }
-
-    AVLTree(const AVLTree &other) : AVLTree() {
-        for (const T &value : other) {
-            Insert(value);
-        }
-    }
-    AVLTree(AVLTree &&other) noexcept : AVLTree() {
-        std::swap(root_, other.root_);
-        std::swap(begin_, other.begin_);
-        std::swap(end_, other.end_);
-        std::swap(size_, other.size_);
-    }
-    AVLTree(std::shared_ptr<ITree<T>> other) : AVLTree(*dynamic_cast<AVLTree<T> *>(other.get())) {
-    }
-    AVLTree &operator=(const AVLTree &other) {
-        if (root_ == other.root_) {
-            return *this;
-        }
-        end_ = std::make_shared<Node>();
-        root_ = end_;
-        begin_ = end_;
-        size_ = 0;
-        for (const T &value : other) {
-            Insert(value);
-        }
-        return *this;
-    }
-    AVLTree &operator=(AVLTree &&other) noexcept {
-        if (root_ == other.root_) {
-            return *this;
-        }
-        std::swap(root_, other.root_);
-        std::swap(begin_, other.begin_);
-        std::swap(end_, other.end_);
-        std::swap(size_, other.size_);
-        return *this;
-    }
-
-    ~AVLTree() override {
-        root_ = nullptr;
-        begin_ = nullptr;
-        end_ = nullptr;
-        size_ = 0;
-    }
-
-    [[nodiscard]] size_t Size() const override {
-        return size_;
-    }
-    [[nodiscard]] bool Empty() const override {
-        return !static_cast<bool>(size_);
-    }
-
-    std::shared_ptr<BaseImpl> Find(const T &value) const override {
-        return FindImpl(root_, value);
-    }
-    std::shared_ptr<BaseImpl> LowerBound(const T &value) const override {
-        std::optional val(value);
-        return LowerBoundImpl(root_, val);
-    }
-
-    void Insert(const T &value) override {
-        std::shared_ptr<Node> new_node = std::make_shared<Node>(value);
-        if (InsertImplementation(new_node)) {
-            ++size_;
-        }
-    }
-    void Erase(const T &value) override {
-        auto nodeInTree = std::static_pointer_cast<AVLTreeItImpl>(Find(value));
-        if (nodeInTree->IsEqual(End())) {
-            return;
-        }
-
-        EraseImplementation(nodeInTree->GetPointer());
-        --size_;
-    }
-
-    void Clear() override {
-        root_ = std::shared_ptr<Node>();
-        begin_ = root_;
-        end_ = root_;
-        size_ = 0;
-    }
-
-private:
-    std::shared_ptr<Node> begin_;
-    std::shared_ptr<Node> end_;
-    std::shared_ptr<Node> root_;
-    size_t size_;
-
-    /* ---------------------------------------------------
-     * --------------ITERATOR IMPLEMENTATION--------------
-     * ---------------------------------------------------
-     */
-
-    class AVLTreeItImpl : public BaseImpl {
-    public:
-        AVLTreeItImpl() = delete;
-        explicit AVLTreeItImpl(std::shared_ptr<Node> pointer) : it_(pointer) {
-        }
-        AVLTreeItImpl(const AVLTreeItImpl &other) : it_(other.it_) {
-        }
-
-        std::shared_ptr<BaseImpl> Clone() const override {
-            return std::make_shared<AVLTreeItImpl>(*this);
-        }
-        void Increment() override {
-            if (!it_->value_) {
-                throw std::runtime_error("Index out of range while increasing");
-            }
-            if (it_->right_) {
-                it_ = it_->right_;
-                while (it_->left_) {
-                    it_ = it_->left_;
-                }
-            } else {
-                auto parent = it_->parent_.lock();
-                while (parent && parent->right_ == it_) {
-                    it_ = parent;
-                    parent = it_->parent_.lock();
-                }
-                it_ = parent;
-            }
-        }
-        void Decrement() override {
-            if (it_->left_) {
-                it_ = it_->left_;
-                while (it_->right_) {
-                    it_ = it_->right_;
-                }
-            } else {
-                auto parent = it_->parent_.lock();
-                while (parent && parent->left_ == it_) {
-                    it_ = parent;
-                    parent = it_->parent_.lock();
-                }
-                if (parent) {
-                    it_ = parent;
-                } else {
-                    throw std::runtime_error("Index out of range while decreasing");
-                }
-            }
-        }
-
-        const T Dereferencing() const override {
-            if (it_ && !it_->value_) {
-                throw std::runtime_error("Index out of range on operator*");
-            }
-            return it_->value_.value();
-        }
-        const T *Arrow() const override {
-            if (it_ && !it_->value_) {
-                throw std::runtime_error("Index out of range on operator->");
-            }
-            return &it_->value_.value();
-        }
-
-        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
-            auto casted = std::dynamic_pointer_cast<AVLTreeItImpl>(other);
-            if (!casted) {
-                return false;
-            }
-            return it_ == casted->it_;
-        }
-        std::shared_ptr<Node> GetPointer() {
-            return it_;
-        }
-
-    private:
-        std::shared_ptr<Node> it_;
-    };
-
-    std::shared_ptr<BaseImpl> Begin() const override {
-        return std::make_shared<AVLTreeItImpl>(begin_);
-    }
-    std::shared_ptr<BaseImpl> End() const override {
-        return std::make_shared<AVLTreeItImpl>(end_);
-    }
-
-    /* ---------------------------------------------------
-     * ----------------PRIVATE FUNCTIONS------------------
-     * ---------------------------------------------------
-     */
-
-    std::shared_ptr<BaseImpl> FindImpl(std::shared_ptr<Node> from,
-                                            const std::optional<T> &value) const {
-        while (from) {
-            if (value < from->value_) {
-                from = from->left_;
-            } else if (from->value_ < value) {
-                from = from->right_;
-            } else {
-                return std::make_shared<AVLTreeItImpl>(from);
-            }
-        }
-        return End();
-    }
-
-    static std::shared_ptr<BaseImpl> LowerBoundImpl(std::shared_ptr<Node> from,
-                                                         const std::optional<T> &value) {
-        while (true) {
-            if (value < from->value_) {
-                if (from->left_) {
-                    from = from->left_;
-                } else {
-                    return std::make_shared<AVLTreeItImpl>(from);
-                }
-            } else if (from->value_ < value) {
-                if (from->right_) {
-                    from = from->right_;
-                } else {
-                    auto impl = std::make_shared<AVLTreeItImpl>(from);
-                    impl->Increment();
-                    return impl;
-                }
-            } else {
-                return std::make_shared<AVLTreeItImpl>(from);
-            }
-        }
-
-    }
-
-    void LeftRotate(std::shared_ptr<Node> from) {
-        auto right_node = from->right_;
-
-        from->right_ = right_node->left_;
-        if (right_node->left_) {
-            right_node->left_->parent_ = from;
-        }
-
-        right_node->left_ = from;
-        right_node->parent_ = from->parent_;
-
-        auto parent = from->parent_.lock();
-        if (parent) {
-            if (parent->right_ == from) {
-                parent->right_ = right_node;
-            } else {
-                parent->left_ = right_node;
-            }
-        } else {
-            root_ = right_node;
-        }
-
-        from->parent_ = right_node;
-        RecalcHeight(from);
-        RecalcHeight(right_node);
-    }
-    void RightRotate(std::shared_ptr<Node> from) {
-        auto left_node = from->left_;
-
-        from->left_ = left_node->right_;
-        if (left_node->right_) {
-            left_node->right_->parent_ = from;
-        }
-
-        left_node->right_ = from;
-        left_node->parent_ = from->parent_;
-
-        auto parent = from->parent_.lock();
-        if (parent) {
-            if (parent->right_ == from) {
-                parent->right_ = left_node;
-            } else {
-                parent->left_ = left_node;
-            }
-        } else {
-            root_ = left_node;
-        }
-
-        from->parent_ = left_node;
-        RecalcHeight(from);
-        RecalcHeight(left_node);
-    }
-
-    int AVLBalanceFactor(std::shared_ptr<Node> node) const {
-        uint8_t hl, hr;
-
-        if (!node->left_) {
-            hl = 0;
-        } else {
-            hl = node->left_->height_;
-        }
-
-        if (!node->right_) {
-            hr = 0;
-        } else {
-            hr = node->right_->height_;
-        }
-        return hr - hl;
-    }
-    void AVLFixBalance(std::shared_ptr<Node> node) {
-        RecalcHeight(node);
-        if (AVLBalanceFactor(node) == 2) {
-            if (node->right_ && AVLBalanceFactor(node->right_) < 0) {
-                RightRotate(node->right_);
-            }
-            LeftRotate(node);
-            return;
-        }
-        if (AVLBalanceFactor(node) == -2) {
-            if (node->left_ && AVLBalanceFactor(node->left_) > 0) {
-                LeftRotate(node->left_);
-            }
-            RightRotate(node);
-            return;
-        }
-    }
-
-    void RecalcHeight(std::shared_ptr<Node> node) {
-        if (!node) {
-            return;
-        }
-
-        uint8_t hl, hr;
-
-        if (!node->left_) {
-            hl = 0;
-        } else {
-            hl = node->left_->height_;
-        }
-
-        if (!node->right_) {
-            hr = 0;
-        } else {
-            hr = node->right_->height_;
-        }
-
-        if (hl > hr) {
-            node->height_ = hl + 1;
-        } else {
-            node->height_ = hr + 1;
-        }
-    }
-
-    bool InsertImplementation(const std::shared_ptr<Node> &new_node) {
-        if (!(root_)) {
-            root_ = new_node;
-            RecalcBegin();
-            return true;
-        }
-
-        auto cur_node = root_;
-        auto next_node = cur_node;
-        while (next_node) {
-            cur_node = next_node;
-            if (new_node->value_ < cur_node->value_) {
-                next_node = cur_node->left_;
-
-            } else if (cur_node->value_ < new_node->value_) {
-                next_node = cur_node->right_;
-            } else {
-                return false;
-            }
-        }
-
-        if (new_node->value_ < cur_node->value_) {
-            cur_node->left_ = new_node;
-        } else {
-            cur_node->right_ = new_node;
-        }
-        new_node->parent_ = cur_node;
-
-        while (cur_node) {
-            AVLFixBalance(cur_node);
-            cur_node = cur_node->parent_.lock();
-        }
-        RecalcBegin();
-        return true;
-    }
-    void EraseImplementation(std::shared_ptr<Node> delete_node) {
-        auto parent = delete_node->parent_.lock();
-        std::shared_ptr<Node> child_node;
-
-        // Node doesn't have children
-        if (!delete_node->right_ && !delete_node->left_) {
-            if (parent) {
-                if (parent->left_ == delete_node) {
-                    parent->left_ = nullptr;
-                } else {
-                    parent->right_ = nullptr;
-                }
-            } else {
-                root_ = nullptr;
-            }
-            // Node has only 1 child
-        } else if ((delete_node->right_ && !delete_node->left_) ||
-                   (!delete_node->right_ && delete_node->left_)) {
-
-            child_node = delete_node->right_ ? delete_node->right_ : delete_node->left_;
-            if (!parent) {
-                root_ = child_node;
-
-            } else {
-                if (parent->left_ == delete_node) {
-                    parent->left_ = child_node;
-                } else {
-                    parent->right_ = child_node;
-                }
-                child_node->parent_ = parent;
-            }
-        } else {
-            std::shared_ptr<Node> swap_node = delete_node->right_;
-            while (swap_node->left_) {
-                swap_node = swap_node->left_;
-            }
-            parent = swap_node->parent_.lock();
-            if (swap_node == delete_node->right_) {
-                SwapWithChild(delete_node, swap_node);
-                parent = swap_node;
-            } else {
-                SwapWithOffspring(delete_node, swap_node);
-            }
-        }
-
-        while (parent) {
-            AVLFixBalance(parent);
-            parent = parent->parent_.lock();
-        }
-
-        RecalcBegin();
-    }
-
-    // Set begin_ after modification
-    void RecalcBegin() {
-        auto node = root_;
-        while (node->left_) {
-            node = node->left_;
-        }
-        begin_ = node;
-    }
-
-    // When swap node is child
-    void SwapWithChild(std::shared_ptr<Node> from_node, std::shared_ptr<Node> swap_node) {
-        auto parent = from_node->parent_.lock();
-        if (parent) {
-            if (parent->left_ == from_node) {
-                parent->left_ = swap_node;
-            } else {
-                parent->right_ = swap_node;
-            }
-        } else {
-            root_ = swap_node;
-        }
-        swap_node->parent_ = parent;
-
-        swap_node->left_ = from_node->left_;
-        if (from_node->left_) {
-            from_node->left_->parent_ = swap_node;
-        }
-    }
-    // When swap node is not child
-    void SwapWithOffspring(std::shared_ptr<Node> from_node, std::shared_ptr<Node> swap_node) {
-        auto from_parent = from_node->parent_.lock();
-        if (from_parent) {
-            if (from_parent->left_ == from_node) {
-                from_parent->left_ = swap_node;
-            } else {
-                from_parent->right_ = swap_node;
-            }
-        } else {
-            root_ = swap_node;
-        }
-
-        auto swap_parent = swap_node->parent_.lock();
-        swap_parent->left_ = swap_node->right_;
-        if (swap_node->right_) {
-            swap_node->right_->parent_ = swap_parent;
-        }
-
-        swap_node->parent_ = from_node->parent_;
-
-        swap_node->right_ = from_node->right_;
-        from_node->right_->parent_ = swap_node;
-
-        swap_node->left_ = from_node->left_;
-        if (from_node->left_) {
-            from_node->left_->parent_ = swap_node;
-        }
-    }
-};
+#pragma once
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "tagged_pointer.h"
+
+template <class T>
+class ITree;
+
+template <class T>
+class AVLTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    struct Node;
+
+    /**
+     * Links of a node. The header of the tree is a bare NodeBase without a value:
+     * its left child is the root and it is the only node without a parent.
+     * Parent link is a raw pointer with the balance factor in its two lowest bits:
+     * children own their subtrees, so the parent is always alive while the child is in the tree
+     */
+    struct NodeBase {
+        NodeBase *Parent() const {
+            return parent_.Get();
+        }
+        void SetParent(NodeBase *parent) {
+            parent_.Set(parent);
+        }
+        /**
+         * @return Height of the right subtree minus height of the left one
+         */
+        int Balance() const {
+            unsigned tag = parent_.Tag();
+            return tag == 3 ? -1 : static_cast<int>(tag);
+        }
+        void SetBalance(int balance) {
+            parent_.SetTag(static_cast<unsigned>(balance) & 3);
+        }
+
+        std::shared_ptr<Node> left_;
+        std::shared_ptr<Node> right_;
+        TaggedPointer<NodeBase, 2> parent_;
+    };
+
+    struct Node : NodeBase {
+        explicit Node(const T &value) : value_(value) {
+        }
+
+        T value_;
+    };
+
+    AVLTree() {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    template <class InitIterator>
+    AVLTree(InitIterator begin, InitIterator end) : AVLTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    AVLTree(std::initializer_list<T> list) : AVLTree() {
+        for (const T &value : list) {
+            Insert(value);
+        }
+    }
+
+    AVLTree(const AVLTree &other) : AVLTree() {
+        for (const T &value : other) {
+            Insert(value);
+        }
+    }
+    AVLTree(AVLTree &&other) noexcept : AVLTree() {
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+    }
+    AVLTree(std::shared_ptr<ITree<T>> other) : AVLTree(*dynamic_cast<AVLTree<T> *>(other.get())) {
+    }
+    AVLTree &operator=(const AVLTree &other) {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Clear();
+        for (const T &value : other) {
+            Insert(value);
+        }
+        return *this;
+    }
+    AVLTree &operator=(AVLTree &&other) noexcept {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~AVLTree() override {
+        begin_ = nullptr;
+        last_ = nullptr;
+        end_ = nullptr;
+        size_ = 0;
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !static_cast<bool>(size_);
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T &value) const override {
+        return FindImpl(value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T &value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T &value) override {
+        if (InsertImplementation(value)) {
+            ++size_;
+        }
+    }
+    void Erase(const T &value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * Builds a tree with minimal height in linear time
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        size_ = values.size();
+        end_->left_ = BuildBalanced(values, 0, size_, end_.get());
+        if (size_) {
+            for (begin_ = Root(); begin_->left_; begin_ = begin_->left_.get()) {
+            }
+            for (last_ = Root(); last_->right_; last_ = last_->right_.get()) {
+            }
+        }
+    }
+
+    void CheckAVL() const {
+        if (Root()) {
+            CheckAVLRecursive(Root());
+        }
+        NodeBase *node = end_.get();
+        while (node->left_) {
+            node = node->left_.get();
+        }
+        if (node != (begin_ ? begin_ : end_.get())) {
+            throw std::runtime_error("Begin is not the leftmost node");
+        }
+        CheckLast();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K &key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K &key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K &key) {
+        EraseImpl(key);
+    }
+
+private:
+    /// Leftmost node, nullptr if the tree is empty
+    Node *begin_;
+    /// Header of the tree: its left child is the root, so every node has a parent
+    std::shared_ptr<NodeBase> end_;
+    /// Rightmost node, nullptr if the tree is empty
+    Node *last_;
+    size_t size_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class AVLTreeItImpl : public BaseImpl {
+    public:
+        AVLTreeItImpl() = delete;
+        explicit AVLTreeItImpl(NodeBase *pointer) : it_(pointer) {
+            Pin();
+        }
+        AVLTreeItImpl(const AVLTreeItImpl &other) : it_(other.it_), pin_(other.pin_) {
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<AVLTreeItImpl>(*this);
+        }
+        void Increment() override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (it_->right_) {
+                it_ = it_->right_.get();
+                while (it_->left_) {
+                    it_ = it_->left_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent->right_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                it_ = parent;
+            }
+            Pin();
+        }
+        void Decrement() override {
+            if (it_->left_) {
+                it_ = it_->left_.get();
+                while (it_->right_) {
+                    it_ = it_->right_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent && parent->left_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                if (parent) {
+                    it_ = parent;
+                } else {
+                    throw std::runtime_error("Index out of range while decreasing");
+                }
+            }
+            Pin();
+        }
+
+        const T Dereferencing() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return static_cast<Node *>(it_)->value_;
+        }
+        const T *Arrow() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &static_cast<Node *>(it_)->value_;
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<AVLTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+        NodeBase *GetPointer() const {
+            return it_;
+        }
+
+    private:
+        /**
+         * Takes shared ownership of the current node through the link of its parent,
+         * so that the node survives its erasure. Header is owned by the tree itself
+         */
+        void Pin() {
+            auto parent = it_->Parent();
+            if (!parent) {
+                pin_ = nullptr;
+            } else if (parent->left_.get() == it_) {
+                pin_ = parent->left_;
+            } else {
+                pin_ = parent->right_;
+            }
+        }
+
+        NodeBase *it_;
+        std::shared_ptr<Node> pin_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<AVLTreeItImpl>(begin_ ? begin_ : end_.get());
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<AVLTreeItImpl>(end_.get());
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    Node *Root() const {
+        return end_->left_.get();
+    }
+
+    /**
+     * @param node Node in the tree
+     * @return Link of the parent, which owns the node
+     */
+    static std::shared_ptr<Node> &Link(NodeBase *node) {
+        auto parent = node->Parent();
+        return parent->left_.get() == node ? parent->left_ : parent->right_;
+    }
+
+    /**
+     * Finds the first node not less than the key.
+     * Links are followed instead of copying pointers, so lookups do not touch reference counts
+     * @param key Lookup key
+     * @return Lower bound node, nullptr if there is none
+     */
+    template <class K>
+    Node *LowerBoundNode(const K &key) const {
+        Node *result = nullptr;
+        Node *node = Root();
+        while (node) {
+            if (node->value_ < key) {
+                node = node->right_.get();
+            } else {
+                result = node;
+                node = node->left_.get();
+            }
+        }
+        return result;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K &key) const {
+        Node *node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return End();
+        }
+        return std::make_shared<AVLTreeItImpl>(node);
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K &key) const {
+        Node *node = LowerBoundNode(key);
+        return std::make_shared<AVLTreeItImpl>(node ? node : end_.get());
+    }
+
+    template <class K>
+    void EraseImpl(const K &key) {
+        Node *node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return;
+        }
+        // Keeps the node alive until it is unlinked
+        std::shared_ptr<Node> delete_node = Link(node);
+        if (node == last_) {
+            if (node == begin_) {
+                last_ = nullptr;
+            } else {
+                AVLTreeItImpl prev(last_);
+                prev.Decrement();
+                last_ = static_cast<Node *>(prev.GetPointer());
+            }
+        }
+        if (node == begin_) {
+            AVLTreeItImpl next(begin_);
+            next.Increment();
+            auto next_node = next.GetPointer();
+            begin_ = next_node == end_.get() ? nullptr : static_cast<Node *>(next_node);
+        }
+
+        EraseImplementation(delete_node.get());
+        --size_;
+    }
+
+    int CheckAVLRecursive(const NodeBase *from) const {
+        int hl = 0, hr = 0;
+        if (from->left_) {
+            if (from->left_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            hl = CheckAVLRecursive(from->left_.get());
+        }
+        if (from->right_) {
+            if (from->right_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            hr = CheckAVLRecursive(from->right_.get());
+        }
+        if (hl - hr > 1 || hr - hl > 1) {
+            throw std::runtime_error("Subtree heights differ by more than one");
+        }
+        if (from->Balance() != hr - hl) {
+            throw std::runtime_error("Stored balance factor is wrong");
+        }
+        return std::max(hl, hr) + 1;
+    }
+
+    void CheckLast() const {
+        if (!size_) {
+            if (last_) {
+                throw std::runtime_error("Last is set in an empty tree");
+            }
+            return;
+        }
+        AVLTreeItImpl prev(end_.get());
+        prev.Decrement();
+        if (prev.GetPointer() != last_) {
+            throw std::runtime_error("Last is not the node before end");
+        }
+    }
+
+    void LeftRotate(NodeBase *from) {
+        auto parent = from->Parent();
+        auto &link = Link(from);
+        auto right_node = from->right_;
+
+        from->right_ = right_node->left_;
+        if (from->right_) {
+            from->right_->SetParent(from);
+        }
+        right_node->left_ = std::move(link);
+        from->SetParent(right_node.get());
+        right_node->SetParent(parent);
+        link = std::move(right_node);
+    }
+    void RightRotate(NodeBase *from) {
+        auto parent = from->Parent();
+        auto &link = Link(from);
+        auto left_node = from->left_;
+
+        from->left_ = left_node->right_;
+        if (from->left_) {
+            from->left_->SetParent(from);
+        }
+        left_node->right_ = std::move(link);
+        from->SetParent(left_node.get());
+        left_node->SetParent(parent);
+        link = std::move(left_node);
+    }
+
+    /**
+     * Rotates the node, which subtrees differ in height by two
+     * @param node Node to fix
+     * @param balance Actual balance factor of the node, +2 or -2
+     * @return New root of the subtree
+     */
+    NodeBase *AVLFixBalance(NodeBase *node, int balance) {
+        if (balance == 2) {
+            NodeBase *right_node = node->right_.get();
+            if (right_node->Balance() >= 0) {
+                LeftRotate(node);
+                // Right child is balanced only after erase, height of the subtree is kept then
+                int right_balance = right_node->Balance();
+                node->SetBalance(right_balance == 0 ? 1 : 0);
+                right_node->SetBalance(right_balance == 0 ? -1 : 0);
+                return right_node;
+            }
+            NodeBase *middle = right_node->left_.get();
+            RightRotate(right_node);
+            LeftRotate(node);
+            node->SetBalance(middle->Balance() == 1 ? -1 : 0);
+            right_node->SetBalance(middle->Balance() == -1 ? 1 : 0);
+            middle->SetBalance(0);
+            return middle;
+        }
+        NodeBase *left_node = node->left_.get();
+        if (left_node->Balance() <= 0) {
+            RightRotate(node);
+            int left_balance = left_node->Balance();
+            node->SetBalance(left_balance == 0 ? -1 : 0);
+            left_node->SetBalance(left_balance == 0 ? 1 : 0);
+            return left_node;
+        }
+        NodeBase *middle = left_node->right_.get();
+        LeftRotate(left_node);
+        RightRotate(node);
+        node->SetBalance(middle->Balance() == -1 ? 1 : 0);
+        left_node->SetBalance(middle->Balance() == 1 ? -1 : 0);
+        middle->SetBalance(0);
+        return middle;
+    }
+
+    /**
+     * Updates balance factors from the new node up to the root.
+     * Stops at the first subtree, which height hasn't changed, or after a rotation,
+     * which always restores the height the subtree had before the insertion
+     * @param node Inserted node
+     */
+    void RebalanceAfterInsert(NodeBase *node) {
+        auto parent = node->Parent();
+        while (parent != end_.get()) {
+            int balance = parent->Balance() + (parent->left_.get() == node ? -1 : 1);
+            if (balance == 0) {
+                parent->SetBalance(0);
+                return;
+            }
+            if (balance == 2 || balance == -2) {
+                AVLFixBalance(parent, balance);
+                return;
+            }
+            parent->SetBalance(balance);
+            node = parent;
+            parent = node->Parent();
+        }
+    }
+
+    /**
+     * Updates balance factors from the parent of the removed node up to the root.
+     * Stops at the first subtree, which height hasn't changed
+     * @param parent Node, which lost a child
+     * @param left True if the left subtree of the parent became lower
+     */
+    void RebalanceAfterErase(NodeBase *parent, bool left) {
+        while (parent != end_.get()) {
+            int balance = parent->Balance() + (left ? 1 : -1);
+            if (balance == 1 || balance == -1) {
+                parent->SetBalance(balance);
+                return;
+            }
+            NodeBase *top = parent;
+            if (balance == 0) {
+                parent->SetBalance(0);
+            } else {
+                top = AVLFixBalance(parent, balance);
+                if (top->Balance() != 0) {
+                    return;
+                }
+            }
+            parent = top->Parent();
+            left = parent->left_.get() == top;
+        }
+    }
+
+    /**
+     * Finds a node to hang the new value on. Values less than the minimum or greater than
+     * the maximum go next to 'begin_' or 'last_' without descending from the root
+     * @param value Value to insert
+     * @param left Used to return the side of the new node
+     * @return Parent for the new node, nullptr if the value is already in the tree
+     */
+    NodeBase *FindParentForInsert(const T &value, bool &left) const {
+        left = true;
+        if (begin_ && value < begin_->value_) {
+            return begin_;
+        }
+        if (last_ && last_->value_ < value) {
+            left = false;
+            return last_;
+        }
+        NodeBase *parent = end_.get();
+        Node *cur_node = Root();
+        while (cur_node) {
+            parent = cur_node;
+            if (value < cur_node->value_) {
+                left = true;
+                cur_node = cur_node->left_.get();
+            } else if (cur_node->value_ < value) {
+                left = false;
+                cur_node = cur_node->right_.get();
+            } else {
+                return nullptr;
+            }
+        }
+        return parent;
+    }
+
+    /**
+     * @param values Values in order
+     * @param begin First value of the range
+     * @param end Value after the last one of the range
+     * @param parent Parent for the root of the range
+     * @return Root of a tree made of the range, sibling subtrees differ in size by at most one
+     */
+    static std::shared_ptr<Node> BuildBalanced(const std::vector<T> &values, size_t begin,
+                                               size_t end, NodeBase *parent) {
+        if (begin == end) {
+            return nullptr;
+        }
+        size_t middle = begin + (end - begin) / 2;
+        auto node = std::make_shared<Node>(values[middle]);
+        node->SetParent(parent);
+        node->SetBalance(HeightOfBalanced(end - middle - 1) - HeightOfBalanced(middle - begin));
+        node->left_ = BuildBalanced(values, begin, middle, node.get());
+        node->right_ = BuildBalanced(values, middle + 1, end, node.get());
+        return node;
+    }
+
+    /**
+     * @param size Number of nodes in a tree built by BuildBalanced()
+     * @return Height of the tree, which is the bit width of its size
+     */
+    static int HeightOfBalanced(size_t size) {
+        return size ? 64 - __builtin_clzll(size) : 0;
+    }
+
+    bool InsertImplementation(const T &value) {
+        bool left;
+        NodeBase *parent = FindParentForInsert(value, left);
+        if (!parent) {
+            return false;
+        }
+
+        auto &link = left ? parent->left_ : parent->right_;
+        link = std::make_shared<Node>(value);
+        link->SetParent(parent);
+        if (!begin_ || value < begin_->value_) {
+            begin_ = link.get();
+        }
+        if (!last_ || last_->value_ < value) {
+            last_ = link.get();
+        }
+        RebalanceAfterInsert(link.get());
+        return true;
+    }
+
+    /**
+     * Unlinks the node from the tree. Erased node keeps its own links,
+     * so that iterators pointing to it can still move forward
+     * @param delete_node Node to erase
+     */
+    void EraseImplementation(NodeBase *delete_node) {
+        if (!delete_node->left_ || !delete_node->right_) {
+            auto parent = delete_node->Parent();
+            bool left = parent->left_.get() == delete_node;
+            Transplant(delete_node, delete_node->left_ ? delete_node->left_ : delete_node->right_);
+            RebalanceAfterErase(parent, left);
+            return;
+        }
+        // Successor takes the place and the balance factor of the deleted node
+        auto swap_node = delete_node->right_;
+        while (swap_node->left_) {
+            swap_node = swap_node->left_;
+        }
+        NodeBase *parent;
+        bool left;
+        if (swap_node->Parent() == delete_node) {
+            parent = swap_node.get();
+            left = false;
+        } else {
+            parent = swap_node->Parent();
+            left = true;
+            Transplant(swap_node.get(), swap_node->right_);
+            swap_node->right_ = delete_node->right_;
+            swap_node->right_->SetParent(swap_node.get());
+        }
+        swap_node->left_ = delete_node->left_;
+        swap_node->left_->SetParent(swap_node.get());
+        swap_node->SetBalance(delete_node->Balance());
+        Transplant(delete_node, swap_node);
+        RebalanceAfterErase(parent, left);
+    }
+
+    /**
+     * Hangs the subtree on the place of the node, the node itself is left as is
+     * @param node Node to replace
+     * @param subtree Subtree to hang, may be empty
+     */
+    void Transplant(NodeBase *node, std::shared_ptr<Node> subtree) {
+        auto parent = node->Parent();
+        if (subtree) {
+            subtree->SetParent(parent);
+        }
+        Link(node) = std::move(subtree);
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Value types, which 'std::hash' supports
+ */
+template <class T, class = void>
+struct IsHashable : std::false_type {};
+template <class T>
+struct IsHashable<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T&>()))>>
+    : std::true_type {};
+
+/**
+ * Bloom filter over 64-bit hashes: answers "maybe stored" or "surely not stored".
+ *
+ * Probes are made by double hashing: the i-th bit is h1 + i * h2, where h1 and h2 come from
+ * the mixed hash, so even weak hashes like the identity 'std::hash<int>' spread well.
+ * A default constructed filter is disabled and answers "maybe" for everything.
+ */
+class BloomFilter {
+public:
+    BloomFilter() = default;
+
+    /**
+     * @param count Expected number of values
+     * @param bits_per_value Number of bits per value, 10 give about 1% of false positives
+     */
+    BloomFilter(size_t count, size_t bits_per_value) {
+        bits_ = std::max<uint64_t>(64, count * bits_per_value);
+        words_.assign((bits_ + 63) / 64, 0);
+        // ln(2) * bits per value probes give the least false positive rate
+        hashes_ = std::clamp<int>(static_cast<int>(bits_per_value * 69 / 100), 1, 16);
+    }
+
+    void Add(uint64_t hash) {
+        if (words_.empty()) {
+            return;
+        }
+        uint64_t mixed = Mix(hash);
+        uint64_t step = (mixed >> 32) | 1;
+        for (int i = 0; i < hashes_; ++i, mixed += step) {
+            uint64_t bit = mixed % bits_;
+            words_[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+    }
+
+    [[nodiscard]] bool MayContain(uint64_t hash) const {
+        if (words_.empty()) {
+            return true;
+        }
+        uint64_t mixed = Mix(hash);
+        uint64_t step = (mixed >> 32) | 1;
+        for (int i = 0; i < hashes_; ++i, mixed += step) {
+            uint64_t bit = mixed % bits_;
+            if (!(words_[bit >> 6] >> (bit & 63) & 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool Enabled() const {
+        return !words_.empty();
+    }
+
+    /**
+     * @return Size of the bit array in bytes
+     */
+    [[nodiscard]] size_t Bytes() const {
+        return words_.size() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> words_;
+    uint64_t bits_ = 0;
+    int hashes_ = 0;
+
+    /**
+     * SplitMix64 finalizer
+     */
+    static uint64_t Mix(uint64_t hash) {
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+        return hash ^ (hash >> 31);
+    }
+};
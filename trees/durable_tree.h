@@ -0,0 +1,388 @@
+#pragma once
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.h"
+#include "serialization.h"
+
+template <class T>
+class ITree;
+
+/**
+ * Tree of any type, which survives crashes: updates are appended to a write-ahead log
+ * in a directory and the tree is rebuilt from it, when the directory is opened again.
+ *
+ * Group commit: records are collected in memory and written with one fdatasync
+ * every 'commit_batch' updates, so the cost of a sync is shared by the whole batch.
+ * An update is durable once its batch is committed; a crash loses at most the updates
+ * of the open batch. Commit() closes the batch at once, the destructor commits too.
+ *
+ * Every 'checkpoint_interval' committed records the tree is saved with SaveTree() to a new
+ * checkpoint file, which atomically replaces the old one, and the log starts over. Recovery
+ * loads the checkpoint in linear time with build_from_sorted() and replays the log on top.
+ * Replaying a record, which the checkpoint already has, changes nothing: the last record
+ * of a value decides whether it is stored, so a crash between the two steps is harmless.
+ *
+ * Every record carries a checksum. Replay stops at the first torn or broken record
+ * and cuts the log there.
+ *
+ * Files are owned by a single tree, so durable trees are neither copied nor moved.
+ * @tparam T Tree value type, arithmetic types and strings are logged
+ */
+template <class T>
+class DurableTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    static_assert(IsSerializable<T>::value, "Only arithmetic values and strings are logged");
+
+    /// Makes an empty tree to wrap
+    using TreeFactory = std::function<std::shared_ptr<ITree<T>>()>;
+
+    static constexpr size_t kDefaultCommitBatch = 64;
+    static constexpr size_t kDefaultCheckpointInterval = 1 << 20;
+    static constexpr char kLogMagic[4] = {'W', 'L', 'O', 'G'};
+    static constexpr uint32_t kLogVersion = 1;
+
+    /**
+     * Opens the AVL tree stored in the directory or creates an empty one
+     * @param directory Directory of the checkpoint and the log, it is created if needed
+     */
+    explicit DurableTree(std::string directory)
+        : DurableTree(std::move(directory), [] { return std::make_shared<AVLTree<T>>(); }) {
+    }
+
+    /**
+     * Opens the tree stored in the directory or creates an empty one
+     * @param directory Directory of the checkpoint and the log, it is created if needed
+     * @param make_tree Makes an empty tree to wrap
+     * @param commit_batch Number of updates synced to the log together
+     * @param checkpoint_interval Number of logged updates between checkpoints
+     */
+    DurableTree(std::string directory, TreeFactory make_tree,
+                size_t commit_batch = kDefaultCommitBatch,
+                size_t checkpoint_interval = kDefaultCheckpointInterval)
+        : directory_(std::move(directory)),
+          commit_batch_(commit_batch),
+          checkpoint_interval_(checkpoint_interval),
+          tree_(make_tree()) {
+        if (!commit_batch_ || !checkpoint_interval_) {
+            throw std::invalid_argument("Commit batch and checkpoint interval must be positive");
+        }
+        std::filesystem::create_directories(directory_);
+        Recover();
+    }
+
+    DurableTree(const DurableTree& other) = delete;
+    DurableTree& operator=(const DurableTree& other) = delete;
+
+    /**
+     * Commits the open batch, errors are ignored here: call Commit() to see them
+     */
+    ~DurableTree() override {
+        try {
+            Commit();
+        } catch (...) {
+        }
+        close(log_fd_);
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return tree_->size();
+    }
+    [[nodiscard]] bool Empty() const override {
+        return tree_->empty();
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return ITree<T>::FindOf(*tree_, value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return ITree<T>::LowerBoundOf(*tree_, value);
+    }
+
+    void Insert(const T& value) override {
+        tree_->insert(value);
+        Log(Operation::kInsert, &value);
+    }
+    void Erase(const T& value) override {
+        tree_->erase(value);
+        Log(Operation::kErase, &value);
+    }
+
+    void Clear() override {
+        tree_->clear();
+        Log(Operation::kClear, nullptr);
+    }
+
+    /**
+     * Builds the wrapped tree from the values and checkpoints it at once,
+     * instead of logging every value
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        tree_->build_from_sorted(std::move(values));
+        Checkpoint();
+    }
+
+    /**
+     * Writes the open batch to the log and waits until it is on disk
+     */
+    void Commit() {
+        if (batch_.empty()) {
+            return;
+        }
+        WriteAll(log_fd_, batch_);
+        if (fdatasync(log_fd_)) {
+            throw std::runtime_error("Failed to sync the log");
+        }
+        batch_.clear();
+        logged_ += unsynced_;
+        unsynced_ = 0;
+        if (logged_ >= checkpoint_interval_) {
+            Checkpoint();
+        }
+    }
+
+    /**
+     * Saves the tree to a new checkpoint and empties the log
+     */
+    void Checkpoint() {
+        Commit();
+        std::string temporary = CheckpointPath() + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            SaveTree(*tree_, out);
+            out.close();
+            if (!out) {
+                throw std::runtime_error("Failed to write the checkpoint");
+            }
+        }
+        Sync(temporary);
+        std::filesystem::rename(temporary, CheckpointPath());
+        Sync(directory_);
+        // Records of the old log are in the checkpoint now
+        if (ftruncate(log_fd_, 0)) {
+            throw std::runtime_error("Failed to empty the log");
+        }
+        WriteLogHeader();
+        logged_ = 0;
+    }
+
+    /**
+     * @return Number of updates, which aren't committed yet
+     */
+    [[nodiscard]] size_t UncommittedUpdates() const {
+        return unsynced_;
+    }
+
+    /**
+     * @return Number of committed records in the log, which recovery would replay
+     */
+    [[nodiscard]] size_t LoggedRecords() const {
+        return logged_;
+    }
+
+private:
+    enum class Operation : uint8_t { kInsert = 1, kErase, kClear };
+
+    std::string directory_;
+    size_t commit_batch_;
+    size_t checkpoint_interval_;
+    std::shared_ptr<ITree<T>> tree_;
+    int log_fd_ = -1;
+    /// Encoded records of the open batch
+    std::string batch_;
+    size_t unsynced_ = 0;
+    size_t logged_ = 0;
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return ITree<T>::BeginOf(*tree_);
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return ITree<T>::EndOf(*tree_);
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    [[nodiscard]] std::string CheckpointPath() const {
+        return (std::filesystem::path(directory_) / "checkpoint").string();
+    }
+    [[nodiscard]] std::string LogPath() const {
+        return (std::filesystem::path(directory_) / "log").string();
+    }
+
+    /**
+     * @return 32-bit FNV-1a hash of the bytes
+     */
+    static uint32_t Checksum(const char* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * Encodes a record: operation, value unless the tree is cleared, checksum of both
+     */
+    static void AppendRecord(std::string& buffer, Operation operation, const T* value) {
+        size_t start = buffer.size();
+        serialization::Append(buffer, static_cast<uint8_t>(operation));
+        if (value) {
+            serialization::AppendValue(buffer, *value);
+        }
+        serialization::Append(buffer, Checksum(buffer.data() + start, buffer.size() - start));
+    }
+
+    void Log(Operation operation, const T* value) {
+        AppendRecord(batch_, operation, value);
+        if (++unsynced_ >= commit_batch_) {
+            Commit();
+        }
+    }
+
+    static void WriteAll(int fd, const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t count = write(fd, data.data() + written, data.size() - written);
+            if (count < 0) {
+                throw std::runtime_error("Failed to write the log");
+            }
+            written += count;
+        }
+    }
+
+    /**
+     * Flushes a file or a directory to disk
+     */
+    static void Sync(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0 || fsync(fd)) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error("Failed to sync " + path);
+        }
+        close(fd);
+    }
+
+    void WriteLogHeader() {
+        std::string header(kLogMagic, sizeof(kLogMagic));
+        serialization::Append(header, kLogVersion);
+        serialization::Append(header, serialization::ValueSize<T>());
+        WriteAll(log_fd_, header);
+        if (fdatasync(log_fd_)) {
+            throw std::runtime_error("Failed to sync the log");
+        }
+    }
+
+    /**
+     * Loads the checkpoint, replays the log and opens it for appending
+     */
+    void Recover() {
+        std::filesystem::remove(CheckpointPath() + ".tmp");
+        if (std::filesystem::exists(CheckpointPath())) {
+            std::ifstream in(CheckpointPath(), std::ios::binary);
+            LoadTree(*tree_, in);
+        }
+        bool has_header = Replay();
+        log_fd_ = open(LogPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (log_fd_ < 0) {
+            throw std::runtime_error("Failed to open the log");
+        }
+        if (!has_header) {
+            if (ftruncate(log_fd_, 0)) {
+                close(log_fd_);
+                throw std::runtime_error("Failed to empty the log");
+            }
+            WriteLogHeader();
+            // Entry of a new log has to be on disk too
+            Sync(directory_);
+        }
+    }
+
+    /**
+     * Applies the complete records of the log to the tree and cuts off the rest
+     * @return False if the log is missing or has no complete header
+     */
+    bool Replay() {
+        std::ifstream in(LogPath(), std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        char magic[sizeof(kLogMagic)];
+        uint32_t version, value_size;
+        if (!in.read(magic, sizeof(magic)) ||
+            !in.read(reinterpret_cast<char*>(&version), sizeof(version)) ||
+            !in.read(reinterpret_cast<char*>(&value_size), sizeof(value_size))) {
+            // Torn while the log was created
+            return false;
+        }
+        if (std::memcmp(magic, kLogMagic, sizeof(magic))) {
+            throw std::runtime_error("File isn't a log of a durable tree");
+        }
+        if (version != kLogVersion) {
+            throw std::runtime_error("Unknown format version of a log");
+        }
+        if (value_size != serialization::ValueSize<T>()) {
+            throw std::runtime_error("Log has values of another type");
+        }
+        auto end = in.tellg();
+        std::string record;
+        while (in.peek() != std::char_traits<char>::eof()) {
+            try {
+                auto operation = static_cast<Operation>(serialization::Read<uint8_t>(in));
+                T value{};
+                record.clear();
+                if (operation == Operation::kClear) {
+                    AppendRecord(record, operation, nullptr);
+                } else if (operation == Operation::kInsert || operation == Operation::kErase) {
+                    value = serialization::ReadValue<T>(in);
+                    AppendRecord(record, operation, &value);
+                } else {
+                    break;
+                }
+                // The record is encoded again to check the checksum at its end
+                uint32_t checksum;
+                std::memcpy(&checksum, record.data() + record.size() - sizeof(checksum),
+                            sizeof(checksum));
+                if (serialization::Read<uint32_t>(in) != checksum) {
+                    break;
+                }
+                if (operation == Operation::kInsert) {
+                    tree_->insert(value);
+                } else if (operation == Operation::kErase) {
+                    tree_->erase(value);
+                } else {
+                    tree_->clear();
+                }
+            } catch (const std::runtime_error&) {
+                // Stream ends in the middle of the record
+                break;
+            }
+            end = in.tellg();
+            ++logged_;
+        }
+        in.close();
+        if (static_cast<uintmax_t>(end) != std::filesystem::file_size(LogPath())) {
+            std::filesystem::resize_file(LogPath(), end);
+        }
+        return true;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+/**
+ * Small and fast pseudo-random generator (SplitMix64) for tree internals:
+ * treap priorities and skip list tower heights.
+ *
+ * Every thread owns its own state, so trees can be built concurrently without locking.
+ * State is seeded from 'std::random_device' on first use in a thread,
+ * call 'Seed()' to get a reproducible sequence instead.
+ */
+class FastRandom {
+public:
+    /**
+     * @return Uniformly distributed 64-bit number
+     */
+    static uint64_t Next() {
+        uint64_t result = (State() += kIncrement);
+        result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ull;
+        result = (result ^ (result >> 27)) * 0x94d049bb133111ebull;
+        return result ^ (result >> 31);
+    }
+
+    /**
+     * @return Uniformly distributed 32-bit number
+     */
+    static uint32_t Next32() {
+        return static_cast<uint32_t>(Next() >> 32);
+    }
+
+    /**
+     * Restarts the sequence of the calling thread
+     * @param seed Seed, equal seeds give equal sequences
+     */
+    static void Seed(uint64_t seed) {
+        State() = seed;
+    }
+
+private:
+    static constexpr uint64_t kIncrement = 0x9e3779b97f4a7c15ull;
+
+    static uint64_t& State() {
+        thread_local uint64_t state = InitialState();
+        return state;
+    }
+
+    static uint64_t InitialState() {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) | device();
+    }
+};
@@ -0,0 +1,230 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+
+#include "avl_tree.h"
+#include "bloom_filter.h"
+
+template <class T>
+class ITree;
+
+/**
+ * Tree of any type with a Bloom filter in front of it, which answers most lookups and erasures
+ * of absent values without descending the tree.
+ *
+ * Inserts add values to the filter. Bloom filters can't forget values, so erased values stay
+ * in the filter until it is rebuilt from the tree: when there are more erased values
+ * in the filter than stored ones, or when the tree outgrows the capacity of the filter.
+ * Both cost O(1) amortized per update.
+ *
+ * Iterators are the iterators of the wrapped tree. Values without 'std::hash' aren't filtered.
+ */
+template <class T>
+class FilteredTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// Makes an empty tree to wrap
+    using TreeFactory = std::function<std::shared_ptr<ITree<T>>()>;
+
+    static constexpr size_t kDefaultBitsPerValue = 10;
+    /// Smallest number of values the filter is built for
+    static constexpr size_t kMinCapacity = 64;
+
+    FilteredTree() : FilteredTree([] { return std::make_shared<AVLTree<T>>(); }) {
+    }
+
+    /**
+     * @param make_tree Makes an empty tree to wrap
+     * @param bits_per_value Filter bits per value, 10 give about 1% of false positives
+     */
+    explicit FilteredTree(TreeFactory make_tree, size_t bits_per_value = kDefaultBitsPerValue)
+        : make_tree_(std::move(make_tree)), bits_per_value_(bits_per_value) {
+        if (!bits_per_value_) {
+            throw std::invalid_argument("Filter needs at least one bit per value");
+        }
+        tree_ = make_tree_();
+        Rebuild();
+    }
+
+    template <class InitIterator>
+    FilteredTree(InitIterator begin, InitIterator end) : FilteredTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    FilteredTree(std::initializer_list<T> list) : FilteredTree() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    FilteredTree(const FilteredTree& other)
+        : make_tree_(other.make_tree_), bits_per_value_(other.bits_per_value_) {
+        tree_ = make_tree_();
+        for (auto it = other.tree_->begin(); it != other.tree_->end(); ++it) {
+            tree_->insert(*it);
+        }
+        Rebuild();
+    }
+    FilteredTree(FilteredTree&& other) noexcept : FilteredTree() {
+        Swap(other);
+    }
+    FilteredTree(std::shared_ptr<ITree<T>> other)
+        : FilteredTree(*dynamic_cast<FilteredTree<T>*>(other.get())) {
+    }
+    FilteredTree& operator=(const FilteredTree& other) {
+        if (tree_ == other.tree_) {
+            return *this;
+        }
+        FilteredTree copy(other);
+        Swap(copy);
+        return *this;
+    }
+    FilteredTree& operator=(FilteredTree&& other) noexcept {
+        if (tree_ == other.tree_) {
+            return *this;
+        }
+        Swap(other);
+        return *this;
+    }
+
+    ~FilteredTree() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return tree_->size();
+    }
+    [[nodiscard]] bool Empty() const override {
+        return tree_->empty();
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        if (!MayContain(value)) {
+            return End();
+        }
+        return ITree<T>::FindOf(*tree_, value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return ITree<T>::LowerBoundOf(*tree_, value);
+    }
+
+    void Insert(const T& value) override {
+        tree_->insert(value);
+        if constexpr (IsHashable<T>::value) {
+            filter_.Add(std::hash<T>{}(value));
+        }
+        if (tree_->size() > capacity_) {
+            Rebuild();
+        }
+    }
+    void Erase(const T& value) override {
+        if (!MayContain(value)) {
+            return;
+        }
+        size_t size = tree_->size();
+        tree_->erase(value);
+        if (tree_->size() != size && ++erased_ > tree_->size()) {
+            Rebuild();
+        }
+    }
+
+    void Clear() override {
+        tree_->clear();
+        Rebuild();
+    }
+
+    /**
+     * Builds the wrapped tree from the values and the filter from the tree
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        tree_->build_from_sorted(std::move(values));
+        Rebuild();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * The wrapped tree is a plain ITree, so the key is converted to T once
+     * @tparam K Key type, which T can be constructed from (e.g. 'std::string_view')
+     * @param key Key to look for
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(Find(T(key)));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBound(T(key)));
+    }
+    template <class K>
+    void erase(const K& key) {
+        Erase(T(key));
+    }
+
+    /**
+     * @return False if the value is surely not stored
+     */
+    [[nodiscard]] bool MayContain(const T& value) const {
+        if constexpr (IsHashable<T>::value) {
+            return filter_.MayContain(std::hash<T>{}(value));
+        } else {
+            return true;
+        }
+    }
+
+    /**
+     * @return Number of erased values, which may still pass the filter
+     */
+    [[nodiscard]] size_t StaleValues() const {
+        return erased_;
+    }
+
+private:
+    TreeFactory make_tree_;
+    size_t bits_per_value_;
+    std::shared_ptr<ITree<T>> tree_;
+    BloomFilter filter_;
+    /// Number of values the filter is built for
+    size_t capacity_ = 0;
+    /// Number of values erased since the filter was built
+    size_t erased_ = 0;
+
+    void Swap(FilteredTree& other) {
+        std::swap(make_tree_, other.make_tree_);
+        std::swap(bits_per_value_, other.bits_per_value_);
+        std::swap(tree_, other.tree_);
+        std::swap(filter_, other.filter_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(erased_, other.erased_);
+    }
+
+    /**
+     * Builds the filter from the values of the tree with room for as many new ones
+     */
+    void Rebuild() {
+        capacity_ = std::max(kMinCapacity, 2 * tree_->size());
+        erased_ = 0;
+        if constexpr (IsHashable<T>::value) {
+            filter_ = BloomFilter(capacity_, bits_per_value_);
+            for (auto it = tree_->begin(); it != tree_->end(); ++it) {
+                filter_.Add(std::hash<T>{}(*it));
+            }
+        }
+    }
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return ITree<T>::BeginOf(*tree_);
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return ITree<T>::EndOf(*tree_);
+    }
+};
@@ -0,0 +1,414 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+template <class T>
+class ITree;
+
+/**
+ * Value types, which can be shifted inside an array: move assignable ones
+ */
+template <class T>
+struct IsFlatValue : std::is_move_assignable<T> {};
+
+/**
+ * Set in a sorted contiguous array with buffered updates.
+ *
+ * Values live in the sorted main array. Inserted values go to a small sorted buffer and erased
+ * values of the main array are remembered in a small sorted list of erased values, so an update
+ * moves only the buffer. When both of them together grow larger than the square root of the
+ * main array, they are merged into it in one linear pass, which makes updates amortized
+ * O(sqrt(n)) and keeps lookups to two binary searches.
+ *
+ * Iterators remember their value and the version of the set they were positioned at.
+ * After the set is modified they find their place again by the value, so they stay valid
+ * even when the value itself is erased.
+ */
+template <class T>
+class FlatSet : public ITree<T> {
+    static_assert(IsFlatValue<T>::value, "FlatSet supports only move assignable values");
+
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// Buffer size, below which updates are never merged into the main array
+    static constexpr size_t kMinBufferSize = 32;
+
+    struct Storage {
+        /// Sorted values, some of which may be erased
+        std::vector<T> main_;
+        /// Sorted inserted values, none of which are in the main array
+        std::vector<T> buffer_;
+        /// Sorted erased values of the main array
+        std::vector<T> erased_;
+        /// Increased on every modification
+        uint64_t version_ = 0;
+
+        [[nodiscard]] bool IsErased(const T& value) const {
+            return !erased_.empty() && std::binary_search(erased_.begin(), erased_.end(), value);
+        }
+
+        /**
+         * @return First position of the main array starting from 'pos' with a value, which
+         * isn't erased
+         */
+        [[nodiscard]] size_t SkipErased(size_t pos) const {
+            while (pos < main_.size() && IsErased(main_[pos])) {
+                ++pos;
+            }
+            return pos;
+        }
+    };
+
+    FlatSet() : storage_(std::make_shared<Storage>()) {
+    }
+
+    template <class InitIterator>
+    FlatSet(InitIterator begin, InitIterator end) : FlatSet() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    FlatSet(std::initializer_list<T> list) : FlatSet() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    FlatSet(const FlatSet& other) : storage_(std::make_shared<Storage>(*other.storage_)) {
+    }
+    FlatSet(FlatSet&& other) noexcept : FlatSet() {
+        std::swap(storage_, other.storage_);
+    }
+    FlatSet(std::shared_ptr<ITree<T>> other) : FlatSet(*dynamic_cast<FlatSet<T>*>(other.get())) {
+    }
+    FlatSet& operator=(const FlatSet& other) {
+        if (storage_ == other.storage_) {
+            return *this;
+        }
+        storage_ = std::make_shared<Storage>(*other.storage_);
+        return *this;
+    }
+    FlatSet& operator=(FlatSet&& other) noexcept {
+        if (storage_ == other.storage_) {
+            return *this;
+        }
+        std::swap(storage_, other.storage_);
+        return *this;
+    }
+
+    ~FlatSet() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return storage_->main_.size() - storage_->erased_.size() + storage_->buffer_.size();
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !Size();
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        Storage& storage = *storage_;
+        auto main_it = std::lower_bound(storage.main_.begin(), storage.main_.end(), value);
+        if (main_it != storage.main_.end() && !(value < *main_it)) {
+            auto erased_it =
+                std::lower_bound(storage.erased_.begin(), storage.erased_.end(), value);
+            if (erased_it != storage.erased_.end() && !(value < *erased_it)) {
+                storage.erased_.erase(erased_it);
+                ++storage.version_;
+            }
+            return;
+        }
+        auto buffer_it = std::lower_bound(storage.buffer_.begin(), storage.buffer_.end(), value);
+        if (buffer_it != storage.buffer_.end() && !(value < *buffer_it)) {
+            return;
+        }
+        storage.buffer_.insert(buffer_it, value);
+        ++storage.version_;
+        MergeIfFull();
+    }
+    void Erase(const T& value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        storage_ = std::make_shared<Storage>();
+    }
+
+    /**
+     * Takes the values as the main array, no sorting or merging is needed
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        storage_->main_ = std::move(values);
+    }
+
+    /**
+     * Merges the buffer and the erased values into the main array
+     */
+    void Merge() {
+        Storage& storage = *storage_;
+        std::vector<T> merged;
+        merged.reserve(Size());
+        auto buffer_it = storage.buffer_.begin();
+        auto erased_it = storage.erased_.begin();
+        for (T& value : storage.main_) {
+            if (erased_it != storage.erased_.end() && !(value < *erased_it)) {
+                ++erased_it;
+                continue;
+            }
+            for (; buffer_it != storage.buffer_.end() && *buffer_it < value; ++buffer_it) {
+                merged.push_back(std::move(*buffer_it));
+            }
+            merged.push_back(std::move(value));
+        }
+        for (; buffer_it != storage.buffer_.end(); ++buffer_it) {
+            merged.push_back(std::move(*buffer_it));
+        }
+        storage.main_.swap(merged);
+        storage.buffer_.clear();
+        storage.erased_.clear();
+        ++storage.version_;
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        EraseImpl(key);
+    }
+
+private:
+    /// Iterators share the storage, so they outlive Clear() and moves of the set
+    std::shared_ptr<Storage> storage_;
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        const Storage& storage = *storage_;
+        auto buffer_it = std::lower_bound(storage.buffer_.begin(), storage.buffer_.end(), key);
+        auto main_it = std::lower_bound(storage.main_.begin(), storage.main_.end(), key);
+        bool in_buffer = buffer_it != storage.buffer_.end() && !(key < *buffer_it);
+        bool in_main =
+            main_it != storage.main_.end() && !(key < *main_it) && !storage.IsErased(*main_it);
+        if (!in_buffer && !in_main) {
+            return End();
+        }
+        return std::make_shared<FlatSetItImpl>(storage_, main_it - storage.main_.begin(),
+                                               buffer_it - storage.buffer_.begin());
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        auto it = std::make_shared<FlatSetItImpl>(storage_);
+        it->Seek(key, false);
+        return it;
+    }
+
+    template <class K>
+    void EraseImpl(const K& key) {
+        Storage& storage = *storage_;
+        auto buffer_it = std::lower_bound(storage.buffer_.begin(), storage.buffer_.end(), key);
+        if (buffer_it != storage.buffer_.end() && !(key < *buffer_it)) {
+            storage.buffer_.erase(buffer_it);
+            ++storage.version_;
+            return;
+        }
+        auto main_it = std::lower_bound(storage.main_.begin(), storage.main_.end(), key);
+        if (main_it == storage.main_.end() || key < *main_it) {
+            return;
+        }
+        auto erased_it = std::lower_bound(storage.erased_.begin(), storage.erased_.end(), key);
+        if (erased_it != storage.erased_.end() && !(key < *erased_it)) {
+            return;
+        }
+        storage.erased_.insert(erased_it, *main_it);
+        ++storage.version_;
+        MergeIfFull();
+    }
+
+    void MergeIfFull() {
+        const Storage& storage = *storage_;
+        size_t pending = storage.buffer_.size() + storage.erased_.size();
+        if (pending > kMinBufferSize && pending * pending > storage.main_.size()) {
+            Merge();
+        }
+    }
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class FlatSetItImpl : public BaseImpl {
+    public:
+        FlatSetItImpl() = delete;
+        /// Iterator to the end
+        explicit FlatSetItImpl(std::shared_ptr<Storage> storage)
+            : storage_(std::move(storage)),
+              version_(storage_->version_),
+              main_pos_(storage_->main_.size()),
+              buffer_pos_(storage_->buffer_.size()) {
+        }
+        FlatSetItImpl(std::shared_ptr<Storage> storage, size_t main_pos, size_t buffer_pos)
+            : storage_(std::move(storage)),
+              version_(storage_->version_),
+              main_pos_(storage_->SkipErased(main_pos)),
+              buffer_pos_(buffer_pos) {
+            UpdateValue();
+        }
+        FlatSetItImpl(const FlatSetItImpl& other) = default;
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<FlatSetItImpl>(*this);
+        }
+        void Increment() override {
+            if (!value_) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (version_ != storage_->version_) {
+                Seek(*value_, true);
+                return;
+            }
+            const Storage& storage = *storage_;
+            if (buffer_pos_ < storage.buffer_.size() &&
+                !(*value_ < storage.buffer_[buffer_pos_])) {
+                ++buffer_pos_;
+            } else {
+                main_pos_ = storage.SkipErased(main_pos_ + 1);
+            }
+            UpdateValue();
+        }
+        void Decrement() override {
+            if (version_ != storage_->version_) {
+                if (value_) {
+                    Seek(*value_, false);
+                } else {
+                    main_pos_ = storage_->main_.size();
+                    buffer_pos_ = storage_->buffer_.size();
+                    version_ = storage_->version_;
+                }
+            }
+            const Storage& storage = *storage_;
+            size_t main_pos = main_pos_;
+            while (main_pos && storage.IsErased(storage.main_[main_pos - 1])) {
+                --main_pos;
+            }
+            bool has_main = main_pos > 0;
+            bool has_buffer = buffer_pos_ > 0;
+            if (!has_main && !has_buffer) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            if (has_buffer &&
+                (!has_main || storage.main_[main_pos - 1] < storage.buffer_[buffer_pos_ - 1])) {
+                --buffer_pos_;
+            } else {
+                main_pos_ = main_pos - 1;
+            }
+            UpdateValue();
+        }
+        const T Dereferencing() const override {
+            if (!value_) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return *value_;
+        }
+        const T* Arrow() const override {
+            if (!value_) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &*value_;
+        }
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<FlatSetItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            if (storage_ != casted->storage_ || value_.has_value() != casted->value_.has_value()) {
+                return false;
+            }
+            return !value_ || (!(*value_ < *casted->value_) && !(*casted->value_ < *value_));
+        }
+
+        /**
+         * Positions the iterator at the first value not less than (or greater than) the key
+         * @param key Key to look for
+         * @param strict Whether to skip the values equal to the key
+         */
+        template <class K>
+        void Seek(const K& key, bool strict) {
+            const Storage& storage = *storage_;
+            auto bound = [&key, strict](const std::vector<T>& values) {
+                return static_cast<size_t>(
+                    (strict ? std::upper_bound(values.begin(), values.end(), key)
+                            : std::lower_bound(values.begin(), values.end(), key)) -
+                    values.begin());
+            };
+            main_pos_ = storage.SkipErased(bound(storage.main_));
+            buffer_pos_ = bound(storage.buffer_);
+            version_ = storage.version_;
+            UpdateValue();
+        }
+
+    private:
+        std::shared_ptr<Storage> storage_;
+        /// Version of the set, which the positions are valid for
+        uint64_t version_;
+        size_t main_pos_;
+        size_t buffer_pos_;
+        /// Current value, empty for the end
+        std::optional<T> value_;
+
+        /**
+         * Takes the smaller of the values at both positions
+         */
+        void UpdateValue() {
+            const Storage& storage = *storage_;
+            bool has_main = main_pos_ < storage.main_.size();
+            bool has_buffer = buffer_pos_ < storage.buffer_.size();
+            if (has_buffer &&
+                (!has_main || storage.buffer_[buffer_pos_] < storage.main_[main_pos_])) {
+                value_.emplace(storage.buffer_[buffer_pos_]);
+            } else if (has_main) {
+                value_.emplace(storage.main_[main_pos_]);
+            } else {
+                value_.reset();
+            }
+        }
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<FlatSetItImpl>(storage_, 0, 0);
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<FlatSetItImpl>(storage_);
+    }
+};
@@ -0,0 +1,376 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+template <class T>
+class ITree;
+
+/**
+ * Read-only snapshot of a set: a perfectly balanced search tree laid out in
+ * van Emde Boas order in one contiguous array.
+ *
+ * The tree of height h is cut at height h / 2: the top subtree is stored first and
+ * every bottom subtree follows it as a contiguous block, each of them laid out the same way
+ * recursively. Whatever the size of a cache line or a page is, a root-to-leaf path crosses
+ * O(log_B n) blocks of that size, so lookups are cache-friendly without any tuning.
+ *
+ * Children are 32-bit offsets into the array. The shape of the tree is the one of binary search
+ * on the sorted values, so a lookup knows the rank of every node it visits and iterators
+ * are just ranks.
+ *
+ * Freeze a live tree by constructing the snapshot from it, the snapshot can't be modified.
+ * Copies share the layout.
+ */
+template <class T>
+class FrozenTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// Offset of an absent child
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node {
+        T value_;
+        uint32_t left_;
+        uint32_t right_;
+    };
+
+    struct Layout {
+        /// Nodes in van Emde Boas order, the root comes first
+        std::vector<Node> nodes_;
+        /// Offset of the node for every rank
+        std::vector<uint32_t> offset_;
+    };
+
+    FrozenTree() : layout_(std::make_shared<Layout>()) {
+    }
+
+    /**
+     * Freezes the values of the range, which doesn't have to be sorted
+     */
+    template <class InitIterator>
+    FrozenTree(InitIterator begin, InitIterator end) {
+        std::vector<T> values;
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            values.push_back(*cur);
+        }
+        Build(std::move(values));
+    }
+    FrozenTree(std::initializer_list<T> list) : FrozenTree(list.begin(), list.end()) {
+    }
+
+    /**
+     * Freezes the current contents of a tree of any type
+     * @param tree Tree to take a snapshot of
+     */
+    explicit FrozenTree(const ITree<T>& tree) : FrozenTree(tree.begin(), tree.end()) {
+    }
+
+    FrozenTree(const FrozenTree& other) = default;
+    FrozenTree(FrozenTree&& other) noexcept : FrozenTree() {
+        std::swap(layout_, other.layout_);
+    }
+    FrozenTree(std::shared_ptr<ITree<T>> other)
+        : FrozenTree(*dynamic_cast<FrozenTree<T>*>(other.get())) {
+    }
+    FrozenTree& operator=(const FrozenTree& other) = default;
+    FrozenTree& operator=(FrozenTree&& other) noexcept {
+        std::swap(layout_, other.layout_);
+        return *this;
+    }
+
+    ~FrozenTree() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return layout_->offset_.size();
+    }
+    [[nodiscard]] bool Empty() const override {
+        return layout_->offset_.empty();
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        const std::vector<Node>& nodes = layout_->nodes_;
+        uint32_t offset = nodes.empty() ? kNone : 0;
+        uint32_t lo = 0, hi = nodes.size();
+        while (offset != kNone) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const Node& node = nodes[offset];
+            if (value < node.value_) {
+                hi = mid;
+                offset = node.left_;
+            } else if (node.value_ < value) {
+                lo = mid + 1;
+                offset = node.right_;
+            } else {
+                return std::make_shared<FrozenTreeItImpl>(layout_, mid);
+            }
+        }
+        return End();
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        const std::vector<Node>& nodes = layout_->nodes_;
+        uint32_t offset = nodes.empty() ? kNone : 0;
+        uint32_t lo = 0, hi = nodes.size();
+        uint32_t result = hi;
+        while (offset != kNone) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const Node& node = nodes[offset];
+            if (node.value_ < value) {
+                lo = mid + 1;
+                offset = node.right_;
+            } else {
+                result = hi = mid;
+                offset = node.left_;
+            }
+        }
+        return std::make_shared<FrozenTreeItImpl>(layout_, result);
+    }
+
+    void Insert(const T&) override {
+        throw std::runtime_error("Frozen tree is read-only");
+    }
+    void Erase(const T&) override {
+        throw std::runtime_error("Frozen tree is read-only");
+    }
+    void Clear() override {
+        throw std::runtime_error("Frozen tree is read-only");
+    }
+
+    /**
+     * @return Nodes and offsets of the snapshot, e.g. to write them to a file
+     */
+    [[nodiscard]] const Layout& GetLayout() const {
+        return *layout_;
+    }
+
+    /**
+     * Checks that the nodes are in van Emde Boas order:
+     * the top half of every subtree precedes its bottom subtrees
+     * and every subtree takes a contiguous block
+     */
+    void CheckLayout() const {
+        const std::vector<Node>& nodes = layout_->nodes_;
+        if (nodes.empty()) {
+            return;
+        }
+        uint32_t first = 0;
+        CheckLayoutRecursive(0, nodes.size(), Height(nodes.size()), first);
+        if (first != nodes.size()) {
+            throw std::runtime_error("Nodes are not contiguous");
+        }
+        for (size_t rank = 1; rank < layout_->offset_.size(); ++rank) {
+            if (!(nodes[layout_->offset_[rank - 1]].value_ <
+                  nodes[layout_->offset_[rank]].value_)) {
+                throw std::runtime_error("Values are not sorted");
+            }
+        }
+    }
+
+private:
+    std::shared_ptr<const Layout> layout_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class FrozenTreeItImpl : public BaseImpl {
+    public:
+        FrozenTreeItImpl() = delete;
+        FrozenTreeItImpl(std::shared_ptr<const Layout> layout, uint32_t rank)
+            : layout_(std::move(layout)), rank_(rank) {
+        }
+        FrozenTreeItImpl(const FrozenTreeItImpl& other) = default;
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<FrozenTreeItImpl>(*this);
+        }
+        void Increment() override {
+            if (rank_ == layout_->offset_.size()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            ++rank_;
+        }
+        void Decrement() override {
+            if (!rank_) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            --rank_;
+        }
+        const T Dereferencing() const override {
+            if (rank_ == layout_->offset_.size()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return layout_->nodes_[layout_->offset_[rank_]].value_;
+        }
+        const T* Arrow() const override {
+            if (rank_ == layout_->offset_.size()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &layout_->nodes_[layout_->offset_[rank_]].value_;
+        }
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<FrozenTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return layout_ == casted->layout_ && rank_ == casted->rank_;
+        }
+
+    private:
+        std::shared_ptr<const Layout> layout_;
+        uint32_t rank_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<FrozenTreeItImpl>(layout_, 0);
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<FrozenTreeItImpl>(layout_, layout_->offset_.size());
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    /**
+     * @return Height of the tree of binary search on n values
+     */
+    static int Height(uint32_t n) {
+        int height = 0;
+        for (; n; n >>= 1) {
+            ++height;
+        }
+        return height;
+    }
+
+    /**
+     * Lays out sorted unique values
+     * @param values Values to freeze
+     */
+    void Build(std::vector<T> values) {
+        if (!std::is_sorted(values.begin(), values.end())) {
+            std::sort(values.begin(), values.end());
+        }
+        values.erase(std::unique(values.begin(), values.end(),
+                                 [](const T& lhs, const T& rhs) {
+                                     return !(lhs < rhs) && !(rhs < lhs);
+                                 }),
+                     values.end());
+        if (values.size() >= kNone) {
+            throw std::runtime_error("Too many values for 32-bit offsets");
+        }
+        auto layout = std::make_shared<Layout>();
+        uint32_t size = values.size();
+        layout->offset_.resize(size);
+        uint32_t next = 0;
+        Place(0, size, Height(size), layout->offset_, next);
+
+        // Nodes are emitted in offset order, so the ranks are inverted first
+        std::vector<uint32_t> rank_at(size);
+        for (uint32_t rank = 0; rank < size; ++rank) {
+            rank_at[layout->offset_[rank]] = rank;
+        }
+        std::vector<uint32_t> left(size), right(size);
+        Link(0, size, layout->offset_, left, right);
+        layout->nodes_.reserve(size);
+        for (uint32_t offset = 0; offset < size; ++offset) {
+            uint32_t rank = rank_at[offset];
+            layout->nodes_.push_back(Node{std::move(values[rank]), left[rank], right[rank]});
+        }
+        layout_ = std::move(layout);
+    }
+
+    /**
+     * Assigns offsets to the nodes of the top 'height' levels of the subtree
+     * @param lo First rank of the subtree
+     * @param hi Rank next to the last one of the subtree
+     * @param height Number of levels to lay out
+     * @param offset Offsets by rank
+     * @param next Next free offset
+     */
+    static void Place(uint32_t lo, uint32_t hi, int height, std::vector<uint32_t>& offset,
+                      uint32_t& next) {
+        if (lo >= hi || !height) {
+            return;
+        }
+        if (height == 1) {
+            offset[lo + (hi - lo) / 2] = next++;
+            return;
+        }
+        int top = height / 2;
+        Place(lo, hi, top, offset, next);
+        PlaceBottom(lo, hi, top, height - top, offset, next);
+    }
+
+    /**
+     * Lays out the subtrees hanging 'depth' levels below the root of the subtree,
+     * from left to right
+     */
+    static void PlaceBottom(uint32_t lo, uint32_t hi, int depth, int height,
+                            std::vector<uint32_t>& offset, uint32_t& next) {
+        if (lo >= hi) {
+            return;
+        }
+        if (!depth) {
+            Place(lo, hi, height, offset, next);
+            return;
+        }
+        uint32_t mid = lo + (hi - lo) / 2;
+        PlaceBottom(lo, mid, depth - 1, height, offset, next);
+        PlaceBottom(mid + 1, hi, depth - 1, height, offset, next);
+    }
+
+    /**
+     * Fills child offsets by rank
+     * @return Offset of the root of the subtree, 'kNone' for an empty one
+     */
+    static uint32_t Link(uint32_t lo, uint32_t hi, const std::vector<uint32_t>& offset,
+                         std::vector<uint32_t>& left, std::vector<uint32_t>& right) {
+        if (lo >= hi) {
+            return kNone;
+        }
+        uint32_t mid = lo + (hi - lo) / 2;
+        left[mid] = Link(lo, mid, offset, left, right);
+        right[mid] = Link(mid + 1, hi, offset, left, right);
+        return offset[mid];
+    }
+
+    /**
+     * Checks that the top 'height' levels of the subtree start at 'first' and go
+     * in van Emde Boas order, moves 'first' past them
+     */
+    void CheckLayoutRecursive(uint32_t lo, uint32_t hi, int height, uint32_t& first) const {
+        if (lo >= hi || !height) {
+            return;
+        }
+        if (height == 1) {
+            if (layout_->offset_[lo + (hi - lo) / 2] != first++) {
+                throw std::runtime_error("Nodes are not in van Emde Boas order");
+            }
+            return;
+        }
+        int top = height / 2;
+        CheckLayoutRecursive(lo, hi, top, first);
+        CheckBottom(lo, hi, top, height - top, first);
+    }
+
+    void CheckBottom(uint32_t lo, uint32_t hi, int depth, int height, uint32_t& first) const {
+        if (lo >= hi) {
+            return;
+        }
+        if (!depth) {
+            CheckLayoutRecursive(lo, hi, height, first);
+            return;
+        }
+        uint32_t mid = lo + (hi - lo) / 2;
+        CheckBottom(lo, mid, depth - 1, height, first);
+        CheckBottom(mid + 1, hi, depth - 1, height, first);
+    }
+};
@@ -0,0 +1,601 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "bloom_filter.h"
+#include "skip_list.h"
+
+template <class T>
+class ITree;
+
+/**
+ * Log-structured merge set for insert-heavy workloads.
+ *
+ * Updates go to a memtable, which can be any ITree (a skip list by default). Erasures of values
+ * stored in older data are remembered as tombstones in a second tree of the same type.
+ * A full memtable is flushed to an immutable sorted run. Runs go from the oldest to
+ * the newest, and the two newest ones are merged while the older is at most twice as large
+ * as the newer, so there are O(log n) runs and every value is rewritten O(log n) times.
+ * A newer entry shadows older ones, tombstones are dropped when they reach the oldest run.
+ *
+ * Lookups check the memtable and then the runs from the newest one, skipping runs whose
+ * min/max fences or Bloom filters exclude the value.
+ *
+ * Iterators remember their value and look for the next one in the current state of the set,
+ * so they stay valid through flushes and merges.
+ */
+template <class T>
+class LSMSet : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// Makes an empty memtable
+    using MemtableFactory = std::function<std::shared_ptr<ITree<T>>()>;
+
+    static constexpr size_t kDefaultMemtableLimit = 4096;
+    static constexpr size_t kDefaultBloomBits = 10;
+
+    struct Entry {
+        T value_;
+        bool erased_;
+    };
+
+    /**
+     * Immutable sorted run
+     */
+    struct Run {
+        std::vector<Entry> entries_;
+        BloomFilter bloom_;
+
+        /**
+         * Checks the fences and the Bloom filter
+         */
+        [[nodiscard]] bool MayContain(const T& value) const {
+            if (entries_.empty() || value < entries_.front().value_ ||
+                entries_.back().value_ < value) {
+                return false;
+            }
+            if constexpr (IsHashable<T>::value) {
+                return bloom_.MayContain(std::hash<T>{}(value));
+            } else {
+                return true;
+            }
+        }
+
+        /**
+         * @return Entry for the value, nullptr if there is none
+         */
+        [[nodiscard]] const Entry* Find(const T& value) const {
+            auto it = std::lower_bound(
+                entries_.begin(), entries_.end(), value,
+                [](const Entry& entry, const T& key) { return entry.value_ < key; });
+            if (it == entries_.end() || value < it->value_) {
+                return nullptr;
+            }
+            return &*it;
+        }
+    };
+
+    struct State {
+        std::shared_ptr<ITree<T>> memtable_;
+        /// Erased values, which are stored in the runs
+        std::shared_ptr<ITree<T>> tombstones_;
+        /// From the oldest to the newest
+        std::vector<std::shared_ptr<const Run>> runs_;
+        /// Number of runs searched by lookups, for measuring read amplification
+        mutable uint64_t run_probes_ = 0;
+
+        /**
+         * @return Newest entry for the value in the runs, nullptr if there is none
+         */
+        const Entry* FindInRuns(const T& value) const {
+            for (auto run = runs_.rbegin(); run != runs_.rend(); ++run) {
+                if (!(*run)->MayContain(value)) {
+                    continue;
+                }
+                ++run_probes_;
+                if (const Entry* entry = (*run)->Find(value)) {
+                    return entry;
+                }
+            }
+            return nullptr;
+        }
+
+        bool Contains(const T& value) const {
+            if (memtable_->find(value) != memtable_->end()) {
+                return true;
+            }
+            if (!tombstones_->empty() && tombstones_->find(value) != tombstones_->end()) {
+                return false;
+            }
+            const Entry* entry = FindInRuns(value);
+            return entry && !entry->erased_;
+        }
+
+        /**
+         * @param key Value to start from, nullptr for the smallest value
+         * @param strict Whether to skip the key itself
+         * @return Smallest stored value after the key
+         */
+        std::optional<T> Next(const T* key, bool strict) const {
+            // Holds the last skipped candidate, which the search continues from
+            std::unique_ptr<T> skipped;
+            while (true) {
+                std::optional<T> best;
+                auto consider = [&best](const T& value) {
+                    if (!best || value < *best) {
+                        best.emplace(value);
+                    }
+                };
+                auto it = key ? memtable_->lower_bound(*key) : memtable_->begin();
+                if (strict && key && it != memtable_->end() && !(*key < *it)) {
+                    ++it;
+                }
+                if (it != memtable_->end()) {
+                    consider(*it);
+                }
+                for (const auto& run : runs_) {
+                    const std::vector<Entry>& entries = run->entries_;
+                    auto pos = entries.begin();
+                    if (key) {
+                        pos = std::partition_point(
+                            entries.begin(), entries.end(), [key, strict](const Entry& entry) {
+                                return strict ? !(*key < entry.value_) : entry.value_ < *key;
+                            });
+                    }
+                    if (pos != entries.end()) {
+                        consider(pos->value_);
+                    }
+                }
+                if (!best || Contains(*best)) {
+                    return best;
+                }
+                // The candidate is erased, the next one is after it
+                skipped = std::make_unique<T>(std::move(*best));
+                key = skipped.get();
+                strict = true;
+            }
+        }
+
+        /**
+         * @param key Value to start from, nullptr for the end
+         * @return Greatest stored value before the key
+         */
+        std::optional<T> Prev(const T* key) const {
+            std::unique_ptr<T> skipped;
+            while (true) {
+                std::optional<T> best;
+                auto consider = [&best](const T& value) {
+                    if (!best || *best < value) {
+                        best.emplace(value);
+                    }
+                };
+                auto it = key ? memtable_->lower_bound(*key) : memtable_->end();
+                if (it != memtable_->begin()) {
+                    consider(*(--it));
+                }
+                for (const auto& run : runs_) {
+                    const std::vector<Entry>& entries = run->entries_;
+                    auto pos = entries.end();
+                    if (key) {
+                        pos = std::partition_point(
+                            entries.begin(), entries.end(),
+                            [key](const Entry& entry) { return entry.value_ < *key; });
+                    }
+                    if (pos != entries.begin()) {
+                        consider((--pos)->value_);
+                    }
+                }
+                if (!best || Contains(*best)) {
+                    return best;
+                }
+                skipped = std::make_unique<T>(std::move(*best));
+                key = skipped.get();
+            }
+        }
+    };
+
+    LSMSet() : LSMSet([] { return std::make_shared<SkipList<T>>(); }) {
+    }
+
+    /**
+     * @param make_memtable Makes an empty memtable
+     * @param memtable_limit Number of values and tombstones in the memtable, which makes it flush
+     * @param bloom_bits Bloom filter bits per value in a run, 0 for no filters. Runs of values
+     * without 'std::hash' never have filters
+     */
+    explicit LSMSet(MemtableFactory make_memtable, size_t memtable_limit = kDefaultMemtableLimit,
+                    size_t bloom_bits = kDefaultBloomBits)
+        : make_memtable_(std::move(make_memtable)),
+          memtable_limit_(memtable_limit),
+          bloom_bits_(bloom_bits) {
+        if (!memtable_limit_) {
+            throw std::invalid_argument("Memtable limit must be positive");
+        }
+        state_ = NewState();
+        size_ = 0;
+    }
+
+    template <class InitIterator>
+    LSMSet(InitIterator begin, InitIterator end) : LSMSet() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    LSMSet(std::initializer_list<T> list) : LSMSet() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    /// Runs are immutable, so copies share them and copy only the memtable
+    LSMSet(const LSMSet& other)
+        : make_memtable_(other.make_memtable_),
+          memtable_limit_(other.memtable_limit_),
+          bloom_bits_(other.bloom_bits_) {
+        state_ = CopyState(*other.state_);
+        size_ = other.size_;
+    }
+    LSMSet(LSMSet&& other) noexcept : LSMSet() {
+        Swap(other);
+    }
+    LSMSet(std::shared_ptr<ITree<T>> other) : LSMSet(*dynamic_cast<LSMSet<T>*>(other.get())) {
+    }
+    LSMSet& operator=(const LSMSet& other) {
+        if (state_ == other.state_) {
+            return *this;
+        }
+        make_memtable_ = other.make_memtable_;
+        memtable_limit_ = other.memtable_limit_;
+        bloom_bits_ = other.bloom_bits_;
+        state_ = CopyState(*other.state_);
+        size_ = other.size_;
+        return *this;
+    }
+    LSMSet& operator=(LSMSet&& other) noexcept {
+        if (state_ == other.state_) {
+            return *this;
+        }
+        Swap(other);
+        return *this;
+    }
+
+    ~LSMSet() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !size_;
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        if (!state_->Contains(value)) {
+            return End();
+        }
+        return std::make_shared<LSMSetItImpl>(state_, value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return std::make_shared<LSMSetItImpl>(state_, state_->Next(&value, false));
+    }
+
+    void Insert(const T& value) override {
+        State& state = *state_;
+        if (state.Contains(value)) {
+            return;
+        }
+        state.tombstones_->erase(value);
+        state.memtable_->insert(value);
+        ++size_;
+        FlushIfFull();
+    }
+    void Erase(const T& value) override {
+        State& state = *state_;
+        if (!state.Contains(value)) {
+            return;
+        }
+        state.memtable_->erase(value);
+        const Entry* entry = state.FindInRuns(value);
+        if (entry && !entry->erased_) {
+            state.tombstones_->insert(value);
+        }
+        --size_;
+        FlushIfFull();
+    }
+
+    void Clear() override {
+        state_ = NewState();
+        size_ = 0;
+    }
+
+    /**
+     * Makes the values a single bottom run in linear time, the memtable stays empty
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        size_ = values.size();
+        if (values.empty()) {
+            return;
+        }
+        auto run = std::make_shared<Run>();
+        run->entries_.reserve(values.size());
+        for (T& value : values) {
+            run->entries_.push_back(Entry{std::move(value), false});
+        }
+        BuildFilter(*run);
+        state_->runs_.push_back(std::move(run));
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * The memtable is a plain ITree, so the key is converted to T once
+     * @tparam K Key type, which T can be constructed from (e.g. 'std::string_view')
+     * @param key Key to look for
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(Find(T(key)));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBound(T(key)));
+    }
+    template <class K>
+    void erase(const K& key) {
+        Erase(T(key));
+    }
+
+    /**
+     * Writes the memtable to a new run and merges runs, if needed
+     */
+    void Flush() {
+        State& state = *state_;
+        if (state.memtable_->empty() && state.tombstones_->empty()) {
+            return;
+        }
+        auto run = std::make_shared<Run>();
+        run->entries_.reserve(state.memtable_->size() + state.tombstones_->size());
+        // Tombstones are useless without older runs
+        bool bottom = state.runs_.empty();
+        auto value = state.memtable_->begin();
+        auto tombstone = state.tombstones_->begin();
+        while (value != state.memtable_->end() || tombstone != state.tombstones_->end()) {
+            if (tombstone == state.tombstones_->end() ||
+                (value != state.memtable_->end() && *value < *tombstone)) {
+                run->entries_.push_back(Entry{*value, false});
+                ++value;
+            } else {
+                if (!bottom) {
+                    run->entries_.push_back(Entry{*tombstone, true});
+                }
+                ++tombstone;
+            }
+        }
+        state.memtable_ = make_memtable_();
+        state.tombstones_ = make_memtable_();
+        if (!run->entries_.empty()) {
+            BuildFilter(*run);
+            state.runs_.push_back(std::move(run));
+        }
+        Compact();
+    }
+
+    [[nodiscard]] size_t RunCount() const {
+        return state_->runs_.size();
+    }
+
+    /**
+     * @return Number of runs searched by lookups since the set was created or cleared
+     */
+    [[nodiscard]] uint64_t RunProbes() const {
+        return state_->run_probes_;
+    }
+
+    /**
+     * Checks that runs are sorted, their sizes decrease geometrically
+     * and the oldest one has no tombstones
+     */
+    void CheckRuns() const {
+        const auto& runs = state_->runs_;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            const std::vector<Entry>& entries = runs[i]->entries_;
+            if (entries.empty()) {
+                throw std::runtime_error("Empty run");
+            }
+            for (size_t j = 1; j < entries.size(); ++j) {
+                if (!(entries[j - 1].value_ < entries[j].value_)) {
+                    throw std::runtime_error("Run is not sorted");
+                }
+            }
+            if (!i && std::any_of(entries.begin(), entries.end(),
+                                  [](const Entry& entry) { return entry.erased_; })) {
+                throw std::runtime_error("Oldest run has tombstones");
+            }
+        }
+        if (runs.size() >= 2 &&
+            runs[runs.size() - 2]->entries_.size() <= 2 * runs.back()->entries_.size()) {
+            throw std::runtime_error("Newest runs should have been merged");
+        }
+    }
+
+private:
+    MemtableFactory make_memtable_;
+    size_t memtable_limit_;
+    size_t bloom_bits_;
+    /// Iterators share the state, so they outlive Clear() and moves of the set
+    std::shared_ptr<State> state_;
+    size_t size_;
+
+    std::shared_ptr<State> NewState() const {
+        auto state = std::make_shared<State>();
+        state->memtable_ = make_memtable_();
+        state->tombstones_ = make_memtable_();
+        return state;
+    }
+
+    std::shared_ptr<State> CopyState(const State& other) const {
+        auto state = NewState();
+        for (auto it = other.memtable_->begin(); it != other.memtable_->end(); ++it) {
+            state->memtable_->insert(*it);
+        }
+        for (auto it = other.tombstones_->begin(); it != other.tombstones_->end(); ++it) {
+            state->tombstones_->insert(*it);
+        }
+        state->runs_ = other.runs_;
+        return state;
+    }
+
+    void Swap(LSMSet& other) {
+        std::swap(make_memtable_, other.make_memtable_);
+        std::swap(memtable_limit_, other.memtable_limit_);
+        std::swap(bloom_bits_, other.bloom_bits_);
+        std::swap(state_, other.state_);
+        std::swap(size_, other.size_);
+    }
+
+    void FlushIfFull() {
+        const State& state = *state_;
+        if (state.memtable_->size() + state.tombstones_->size() >= memtable_limit_) {
+            Flush();
+        }
+    }
+
+    void BuildFilter(Run& run) const {
+        if constexpr (IsHashable<T>::value) {
+            if (bloom_bits_) {
+                run.bloom_ = BloomFilter(run.entries_.size(), bloom_bits_);
+                for (const Entry& entry : run.entries_) {
+                    run.bloom_.Add(std::hash<T>{}(entry.value_));
+                }
+            }
+        }
+    }
+
+    /**
+     * Merges the newest runs while the older of them is at most twice as large as the newer
+     */
+    void Compact() {
+        auto& runs = state_->runs_;
+        while (runs.size() >= 2 &&
+               runs[runs.size() - 2]->entries_.size() <= 2 * runs.back()->entries_.size()) {
+            auto merged = Merge(*runs[runs.size() - 2], *runs.back(), runs.size() == 2);
+            runs.pop_back();
+            runs.pop_back();
+            if (!merged->entries_.empty()) {
+                runs.push_back(std::move(merged));
+            }
+        }
+    }
+
+    /**
+     * @param bottom Whether the result is the oldest run, so tombstones can be dropped
+     * @return Run with the newest entry for every value
+     */
+    std::shared_ptr<Run> Merge(const Run& older, const Run& newer, bool bottom) const {
+        auto run = std::make_shared<Run>();
+        run->entries_.reserve(older.entries_.size() + newer.entries_.size());
+        auto add = [&run, bottom](const Entry& entry) {
+            if (!bottom || !entry.erased_) {
+                run->entries_.push_back(entry);
+            }
+        };
+        auto old_it = older.entries_.begin();
+        auto new_it = newer.entries_.begin();
+        while (old_it != older.entries_.end() && new_it != newer.entries_.end()) {
+            if (old_it->value_ < new_it->value_) {
+                add(*old_it++);
+            } else {
+                if (!(new_it->value_ < old_it->value_)) {
+                    ++old_it;
+                }
+                add(*new_it++);
+            }
+        }
+        std::for_each(old_it, older.entries_.end(), add);
+        std::for_each(new_it, newer.entries_.end(), add);
+        BuildFilter(*run);
+        return run;
+    }
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class LSMSetItImpl : public BaseImpl {
+    public:
+        LSMSetItImpl() = delete;
+        LSMSetItImpl(std::shared_ptr<const State> state, std::optional<T> value)
+            : state_(std::move(state)), value_(std::move(value)) {
+        }
+        LSMSetItImpl(const LSMSetItImpl& other) = default;
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<LSMSetItImpl>(*this);
+        }
+        void Increment() override {
+            if (!value_) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            std::optional<T> next = state_->Next(&*value_, true);
+            value_.reset();
+            if (next) {
+                value_.emplace(std::move(*next));
+            }
+        }
+        void Decrement() override {
+            std::optional<T> prev = state_->Prev(value_ ? &*value_ : nullptr);
+            if (!prev) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            value_.reset();
+            value_.emplace(std::move(*prev));
+        }
+        const T Dereferencing() const override {
+            if (!value_) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return *value_;
+        }
+        const T* Arrow() const override {
+            if (!value_) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &*value_;
+        }
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<LSMSetItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            if (state_ != casted->state_ || value_.has_value() != casted->value_.has_value()) {
+                return false;
+            }
+            return !value_ || (!(*value_ < *casted->value_) && !(*casted->value_ < *value_));
+        }
+
+    private:
+        std::shared_ptr<const State> state_;
+        /// Current value, empty for the end
+        std::optional<T> value_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<LSMSetItImpl>(state_, state_->Next(nullptr, false));
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<LSMSetItImpl>(state_, std::nullopt);
+    }
+};
@@ -0,0 +1,381 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "frozen_tree.h"
+#include "serialization.h"
+
+template <class T>
+class ITree;
+
+/**
+ * Read-only tree served straight from a memory-mapped file.
+ *
+ * The file holds the layout of FrozenTree as is: nodes in van Emde Boas order with 32-bit
+ * child offsets instead of pointers, followed by the offset of the node for every rank.
+ * Opening maps the file and checks the header only, so the first query doesn't wait for
+ * the whole file to be read and parsed: it touches the pages on its root-to-leaf path,
+ * and the kernel reads them in on demand. Pages stay in the page cache and are shared
+ * by all processes mapping the same file.
+ *
+ * Nothing is checked beyond the header until CheckLayout() is called, but a broken offset
+ * makes a lookup throw instead of reading outside the mapping.
+ *
+ * Write the file with WriteMappedTree(). Copies share the mapping.
+ * @tparam T Tree value type, only arithmetic values are stored in place
+ */
+template <class T>
+class MappedTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    static_assert(std::is_arithmetic_v<T>, "Only arithmetic values are stored in place");
+
+    using Node = typename FrozenTree<T>::Node;
+
+    /// Offset of an absent child
+    static constexpr uint32_t kNone = FrozenTree<T>::kNone;
+    static constexpr char kMagic[4] = {'M', 'T', 'R', 'E'};
+    static constexpr uint32_t kVersion = 1;
+    /// Nodes start after the header at this offset of the file
+    static constexpr size_t kHeaderSize = 64;
+
+    /**
+     * Beginning of the file, numbers are in the byte order of the machine
+     */
+    struct Header {
+        char magic_[4];
+        uint32_t version_;
+        uint32_t value_size_;
+        uint32_t node_size_;
+        uint64_t count_;
+    };
+
+    MappedTree() : mapping_(std::make_shared<Mapping>()) {
+    }
+
+    /**
+     * Maps the file written by WriteMappedTree()
+     * @param path Path to the file
+     */
+    explicit MappedTree(const std::string& path) : mapping_(Map(path)) {
+    }
+
+    MappedTree(const MappedTree& other) = default;
+    MappedTree(MappedTree&& other) noexcept : MappedTree() {
+        std::swap(mapping_, other.mapping_);
+    }
+    MappedTree(std::shared_ptr<ITree<T>> other)
+        : MappedTree(*dynamic_cast<MappedTree<T>*>(other.get())) {
+    }
+    MappedTree& operator=(const MappedTree& other) = default;
+    MappedTree& operator=(MappedTree&& other) noexcept {
+        std::swap(mapping_, other.mapping_);
+        return *this;
+    }
+
+    ~MappedTree() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return mapping_->size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !mapping_->size_;
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        const Mapping& mapping = *mapping_;
+        uint32_t offset = mapping.size_ ? 0 : kNone;
+        uint32_t lo = 0, hi = mapping.size_;
+        while (offset != kNone) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const Node& node = mapping.NodeAt(offset);
+            if (value < node.value_) {
+                hi = mid;
+                offset = node.left_;
+            } else if (node.value_ < value) {
+                lo = mid + 1;
+                offset = node.right_;
+            } else {
+                return std::make_shared<MappedTreeItImpl>(mapping_, mid);
+            }
+        }
+        return End();
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        const Mapping& mapping = *mapping_;
+        uint32_t offset = mapping.size_ ? 0 : kNone;
+        uint32_t lo = 0, hi = mapping.size_;
+        uint32_t result = hi;
+        while (offset != kNone) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const Node& node = mapping.NodeAt(offset);
+            if (node.value_ < value) {
+                lo = mid + 1;
+                offset = node.right_;
+            } else {
+                result = hi = mid;
+                offset = node.left_;
+            }
+        }
+        return std::make_shared<MappedTreeItImpl>(mapping_, result);
+    }
+
+    void Insert(const T&) override {
+        throw std::runtime_error("Mapped tree is read-only");
+    }
+    void Erase(const T&) override {
+        throw std::runtime_error("Mapped tree is read-only");
+    }
+    void Clear() override {
+        throw std::runtime_error("Mapped tree is read-only");
+    }
+
+    /**
+     * Reads the whole file and checks that the children of every node are the ones of binary
+     * search on the ranks and that the values are sorted
+     */
+    void CheckLayout() const {
+        const Mapping& mapping = *mapping_;
+        if (CheckSubtree(mapping, 0, mapping.size_) != (mapping.size_ ? 0 : kNone)) {
+            throw std::runtime_error("Root is not the first node");
+        }
+        for (uint32_t rank = 1; rank < mapping.size_; ++rank) {
+            if (!(mapping.NodeOfRank(rank - 1).value_ < mapping.NodeOfRank(rank).value_)) {
+                throw std::runtime_error("Values are not sorted");
+            }
+        }
+    }
+
+private:
+    /**
+     * Mapped file, unmapped when the last tree or iterator using it is gone
+     */
+    struct Mapping {
+        void* address_ = nullptr;
+        size_t length_ = 0;
+        const Node* nodes_ = nullptr;
+        /// Offset of the node for every rank
+        const uint32_t* offset_ = nullptr;
+        uint32_t size_ = 0;
+
+        Mapping() = default;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+        ~Mapping() {
+            if (address_) {
+                munmap(address_, length_);
+            }
+        }
+
+        [[nodiscard]] const Node& NodeAt(uint32_t offset) const {
+            if (offset >= size_) {
+                throw std::runtime_error("Offset is out of the mapped tree");
+            }
+            return nodes_[offset];
+        }
+        [[nodiscard]] const Node& NodeOfRank(uint32_t rank) const {
+            return NodeAt(offset_[rank]);
+        }
+    };
+
+    std::shared_ptr<const Mapping> mapping_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class MappedTreeItImpl : public BaseImpl {
+    public:
+        MappedTreeItImpl() = delete;
+        MappedTreeItImpl(std::shared_ptr<const Mapping> mapping, uint32_t rank)
+            : mapping_(std::move(mapping)), rank_(rank) {
+        }
+        MappedTreeItImpl(const MappedTreeItImpl& other) = default;
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<MappedTreeItImpl>(*this);
+        }
+        void Increment() override {
+            if (rank_ == mapping_->size_) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            ++rank_;
+        }
+        void Decrement() override {
+            if (!rank_) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            --rank_;
+        }
+        const T Dereferencing() const override {
+            if (rank_ == mapping_->size_) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return mapping_->NodeOfRank(rank_).value_;
+        }
+        const T* Arrow() const override {
+            if (rank_ == mapping_->size_) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &mapping_->NodeOfRank(rank_).value_;
+        }
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<MappedTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return mapping_ == casted->mapping_ && rank_ == casted->rank_;
+        }
+
+    private:
+        std::shared_ptr<const Mapping> mapping_;
+        uint32_t rank_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<MappedTreeItImpl>(mapping_, 0);
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<MappedTreeItImpl>(mapping_, mapping_->size_);
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    /**
+     * Maps the file and checks its header and length
+     * @param path Path to the file
+     * @return Mapping with the nodes and offsets found
+     */
+    static std::shared_ptr<Mapping> Map(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open the file of a mapped tree");
+        }
+        struct stat status {};
+        if (fstat(fd, &status) || static_cast<size_t>(status.st_size) < kHeaderSize) {
+            close(fd);
+            throw std::runtime_error("File doesn't contain a mapped tree");
+        }
+        auto mapping = std::make_shared<Mapping>();
+        mapping->length_ = status.st_size;
+        void* address = mmap(nullptr, mapping->length_, PROT_READ, MAP_SHARED, fd, 0);
+        // The mapping stays valid after the descriptor is closed
+        close(fd);
+        if (address == MAP_FAILED) {
+            throw std::runtime_error("Failed to map the file of a mapped tree");
+        }
+        mapping->address_ = address;
+        // Even iteration jumps around the nodes, so reading ahead only wastes memory
+        madvise(address, mapping->length_, MADV_RANDOM);
+
+        Header header{};
+        std::memcpy(&header, address, sizeof(header));
+        if (std::memcmp(header.magic_, kMagic, sizeof(kMagic))) {
+            throw std::runtime_error("File doesn't contain a mapped tree");
+        }
+        if (header.version_ != kVersion) {
+            throw std::runtime_error("Unknown format version of a mapped tree");
+        }
+        if (header.value_size_ != sizeof(T) || header.node_size_ != sizeof(Node)) {
+            throw std::runtime_error("Mapped tree has values of another type");
+        }
+        constexpr size_t kBytesPerValue = sizeof(Node) + sizeof(uint32_t);
+        size_t capacity = (mapping->length_ - kHeaderSize) / kBytesPerValue;
+        if (header.count_ > capacity || header.count_ >= kNone ||
+            kHeaderSize + header.count_ * kBytesPerValue != mapping->length_) {
+            throw std::runtime_error("Length of the file doesn't match the mapped tree");
+        }
+        const char* data = static_cast<const char*>(address);
+        mapping->size_ = header.count_;
+        mapping->nodes_ = reinterpret_cast<const Node*>(data + kHeaderSize);
+        mapping->offset_ =
+            reinterpret_cast<const uint32_t*>(data + kHeaderSize + header.count_ * sizeof(Node));
+        return mapping;
+    }
+
+    /**
+     * Checks the children of the subtree holding the ranks from 'lo' to 'hi'
+     * @return Offset of its root, 'kNone' for an empty one
+     */
+    static uint32_t CheckSubtree(const Mapping& mapping, uint32_t lo, uint32_t hi) {
+        if (lo >= hi) {
+            return kNone;
+        }
+        uint32_t mid = lo + (hi - lo) / 2;
+        const Node& node = mapping.NodeOfRank(mid);
+        if (node.left_ != CheckSubtree(mapping, lo, mid) ||
+            node.right_ != CheckSubtree(mapping, mid + 1, hi)) {
+            throw std::runtime_error("Children don't match the ranks");
+        }
+        return mapping.offset_[mid];
+    }
+};
+
+/**
+ * Writes the values of the tree to a file, which MappedTree serves without loading it
+ * @tparam T Tree value type
+ * @param tree Tree to write
+ * @param path Path to the file, an existing one is replaced
+ */
+template <class T>
+void WriteMappedTree(const ITree<T>& tree, const std::string& path) {
+    using Node = typename MappedTree<T>::Node;
+    FrozenTree<T> frozen(tree);
+    const typename FrozenTree<T>::Layout& layout = frozen.GetLayout();
+
+    typename MappedTree<T>::Header header{};
+    std::memcpy(header.magic_, MappedTree<T>::kMagic, sizeof(header.magic_));
+    header.version_ = MappedTree<T>::kVersion;
+    header.value_size_ = sizeof(T);
+    header.node_size_ = sizeof(Node);
+    header.count_ = layout.offset_.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Failed to create the file of a mapped tree");
+    }
+    std::string buffer(MappedTree<T>::kHeaderSize, '\0');
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    for (const Node& frozen_node : layout.nodes_) {
+        // Padding bytes of the node are zeroed, so equal trees give equal files
+        Node node;
+        std::memset(&node, 0, sizeof(node));
+        node.value_ = frozen_node.value_;
+        node.left_ = frozen_node.left_;
+        node.right_ = frozen_node.right_;
+        buffer.append(reinterpret_cast<const char*>(&node), sizeof(node));
+        if (buffer.size() >= serialization::kBufferSize) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    for (uint32_t offset : layout.offset_) {
+        serialization::Append(buffer, offset);
+        if (buffer.size() >= serialization::kBufferSize) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Failed to write the mapped tree");
+    }
+}
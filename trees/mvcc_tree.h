@@ -0,0 +1,222 @@
+#pragma once
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.h"
+
+template <class T>
+class ITree;
+
+/**
+ * Multiversion wrapper, which lets readers scan consistent snapshots while writers go on.
+ *
+ * Writers update a private tree under a mutex and publish an immutable copy of it
+ * every 'publish_interval' updates with an atomic store of the shared pointer. Readers
+ * take Snapshot() with an atomic load and iterate it without the writers' mutex as long as
+ * they like. A retired version is reclaimed, when the last snapshot of it is released.
+ *
+ * Publishing runs the copy constructor of the tree: O(n) for AVLTree and RBTree,
+ * so the interval amortizes it, and O(1) for PersistentTreap, which can publish every update.
+ *
+ * The ITree interface is the writers' view: it sees every update at once, but must not
+ * be used concurrently with writers. Only Snapshot() is meant for reader threads.
+ * @tparam T Tree value type
+ * @tparam Tree Type of the wrapped tree, its const members must be safe to call concurrently
+ */
+template <class T, class Tree = AVLTree<T>>
+class MVCCTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// Published versions are never changed
+    using Version = std::shared_ptr<const ITree<T>>;
+
+    static constexpr size_t kDefaultPublishInterval = 1024;
+
+    /**
+     * @param publish_interval Number of updates between publications
+     */
+    explicit MVCCTree(size_t publish_interval = kDefaultPublishInterval)
+        : publish_interval_(publish_interval), working_(std::make_shared<Tree>()) {
+        if (!publish_interval_) {
+            throw std::invalid_argument("Publish interval must be positive");
+        }
+        Publish();
+    }
+
+    template <class InitIterator>
+    MVCCTree(InitIterator begin, InitIterator end) : MVCCTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+        Publish();
+    }
+    MVCCTree(std::initializer_list<T> list) : MVCCTree() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+        Publish();
+    }
+
+    MVCCTree(const MVCCTree& other)
+        : publish_interval_(other.publish_interval_),
+          working_(std::make_shared<Tree>(*other.working_)) {
+        Publish();
+    }
+    MVCCTree(MVCCTree&& other) noexcept : MVCCTree() {
+        Swap(other);
+    }
+    MVCCTree(std::shared_ptr<ITree<T>> other)
+        : MVCCTree(*dynamic_cast<MVCCTree<T, Tree>*>(other.get())) {
+    }
+    MVCCTree& operator=(const MVCCTree& other) {
+        if (working_ == other.working_) {
+            return *this;
+        }
+        MVCCTree copy(other);
+        Swap(copy);
+        return *this;
+    }
+    MVCCTree& operator=(MVCCTree&& other) noexcept {
+        if (working_ == other.working_) {
+            return *this;
+        }
+        Swap(other);
+        return *this;
+    }
+
+    ~MVCCTree() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return working_->size();
+    }
+    [[nodiscard]] bool Empty() const override {
+        return working_->empty();
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return ITree<T>::FindOf(*working_, value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return ITree<T>::LowerBoundOf(*working_, value);
+    }
+
+    void Insert(const T& value) override {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        working_->insert(value);
+        Updated();
+    }
+    void Erase(const T& value) override {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        working_->erase(value);
+        Updated();
+    }
+
+    void Clear() override {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        working_->clear();
+        Updated();
+    }
+
+    /**
+     * Builds the private tree from the values and publishes it at once
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        working_->build_from_sorted(std::move(values));
+        PublishLocked();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * The wrapped tree is a plain ITree, so the key is converted to T once
+     * @tparam K Key type, which T can be constructed from (e.g. 'std::string_view')
+     * @param key Key to look for
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(Find(T(key)));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBound(T(key)));
+    }
+    template <class K>
+    void erase(const K& key) {
+        Erase(T(key));
+    }
+
+    /**
+     * Safe to call from any thread at any time
+     * @return Last published version, it stays the same while it is held
+     */
+    [[nodiscard]] Version Snapshot() const {
+        return std::atomic_load(&published_);
+    }
+
+    /**
+     * Publishes the current state at once, without waiting for the interval
+     */
+    void Publish() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        PublishLocked();
+    }
+
+    /**
+     * @return Number of updates, which readers don't see yet
+     */
+    [[nodiscard]] size_t UnpublishedUpdates() const {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return unpublished_;
+    }
+
+private:
+    size_t publish_interval_;
+    std::shared_ptr<Tree> working_;
+    /// Accessed only with atomic loads and stores
+    Version published_;
+    size_t unpublished_ = 0;
+    mutable std::mutex write_mutex_;
+
+    void Swap(MVCCTree& other) {
+        std::swap(publish_interval_, other.publish_interval_);
+        std::swap(working_, other.working_);
+        std::swap(unpublished_, other.unpublished_);
+        Version published = std::atomic_load(&published_);
+        std::atomic_store(&published_, std::atomic_load(&other.published_));
+        std::atomic_store(&other.published_, std::move(published));
+    }
+
+    /**
+     * Counts an update and publishes, when the interval is over or the tree becomes empty:
+     * the empty copy is free and releases values of the old version. Needs the mutex to be held
+     */
+    void Updated() {
+        if (++unpublished_ >= publish_interval_ || working_->empty()) {
+            PublishLocked();
+        }
+    }
+
+    void PublishLocked() {
+        Version version = std::make_shared<const Tree>(*working_);
+        std::atomic_store(&published_, std::move(version));
+        unpublished_ = 0;
+    }
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return ITree<T>::BeginOf(*working_);
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return ITree<T>::EndOf(*working_);
+    }
+};
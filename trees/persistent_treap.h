@@ -0,0 +1,448 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "fast_random.h"
+
+template <class T>
+class ITree;
+
+/**
+ * Fully persistent treap: nodes are immutable and an update copies only the path from
+ * the root to the changed place, O(log n) nodes, sharing the rest with the previous version.
+ *
+ * A copy of the treap is an O(1) snapshot: both copies share all the nodes and every
+ * later update of one of them is invisible to the other. Inserted() and Erased() return
+ * a new version and leave this one as it is.
+ *
+ * Iterators keep the path from the root of the version they were made from,
+ * so they go on traversing that version after the treap is updated. Iterators of the treap
+ * and of its snapshots never compare equal, though they may point to shared nodes.
+ */
+template <class T>
+class PersistentTreap : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        Node(const T& value, uint32_t priority, NodePtr left, NodePtr right)
+            : value_(value), priority_(priority), left_(std::move(left)), right_(std::move(right)) {
+        }
+
+        T value_;
+        /// Parents have smaller priorities than children
+        uint32_t priority_;
+        NodePtr left_;
+        NodePtr right_;
+    };
+
+    PersistentTreap() : size_(0) {
+    }
+
+    template <class InitIterator>
+    PersistentTreap(InitIterator begin, InitIterator end) : PersistentTreap() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    PersistentTreap(std::initializer_list<T> list) : PersistentTreap() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    /// Snapshot in O(1): nodes are shared, not copied
+    PersistentTreap(const PersistentTreap& other) = default;
+    PersistentTreap(PersistentTreap&& other) noexcept : PersistentTreap() {
+        std::swap(root_, other.root_);
+        std::swap(size_, other.size_);
+    }
+    PersistentTreap(std::shared_ptr<ITree<T>> other)
+        : PersistentTreap(*dynamic_cast<PersistentTreap<T>*>(other.get())) {
+    }
+    PersistentTreap& operator=(const PersistentTreap& other) = default;
+    PersistentTreap& operator=(PersistentTreap&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        std::swap(root_, other.root_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~PersistentTreap() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !size_;
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        if (Contains(value)) {
+            return;
+        }
+        root_ = InsertNode(root_, value, FastRandom::Next32());
+        ++size_;
+    }
+    void Erase(const T& value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        root_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * Builds the treap in linear time: values come in order, so every new node hangs
+     * on the right spine, which is kept on a stack. Nodes are immutable once the build is over
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        std::vector<std::shared_ptr<Node>> spine;
+        for (const T& value : values) {
+            auto node = std::make_shared<Node>(value, FastRandom::Next32(), nullptr, nullptr);
+            while (!spine.empty() && node->priority_ < spine.back()->priority_) {
+                node->left_ = std::move(spine.back());
+                spine.pop_back();
+            }
+            if (!spine.empty()) {
+                spine.back()->right_ = node;
+            }
+            spine.push_back(std::move(node));
+        }
+        root_ = spine.empty() ? nullptr : std::move(spine.front());
+        size_ = values.size();
+    }
+
+    /**
+     * @return New version with the value, this version doesn't change
+     */
+    [[nodiscard]] PersistentTreap Inserted(const T& value) const {
+        PersistentTreap result(*this);
+        result.Insert(value);
+        return result;
+    }
+
+    /**
+     * @return New version without the value, this version doesn't change
+     */
+    [[nodiscard]] PersistentTreap Erased(const T& value) const {
+        PersistentTreap result(*this);
+        result.Erase(value);
+        return result;
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        EraseImpl(key);
+    }
+
+    /**
+     * Checks the order of keys, the heap order of priorities and the size
+     */
+    void CheckTreap() const {
+        if (CheckSubtree(root_, nullptr, nullptr) != size_) {
+            throw std::runtime_error("Size doesn't match the number of nodes");
+        }
+    }
+
+private:
+    NodePtr root_;
+    size_t size_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class PersistentTreapItImpl : public BaseImpl {
+    public:
+        PersistentTreapItImpl() = delete;
+        /**
+         * @param tree Treap, which made the iterator
+         * @param path Path from the root of its version to the current node, empty for the end
+         */
+        PersistentTreapItImpl(const PersistentTreap* tree, std::vector<NodePtr> path)
+            : tree_(tree), root_(tree->root_), path_(std::move(path)) {
+        }
+        PersistentTreapItImpl(const PersistentTreapItImpl& other) = default;
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<PersistentTreapItImpl>(*this);
+        }
+        void Increment() override {
+            if (path_.empty()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (path_.back()->right_) {
+                path_.push_back(path_.back()->right_);
+                while (path_.back()->left_) {
+                    path_.push_back(path_.back()->left_);
+                }
+                return;
+            }
+            NodePtr child;
+            do {
+                child = std::move(path_.back());
+                path_.pop_back();
+            } while (!path_.empty() && path_.back()->right_ == child);
+        }
+        void Decrement() override {
+            if (path_.empty()) {
+                if (!root_) {
+                    throw std::runtime_error("Index out of range while decreasing");
+                }
+                for (NodePtr node = root_; node; node = node->right_) {
+                    path_.push_back(node);
+                }
+                return;
+            }
+            if (path_.back()->left_) {
+                path_.push_back(path_.back()->left_);
+                while (path_.back()->right_) {
+                    path_.push_back(path_.back()->right_);
+                }
+                return;
+            }
+            // Leftmost node has no predecessor, so the path must survive the check
+            size_t depth = path_.size() - 1;
+            while (depth && path_[depth - 1]->left_ == path_[depth]) {
+                --depth;
+            }
+            if (!depth) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            path_.resize(depth);
+        }
+        const T Dereferencing() const override {
+            if (path_.empty()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return path_.back()->value_;
+        }
+        const T* Arrow() const override {
+            if (path_.empty()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &path_.back()->value_;
+        }
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<PersistentTreapItImpl>(other);
+            if (!casted || tree_ != casted->tree_) {
+                return false;
+            }
+            if (path_.empty() || casted->path_.empty()) {
+                return path_.empty() && casted->path_.empty();
+            }
+            return path_.back() == casted->path_.back();
+        }
+
+    private:
+        /// Only identifies the treap, its versions may share nodes
+        const PersistentTreap* tree_;
+        NodePtr root_;
+        std::vector<NodePtr> path_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        std::vector<NodePtr> path;
+        for (NodePtr node = root_; node; node = node->left_) {
+            path.push_back(node);
+        }
+        return std::make_shared<PersistentTreapItImpl>(this, std::move(path));
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<PersistentTreapItImpl>(this, std::vector<NodePtr>());
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    template <class K>
+    bool Contains(const K& key) const {
+        const Node* node = root_.get();
+        while (node) {
+            if (key < node->value_) {
+                node = node->left_.get();
+            } else if (node->value_ < key) {
+                node = node->right_.get();
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        std::vector<NodePtr> path;
+        for (NodePtr node = root_; node;) {
+            path.push_back(node);
+            if (key < node->value_) {
+                node = node->left_;
+            } else if (node->value_ < key) {
+                node = node->right_;
+            } else {
+                return std::make_shared<PersistentTreapItImpl>(this, std::move(path));
+            }
+        }
+        return End();
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        std::vector<NodePtr> path;
+        // Length of the path to the lower bound, 0 if there is none
+        size_t length = 0;
+        for (NodePtr node = root_; node;) {
+            path.push_back(node);
+            if (node->value_ < key) {
+                node = node->right_;
+            } else {
+                length = path.size();
+                node = node->left_;
+            }
+        }
+        path.resize(length);
+        return std::make_shared<PersistentTreapItImpl>(this, std::move(path));
+    }
+
+    template <class K>
+    void EraseImpl(const K& key) {
+        if (!Contains(key)) {
+            return;
+        }
+        root_ = EraseNode(root_, key);
+        --size_;
+    }
+
+    /**
+     * @return Copy of the node with other children
+     */
+    static NodePtr With(const NodePtr& node, NodePtr left, NodePtr right) {
+        return std::make_shared<const Node>(node->value_, node->priority_, std::move(left),
+                                            std::move(right));
+    }
+
+    /**
+     * Splits a treap into keys less than the value and keys greater than it,
+     * copying only the nodes on the split path
+     * @param root Treap to split, must not contain the value
+     * @param value Value to split by
+     * @return Pair of treaps
+     */
+    static std::pair<NodePtr, NodePtr> Split(const NodePtr& root, const T& value) {
+        if (!root) {
+            return {nullptr, nullptr};
+        }
+        if (root->value_ < value) {
+            auto [left, right] = Split(root->right_, value);
+            return {With(root, root->left_, std::move(left)), std::move(right)};
+        }
+        auto [left, right] = Split(root->left_, value);
+        return {std::move(left), With(root, std::move(right), root->right_)};
+    }
+
+    /**
+     * Merges two treaps, every key of lhs must be less than every key of rhs
+     * @return Merged treap, which copies only the nodes on the merge path
+     */
+    static NodePtr Merge(const NodePtr& lhs, const NodePtr& rhs) {
+        if (!lhs || !rhs) {
+            return lhs ? lhs : rhs;
+        }
+        if (lhs->priority_ < rhs->priority_) {
+            return With(lhs, lhs->left_, Merge(lhs->right_, rhs));
+        }
+        return With(rhs, Merge(lhs, rhs->left_), rhs->right_);
+    }
+
+    /**
+     * @param root Treap without the value
+     * @return Treap with the value
+     */
+    static NodePtr InsertNode(const NodePtr& root, const T& value, uint32_t priority) {
+        if (!root || priority < root->priority_) {
+            auto [left, right] = Split(root, value);
+            return std::make_shared<const Node>(value, priority, std::move(left),
+                                                std::move(right));
+        }
+        if (value < root->value_) {
+            return With(root, InsertNode(root->left_, value, priority), root->right_);
+        }
+        return With(root, root->left_, InsertNode(root->right_, value, priority));
+    }
+
+    /**
+     * @param root Treap with the key
+     * @return Treap without the key
+     */
+    template <class K>
+    static NodePtr EraseNode(const NodePtr& root, const K& key) {
+        if (key < root->value_) {
+            return With(root, EraseNode(root->left_, key), root->right_);
+        }
+        if (root->value_ < key) {
+            return With(root, root->left_, EraseNode(root->right_, key));
+        }
+        return Merge(root->left_, root->right_);
+    }
+
+    /**
+     * @param min Value all keys must be greater than, nullptr for no bound
+     * @param max Value all keys must be less than, nullptr for no bound
+     * @return Number of nodes in the subtree
+     */
+    static size_t CheckSubtree(const NodePtr& node, const T* min, const T* max) {
+        if (!node) {
+            return 0;
+        }
+        if ((min && !(*min < node->value_)) || (max && !(node->value_ < *max))) {
+            throw std::runtime_error("Keys are out of order");
+        }
+        for (const NodePtr& child : {node->left_, node->right_}) {
+            if (child && child->priority_ < node->priority_) {
+                throw std::runtime_error("Priorities are out of heap order");
+            }
+        }
+        return 1 + CheckSubtree(node->left_, min, &node->value_) +
+               CheckSubtree(node->right_, &node->value_, max);
+    }
+};
@@ -1,773 +1,732 @@
-#pragma once
-#include <algorithm>
-#include <exception>
-#include <initializer_list>
-#include <memory>
-#include <optional>
-
-template <class T>
-class ITree;
-
-template <class T>
-class RBTree : public ITree<T> {
-private:
-    typedef typename ITree<T>::ITreeItImpl BaseImpl;
-
-public:
-    struct Node {
-        Node() {
-            left_ = nullptr;
-            right_ = nullptr;
-            parent_ = std::weak_ptr<Node>();
-            value_ = std::nullopt;
-            is_red_ = true;
-        }
-
-        explicit Node(const T& value) : value_(value) {
-            left_ = nullptr;
-            right_ = nullptr;
-            parent_ = std::weak_ptr<Node>();
-            is_red_ = true;
-        }
-
-        Node(const Node& other) : value_(other.value_) {
-            left_ = other.left_;
-            right_ = other.right_;
-            parent_ = other.parent_;
-            is_red_ = other.is_red_;
-        }
-
-        std::shared_ptr<Node> left_;
-        std::shared_ptr<Node> right_;
-        std::weak_ptr<Node> parent_;
-        std::optional<T> value_;
-        bool is_red_;
-    };
-
-    RBTree() {
-        end_ = std::make_shared<Node>();
-        begin_ = end_;
-        root_ = end_;
-        size_ = 0;
-    }
-
-    template <class InitIterator>
-    RBTree(InitIterator begin, InitIterator end) : RBTree() {
-        for (InitIterator cur(begin); cur != end; ++cur) {
-            Insert(*cur);
-        }
-    }
-    RBTree(std::initializer_list<T> list) : RBTree() {
-        for (const T& value : list) {
-            Insert(value);
-        }
-    }
-
-    RBTree(const RBTree& other) : RBTree() {
-        for (const T& value : other) {
-            Insert(value);
-        }
-    }
-    RBTree(RBTree&& other) noexcept : RBTree() {
-        std::swap(root_, other.root_);
-        std::swap(begin_, other.begin_);
-        std::swap(end_, other.end_);
-        std::swap(size_, other.size_);
-    }
-    RBTree(std::shared_ptr<ITree<T>> other) : RBTree(*dynamic_cast<RBTree<T>*>(other.get())) {
-    }
-    RBTree& operator=(const RBTree& other) {
-        if (root_ == other.root_) {
-            return *this;
-        }
-        end_ = std::make_shared<Node>();
-        root_ = end_;
-        begin_ = end_;
-        size_ = 0;
-        for (const T& value : other) {
-            Insert(value);
-        }
-        return *this;
-    }
-    RBTree& operator=(RBTree&& other) noexcept {
-        if (root_ == other.root_) {
-            return *this;
-        }
-        std::swap(root_, other.root_);
-        std::swap(begin_, other.begin_);
-        std::swap(end_, other.end_);
-        std::swap(size_, other.size_);
-        return *this;
-    }
-
-    ~RBTree() override {
-        root_ = nullptr;
-        begin_ = nullptr;
-        end_ = nullptr;
-        size_ = 0;
-    }
-
-    [[nodiscard]] size_t Size() const override {
-        return size_;
-    }
-    [[nodiscard]] bool Empty() const override {
-        return !static_cast<bool>(size_);
-    }
-
-    std::shared_ptr<BaseImpl> Find(const T& value) const override {
-        std::optional<T> val(value);
-        return FindImpl(root_, val);
-    }
-
-    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
-        std::optional<T> val(value);
-       return LowerBoundImpl(root_, val);
-    }
-
-    void Insert(const T& value) override {
-        std::shared_ptr<Node> new_node = std::make_shared<Node>(value);
-        if (InsertImplementation(new_node)) {
-            ++size_;
-        }
-    }
-    void Erase(const T& value) override {
-        auto nodeInTree = std::static_pointer_cast<RBTreeItImpl>(Find(value));
-        if (nodeInTree->IsEqual(End())) {
-            return;
-        }
-
-        EraseImplementation(nodeInTree->GetPointer());
-        --size_;
-    }
-
-    void Clear() override {
-        root_ = std::shared_ptr<Node>();
-        begin_ = root_;
-        end_ = root_;
-        size_ = 0;
-    }
-
-    void CheckRB() const {
-        std::vector<int> blackHeight;
-        CheckRBRecursive(root_, blackHeight, 0);
-
-        blackHeight.erase(std::unique(blackHeight.begin(), blackHeight.end()), blackHeight.end());
-        if (blackHeight.size() != 1) {
-            throw std::runtime_error("Black height is different");
-        }
-    }
-
-private:
-    std::shared_ptr<Node> begin_;
-    std::shared_ptr<Node> end_;
-    std::shared_ptr<Node> root_;
-    size_t size_;
-
-    /* ---------------------------------------------------
-     * --------------ITERATOR IMPLEMENTATION--------------
-     * ---------------------------------------------------
-     */
-
-    class RBTreeItImpl : public BaseImpl {
-    public:
-        RBTreeItImpl() = delete;
-        explicit RBTreeItImpl(std::shared_ptr<Node> pointer) : it_(pointer) {
-        }
-        RBTreeItImpl(const RBTreeItImpl& other) : it_(other.it_) {
-        }
-
-        std::shared_ptr<BaseImpl> Clone() const override {
-            return std::make_shared<RBTreeItImpl>(*this);
-        }
-
-        void Increment() override {
-            if (!it_->value_) {
-                throw std::runtime_error("Index out of range while increasing");
-            }
-            if (it_->right_) {
-                it_ = it_->right_;
-                while (it_->left_) {
-                    it_ = it_->left_;
-                }
-            } else {
-                auto parent = it_->parent_.lock();
-                while (parent && parent->right_ == it_) {
-                    it_ = parent;
-                    parent = it_->parent_.lock();
-                }
-                it_ = parent;
-            }
-        }
-        void Decrement() override {
-            if (it_->left_) {
-                it_ = it_->left_;
-                while (it_->right_) {
-                    it_ = it_->right_;
-                }
-            } else {
-                auto parent = it_->parent_.lock();
-                while (parent && parent->left_ == it_) {
-                    it_ = parent;
-                    parent = it_->parent_.lock();
-                }
-                if (parent) {
-                    it_ = parent;
-                } else {
-                    throw std::runtime_error("Index out of range while decreasing");
-                }
-            }
-        }
-
-        const T Dereferencing() const override {
-            if (it_ && !it_->value_) {
-                throw std::runtime_error("Index out of range on operator*");
-            }
-            return it_->value_.value();
-        }
-        const T* Arrow() const override {
-            if (it_ && !it_->value_) {
-                throw std::runtime_error("Index out of range on operator->");
-            }
-            return &it_->value_.value();
-        }
-
-        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
-            auto casted = std::dynamic_pointer_cast<RBTreeItImpl>(other);
-            if (!casted) {
-                return false;
-            }
-            return it_ == casted->it_;
-        }
-
-        std::shared_ptr<Node> GetPointer() const {
-            return it_;
-        }
-
-    private:
-        std::shared_ptr<Node> it_;
-    };
-
-    std::shared_ptr<BaseImpl> Begin() const override {
-        return std::make_shared<RBTreeItImpl>(begin_);
-    }
-    std::shared_ptr<BaseImpl> End() const override {
-        return std::make_shared<RBTreeItImpl>(end_);
-    }
-
-    /* ---------------------------------------------------
-     * ----------------PRIVATE FUNCTIONS------------------
-     * ---------------------------------------------------
-     */
-
-    std::shared_ptr<BaseImpl> FindImpl(std::shared_ptr<Node> from,
-                                            const std::optional<T>& value) const {
-
-        while (from) {
-            if (value < from->value_) {
-                from = from->left_;
-            } else if (from->value_ < value) {
-                from = from->right_;
-            } else {
-                return std::make_shared<RBTreeItImpl>(from);
-            }
-        }
-        return End();
-    };
-    static std::shared_ptr<BaseImpl> LowerBoundImpl(std::shared_ptr<Node> from,
-                                                         const std::optional<T>& value) {
-        while (true) {
-            if (value < from->value_) {
-                if (from->left_) {
-                    from = from->left_;
-                } else {
-                    return std::make_shared<RBTreeItImpl>(from);
-                }
-            } else if (from->value_ < value) {
-                if (from->right_) {
-                    from = from->right_;
-                } else {
-                    auto impl = std::make_shared<RBTreeItImpl>(from);
-                    impl->Increment();
-                    return impl;
-                }
-            } else {
-                return std::make_shared<RBTreeItImpl>(from);
-            }
-        }
-    }
-    void CheckRBRecursive(std::shared_ptr<Node> from, std::vector<int>& blackHeight, int bh) const {
-        auto parent = from->parent_.lock();
-        if (parent) {
-            if (parent->is_red_ && from->is_red_) {
-                throw std::runtime_error("Two red nodes in a row");
-            }
-        }
-        if (!from->is_red_) {
-            ++bh;
-        }
-        if (!from->left_) {
-            blackHeight.push_back(bh);
-        } else {
-            CheckRBRecursive(from->left_, blackHeight, bh);
-        }
-        if (!from->right_) {
-            blackHeight.push_back(bh);
-        } else {
-            CheckRBRecursive(from->right_, blackHeight, bh);
-        }
-    }
-
-    bool InsertImplementation(const std::shared_ptr<Node>& new_node) {
-        if (!root_) {
-            root_ = new_node;
-            RecalcBegin();
-            return true;
-        }
-
-        auto cur_node = root_;
-        auto next_node = cur_node;
-        while (next_node) {
-            cur_node = next_node;
-            if (new_node->value_ < cur_node->value_) {
-                next_node = cur_node->left_;
-
-            } else if (cur_node->value_ < new_node->value_) {
-                next_node = cur_node->right_;
-            } else {
-                RecalcBegin();
-                return false;
-            }
-        }
-
-        if (new_node->value_ < cur_node->value_) {
-            cur_node->left_ = new_node;
-        } else {
-            cur_node->right_ = new_node;
-        }
-        new_node->parent_ = cur_node;
-        RBFixBalanceAfterInsert(new_node);
-
-        RecalcBegin();
-        return true;
-    }
-    void RBFixBalanceAfterInsert(std::shared_ptr<Node> from) {
-        // Node doesn't have a parent
-        if (from->parent_.expired()) {
-            return;
-        }
-
-        auto parent = from->parent_.lock();
-
-        // Everything is okey
-        if (parent->is_red_ == false) {
-            return;
-        }
-
-        // Node doesn't have a grandparent
-        if (parent->parent_.expired()) {
-            parent->is_red_ = false;
-            return;
-        }
-
-        auto grandparent = parent->parent_.lock();
-
-        if (grandparent->right_ == parent) {
-            auto uncle = grandparent->left_;
-            // Uncle is red
-            if (uncle && uncle->is_red_) {
-                parent->is_red_ = false;
-                uncle->is_red_ = false;
-                grandparent->is_red_ = true;
-                RBFixBalanceAfterInsert(grandparent);
-                return;
-            }
-            // Node is left
-            if (parent->left_ == from) {
-                if (grandparent->right_ == parent) {
-                    grandparent->right_ = from;
-                } else {
-                    grandparent->left_ = from;
-                }
-                parent->parent_ = from;
-                parent->left_ = from->right_;
-                if (from->right_) {
-                    from->right_->parent_ = parent;
-                }
-                from->right_ = parent;
-                from->parent_ = grandparent;
-                RBFixBalanceAfterInsert(parent);
-                return;
-            } else {
-                // Big rotation
-                if (!grandparent->parent_.expired()) {
-                    auto grandgrandparent = grandparent->parent_.lock();
-                    if (grandgrandparent->right_ == grandparent) {
-                        grandgrandparent->right_ = parent;
-                    } else {
-                        grandgrandparent->left_ = parent;
-                    }
-                    parent->parent_ = grandgrandparent;
-                } else {
-                    root_ = parent;
-                    parent->parent_ = std::weak_ptr<Node>();
-                }
-                grandparent->right_ = parent->left_;
-                if (parent->left_) {
-                    parent->left_->parent_ = grandparent;
-                }
-                parent->left_ = grandparent;
-                grandparent->parent_ = parent;
-
-                parent->is_red_ = false;
-                grandparent->is_red_ = true;
-                return;
-            }
-            // Node is right
-        } else {
-            auto uncle = grandparent->right_;
-            // Uncle is red
-            if (uncle && uncle->is_red_) {
-                parent->is_red_ = false;
-                uncle->is_red_ = false;
-                grandparent->is_red_ = true;
-
-                RBFixBalanceAfterInsert(grandparent);
-                return;
-            }
-            // Node is right
-            if (parent->right_ == from) {
-                if (grandparent->right_ == parent) {
-                    grandparent->right_ = from;
-                } else {
-                    grandparent->left_ = from;
-                }
-                parent->parent_ = from;
-                parent->right_ = from->left_;
-                if (from->left_) {
-                    from->left_->parent_ = parent;
-                }
-                from->left_ = parent;
-                from->parent_ = grandparent;
-                RBFixBalanceAfterInsert(parent);
-                return;
-            } else {
-                if (!grandparent->parent_.expired()) {
-                    auto ggrandparent = grandparent->parent_.lock();
-                    if (ggrandparent->left_ == grandparent) {
-                        ggrandparent->left_ = parent;
-                    } else {
-                        ggrandparent->right_ = parent;
-                    }
-                    parent->parent_ = ggrandparent;
-                } else {
-                    root_ = parent;
-                    parent->parent_ = std::weak_ptr<Node>();
-                }
-                grandparent->left_ = parent->right_;
-                if (parent->right_) {
-                    parent->right_->parent_ = grandparent;
-                }
-                parent->right_ = grandparent;
-                grandparent->parent_ = parent;
-
-                parent->is_red_ = false;
-                grandparent->is_red_ = true;
-                return;
-            }
-        }
-    }
-
-    void EraseImplementation(std::shared_ptr<Node> delete_node) {
-        auto parent = delete_node->parent_.lock();
-
-        // Node doesn't have children
-        if (!delete_node->right_ && !delete_node->left_) {
-            RBFixBalanceAfterErase(delete_node);
-            if (parent) {
-                if (parent->left_ == delete_node) {
-                    parent->left_ = nullptr;
-                } else {
-                    parent->right_ = nullptr;
-                }
-            } else {
-                root_ = nullptr;
-            }
-        } else if ((delete_node->right_ && !delete_node->left_) ||
-                   (!delete_node->right_ && delete_node->left_)) {
-
-            auto child_node = delete_node->right_ ? delete_node->right_ : delete_node->left_;
-            if (!parent) {
-                root_ = child_node;
-                child_node->parent_ = std::weak_ptr<Node>();
-            } else {
-                if (parent->left_ == delete_node) {
-                    parent->left_ = child_node;
-                } else {
-                    parent->right_ = child_node;
-                }
-                child_node->parent_ = parent;
-
-                if (!delete_node->is_red_ && child_node->is_red_) {
-                    child_node->is_red_ = false;
-                } else if (!delete_node->is_red_ && !child_node->is_red_) {
-
-                    RBFixBalanceAfterErase(child_node);
-                }
-            }
-        } else {
-            auto swap_node = delete_node->right_;
-
-            while (swap_node->left_) {
-                swap_node = swap_node->left_;
-            }
-
-            if (delete_node->right_ == swap_node) {
-                SwapWithChild(delete_node, swap_node);
-            } else {
-                SwapWithOffspring(delete_node, swap_node);
-            }
-            EraseImplementation(delete_node);
-            return;
-        }
-
-        RecalcBegin();
-    }
-    void RBFixBalanceAfterErase(std::shared_ptr<Node> from) {
-        while (!from->is_red_ && root_ != from) {
-            auto parent = from->parent_.lock();
-            if (!parent) {
-                return;
-            }
-            auto sibling = (parent->left_ == from) ? parent->right_ : parent->left_;
-            if (!sibling) {
-                return;
-            }
-            auto sibling_right = sibling->right_;
-            auto sibling_left = sibling->left_;
-            if (parent->left_ == from) {
-                // Brother is red;
-                if (sibling->is_red_) {
-                    sibling->is_red_ = false;
-                    parent->is_red_ = true;
-                    LeftRotate(parent);
-                    sibling = (parent->left_ == from) ? parent->right_ : parent->left_;
-                    sibling_right = sibling->right_;
-                    sibling_left = sibling->left_;
-                }
-                // Brother and children are black
-                if ((!sibling_left || !sibling_left->is_red_) &&
-                    (!sibling_right || !sibling_right->is_red_)) {
-                    sibling->is_red_ = true;
-                    from = parent;
-                } else {
-                    if (!sibling_right || !sibling_right->is_red_) {
-                        sibling->is_red_ = true;
-                        sibling_left->is_red_ = false;
-                        RightRotate(sibling);
-                        sibling = (parent->left_ == from) ? parent->right_ : parent->left_;
-
-                        if (sibling->right_) {
-                            sibling_right = sibling->right_;
-                        } else {
-                            sibling_right = nullptr;
-                        }
-                        if (sibling->left_) {
-                            sibling_left = sibling->left_;
-                        } else {
-                            sibling_left = nullptr;
-                        }
-                    }
-                    sibling->is_red_ = parent->is_red_;
-                    parent->is_red_ = false;
-                    if (sibling_right) {
-                        sibling->right_->is_red_ = false;
-                    }
-                    LeftRotate(parent);
-                    from = root_;
-                }
-            } else {
-                // Brother is red;
-                if (sibling->is_red_) {
-                    sibling->is_red_ = false;
-                    parent->is_red_ = true;
-                    RightRotate(parent);
-                    sibling = (parent->left_ == from) ? parent->right_ : parent->left_;
-                    sibling_right = sibling->right_;
-                    sibling_left = sibling->left_;
-                }
-                // Brother is black
-                if ((!sibling_left || !sibling_left->is_red_) &&
-                    (!sibling_right || !sibling_right->is_red_)) {
-                    sibling->is_red_ = true;
-                    from = parent;
-                } else {
-                    if (!sibling_left || !sibling_left->is_red_) {
-                        sibling->is_red_ = true;
-                        sibling_right->is_red_ = false;
-                        LeftRotate(sibling);
-                        sibling = (parent->left_ == from) ? parent->right_ : parent->left_;
-
-                        if (sibling) {
-                            sibling_right = sibling->right_;
-                        } else {
-                            sibling_right = nullptr;
-                        }
-                        if (sibling) {
-                            sibling_left = sibling->left_;
-                        } else {
-                            sibling_left = nullptr;
-                        }
-                    }
-                    sibling->is_red_ = parent->is_red_;
-                    parent->is_red_ = false;
-                    if (sibling_left) {
-                        sibling_left->is_red_ = false;
-                    }
-                    RightRotate(parent);
-                    from = root_;
-                }
-            }
-        }
-        from->is_red_ = false;
-        root_->is_red_ = false;
-    }
-
-    void SwapWithChild(std::shared_ptr<Node> from_node, std::shared_ptr<Node> swap_node) {
-        auto parent = from_node->parent_.lock();
-        if (parent) {
-            if (parent->left_ == from_node) {
-                parent->left_ = swap_node;
-            } else {
-                parent->right_ = swap_node;
-            }
-        } else {
-            root_ = swap_node;
-        }
-        swap_node->parent_ = parent;
-
-        from_node->right_ = swap_node->right_;
-        if (swap_node->right_) {
-            swap_node->right_->parent_ = from_node;
-        }
-
-        swap_node->right_ = from_node;
-        from_node->parent_ = swap_node;
-
-        swap_node->left_ = from_node->left_;
-        if (from_node->left_) {
-            from_node->left_->parent_ = swap_node;
-        }
-
-        from_node->left_ = nullptr;
-
-        std::swap(swap_node->is_red_, from_node->is_red_);
-    }
-    void SwapWithOffspring(std::shared_ptr<Node> from_node, std::shared_ptr<Node> swap_node) {
-        auto from_parent = from_node->parent_.lock();
-        if (from_parent) {
-            if (from_parent->left_ == from_node) {
-                from_parent->left_ = swap_node;
-            } else {
-                from_parent->right_ = swap_node;
-            }
-        } else {
-            root_ = swap_node;
-        }
-
-        auto swap_parent = swap_node->parent_.lock();
-        if (swap_parent->right_ == swap_node) {
-            swap_parent->right_ = from_node;
-        } else {
-            swap_parent->left_ = from_node;
-        }
-
-        auto tmp_parent = from_node->parent_;
-        from_node->parent_ = swap_node->parent_;
-        swap_node->parent_ = tmp_parent;
-
-        auto tmp_right = swap_node->right_;
-        swap_node->right_ = from_node->right_;
-        from_node->right_->parent_ = swap_node;
-        from_node->right_ = tmp_right;
-        if (from_node->right_) {
-            from_node->right_->parent_ = from_node;
-        }
-
-        swap_node->left_ = from_node->left_;
-        if (from_node->left_) {
-            from_node->left_->parent_ = swap_node;
-        }
-
-        from_node->left_ = nullptr;
-
-        std::swap(swap_node->is_red_, from_node->is_red_);
-    }
-
-    void LeftRotate(std::shared_ptr<Node>& from) {
-        auto parent = from->parent_.lock();
-        auto right_node = from->right_;
-        std::shared_ptr<Node> next_node = nullptr;
-        if (right_node) {
-            next_node = right_node->left_;
-        }
-
-        if (parent) {
-            if (parent->left_ == from) {
-                parent->left_ = right_node;
-            } else {
-                parent->right_ = right_node;
-            }
-        } else {
-            root_ = right_node;
-        }
-
-        if (right_node) {
-            right_node->parent_ = parent;
-            right_node->left_ = from;
-        }
-
-        if (next_node) {
-            next_node->parent_ = from;
-        }
-        from->parent_ = right_node;
-        from->right_ = next_node;
-    }
-    void RightRotate(std::shared_ptr<Node>& from) {
-        auto parent = from->parent_.lock();
-        auto left_node = from->left_;
-        std::shared_ptr<Node> prev_node = nullptr;
-
-        if (left_node) {
-            prev_node = left_node->right_;
-        }
-
-        if (parent) {
-            if (parent->right_ == from) {
-                parent->right_ = left_node;
-            } else {
-                parent->left_ = left_node;
-            }
-        } else {
-            root_ = left_node;
-        }
-
-        if (left_node) {
-            left_node->parent_ = parent;
-            left_node->right_ = from;
-        }
-
-        if (prev_node) {
-            prev_node->parent_ = from;
-        }
-        from->parent_ = left_node;
-        from->left_ = prev_node;
-    }
-    // Set begin_ after modification
-    void RecalcBegin() {
-        auto node = root_;
-        while (node->left_) {
-            node = node->left_;
-        }
-        begin_ = node;
-    }
-};
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "tagged_pointer.h"
+
+template <class T>
+class ITree;
+
+template <class T>
+class RBTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    struct Node;
+
+    /**
+     * Links of a node. The header of the tree is a bare NodeBase without a value:
+     * its left child is the root and it is the only node without a parent.
+     * Parent link is a raw pointer with the color in its lowest bit:
+     * children own their subtrees, so the parent is always alive while the child is in the tree
+     */
+    struct NodeBase {
+        NodeBase* Parent() const {
+            return parent_.Get();
+        }
+        void SetParent(NodeBase* parent) {
+            parent_.Set(parent);
+        }
+        bool IsRed() const {
+            return parent_.Tag();
+        }
+        void SetRed(bool is_red) {
+            parent_.SetTag(is_red);
+        }
+
+        std::shared_ptr<Node> left_;
+        std::shared_ptr<Node> right_;
+        TaggedPointer<NodeBase, 1> parent_;
+    };
+
+    struct Node : NodeBase {
+        explicit Node(const T& value) : value_(value) {
+        }
+
+        T value_;
+    };
+
+    RBTree() {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    template <class InitIterator>
+    RBTree(InitIterator begin, InitIterator end) : RBTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    RBTree(std::initializer_list<T> list) : RBTree() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    RBTree(const RBTree& other) : RBTree() {
+        for (const T& value : other) {
+            Insert(value);
+        }
+    }
+    RBTree(RBTree&& other) noexcept : RBTree() {
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+    }
+    RBTree(std::shared_ptr<ITree<T>> other) : RBTree(*dynamic_cast<RBTree<T>*>(other.get())) {
+    }
+    RBTree& operator=(const RBTree& other) {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Clear();
+        for (const T& value : other) {
+            Insert(value);
+        }
+        return *this;
+    }
+    RBTree& operator=(RBTree&& other) noexcept {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~RBTree() override {
+        begin_ = nullptr;
+        last_ = nullptr;
+        end_ = nullptr;
+        size_ = 0;
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !static_cast<bool>(size_);
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        if (InsertImplementation(value)) {
+            ++size_;
+        }
+    }
+    void Erase(const T& value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * Builds a tree with minimal height in linear time. All the missing children are
+     * on the two lowest levels, so the lowest level is red and the others are black
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        size_ = values.size();
+        end_->left_ = BuildBalanced(values, 0, size_, end_.get(), 0, HeightOfBalanced(size_) - 1);
+        if (size_) {
+            for (begin_ = Root(); begin_->left_; begin_ = begin_->left_.get()) {
+            }
+            for (last_ = Root(); last_->right_; last_ = last_->right_.get()) {
+            }
+        }
+    }
+
+    void CheckRB() const {
+        if (Root() && Root()->IsRed()) {
+            throw std::runtime_error("Root is red");
+        }
+        if (Root()) {
+            std::vector<int> blackHeight;
+            CheckRBRecursive(Root(), blackHeight, 0);
+
+            blackHeight.erase(std::unique(blackHeight.begin(), blackHeight.end()),
+                              blackHeight.end());
+            if (blackHeight.size() != 1) {
+                throw std::runtime_error("Black height is different");
+            }
+        }
+        NodeBase* node = end_.get();
+        while (node->left_) {
+            node = node->left_.get();
+        }
+        if (node != (begin_ ? begin_ : end_.get())) {
+            throw std::runtime_error("Begin is not the leftmost node");
+        }
+        CheckLast();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        EraseImpl(key);
+    }
+
+private:
+    /// Leftmost node, nullptr if the tree is empty
+    Node* begin_;
+    /// Header of the tree: its left child is the root, so every node has a parent
+    std::shared_ptr<NodeBase> end_;
+    /// Rightmost node, nullptr if the tree is empty
+    Node* last_;
+    size_t size_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class RBTreeItImpl : public BaseImpl {
+    public:
+        RBTreeItImpl() = delete;
+        explicit RBTreeItImpl(NodeBase* pointer) : it_(pointer) {
+            Pin();
+        }
+        RBTreeItImpl(const RBTreeItImpl& other) : it_(other.it_), pin_(other.pin_) {
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<RBTreeItImpl>(*this);
+        }
+
+        void Increment() override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (it_->right_) {
+                it_ = it_->right_.get();
+                while (it_->left_) {
+                    it_ = it_->left_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent->right_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                it_ = parent;
+            }
+            Pin();
+        }
+        void Decrement() override {
+            if (it_->left_) {
+                it_ = it_->left_.get();
+                while (it_->right_) {
+                    it_ = it_->right_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent && parent->left_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                if (parent) {
+                    it_ = parent;
+                } else {
+                    throw std::runtime_error("Index out of range while decreasing");
+                }
+            }
+            Pin();
+        }
+
+        const T Dereferencing() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return static_cast<Node*>(it_)->value_;
+        }
+        const T* Arrow() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &static_cast<Node*>(it_)->value_;
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<RBTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+
+        NodeBase* GetPointer() const {
+            return it_;
+        }
+
+    private:
+        /**
+         * Takes shared ownership of the current node through the link of its parent,
+         * so that the node survives its erasure. Header is owned by the tree itself
+         */
+        void Pin() {
+            auto parent = it_->Parent();
+            if (!parent) {
+                pin_ = nullptr;
+            } else if (parent->left_.get() == it_) {
+                pin_ = parent->left_;
+            } else {
+                pin_ = parent->right_;
+            }
+        }
+
+        NodeBase* it_;
+        std::shared_ptr<Node> pin_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<RBTreeItImpl>(begin_ ? begin_ : end_.get());
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<RBTreeItImpl>(end_.get());
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    Node* Root() const {
+        return end_->left_.get();
+    }
+
+    /**
+     * @param node Node in the tree
+     * @return Link of the parent, which owns the node
+     */
+    static std::shared_ptr<Node>& Link(NodeBase* node) {
+        auto parent = node->Parent();
+        return parent->left_.get() == node ? parent->left_ : parent->right_;
+    }
+
+    static bool IsRed(const NodeBase* node) {
+        return node && node->IsRed();
+    }
+
+    /**
+     * Finds the first node not less than the key.
+     * Links are followed instead of copying pointers, so lookups do not touch reference counts
+     * @param key Lookup key
+     * @return Lower bound node, nullptr if there is none
+     */
+    template <class K>
+    Node* LowerBoundNode(const K& key) const {
+        Node* result = nullptr;
+        Node* node = Root();
+        while (node) {
+            if (node->value_ < key) {
+                node = node->right_.get();
+            } else {
+                result = node;
+                node = node->left_.get();
+            }
+        }
+        return result;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        Node* node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return End();
+        }
+        return std::make_shared<RBTreeItImpl>(node);
+    }
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        Node* node = LowerBoundNode(key);
+        return std::make_shared<RBTreeItImpl>(node ? node : end_.get());
+    }
+    template <class K>
+    void EraseImpl(const K& key) {
+        Node* node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return;
+        }
+        // Keeps the node alive until it is unlinked
+        std::shared_ptr<Node> delete_node = Link(node);
+        if (node == last_) {
+            if (node == begin_) {
+                last_ = nullptr;
+            } else {
+                RBTreeItImpl prev(last_);
+                prev.Decrement();
+                last_ = static_cast<Node*>(prev.GetPointer());
+            }
+        }
+        if (node == begin_) {
+            RBTreeItImpl next(begin_);
+            next.Increment();
+            auto next_node = next.GetPointer();
+            begin_ = next_node == end_.get() ? nullptr : static_cast<Node*>(next_node);
+        }
+
+        EraseImplementation(delete_node.get());
+        --size_;
+    }
+
+    void CheckRBRecursive(const NodeBase* from, std::vector<int>& blackHeight, int bh) const {
+        if (from->Parent() != end_.get() && from->Parent()->IsRed() && from->IsRed()) {
+            throw std::runtime_error("Two red nodes in a row");
+        }
+        if (!from->IsRed()) {
+            ++bh;
+        }
+        if (!from->left_) {
+            blackHeight.push_back(bh);
+        } else {
+            if (from->left_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            CheckRBRecursive(from->left_.get(), blackHeight, bh);
+        }
+        if (!from->right_) {
+            blackHeight.push_back(bh);
+        } else {
+            if (from->right_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            CheckRBRecursive(from->right_.get(), blackHeight, bh);
+        }
+    }
+
+    void CheckLast() const {
+        if (!size_) {
+            if (last_) {
+                throw std::runtime_error("Last is set in an empty tree");
+            }
+            return;
+        }
+        RBTreeItImpl prev(end_.get());
+        prev.Decrement();
+        if (prev.GetPointer() != last_) {
+            throw std::runtime_error("Last is not the node before end");
+        }
+    }
+
+    /**
+     * Finds a node to hang the new value on. Values less than the minimum or greater than
+     * the maximum go next to 'begin_' or 'last_' without descending from the root
+     * @param value Value to insert
+     * @param left Used to return the side of the new node
+     * @return Parent for the new node, nullptr if the value is already in the tree
+     */
+    NodeBase* FindParentForInsert(const T& value, bool& left) const {
+        left = true;
+        if (begin_ && value < begin_->value_) {
+            return begin_;
+        }
+        if (last_ && last_->value_ < value) {
+            left = false;
+            return last_;
+        }
+        NodeBase* parent = end_.get();
+        Node* cur_node = Root();
+        while (cur_node) {
+            parent = cur_node;
+            if (value < cur_node->value_) {
+                left = true;
+                cur_node = cur_node->left_.get();
+            } else if (cur_node->value_ < value) {
+                left = false;
+                cur_node = cur_node->right_.get();
+            } else {
+                return nullptr;
+            }
+        }
+        return parent;
+    }
+
+    /**
+     * @param values Values in order
+     * @param begin First value of the range
+     * @param end Value after the last one of the range
+     * @param parent Parent for the root of the range
+     * @param depth Depth of the root of the range
+     * @param red_depth Depth of red nodes, the root is black anyway
+     * @return Root of a tree made of the range, sibling subtrees differ in size by at most one
+     */
+    static std::shared_ptr<Node> BuildBalanced(const std::vector<T>& values, size_t begin,
+                                               size_t end, NodeBase* parent, int depth,
+                                               int red_depth) {
+        if (begin == end) {
+            return nullptr;
+        }
+        size_t middle = begin + (end - begin) / 2;
+        auto node = std::make_shared<Node>(values[middle]);
+        node->SetParent(parent);
+        node->SetRed(depth && depth == red_depth);
+        node->left_ = BuildBalanced(values, begin, middle, node.get(), depth + 1, red_depth);
+        node->right_ = BuildBalanced(values, middle + 1, end, node.get(), depth + 1, red_depth);
+        return node;
+    }
+
+    /**
+     * @param size Number of nodes in a tree built by BuildBalanced()
+     * @return Height of the tree, which is the bit width of its size
+     */
+    static int HeightOfBalanced(size_t size) {
+        return size ? 64 - __builtin_clzll(size) : 0;
+    }
+
+    bool InsertImplementation(const T& value) {
+        bool left;
+        auto parent = FindParentForInsert(value, left);
+        if (!parent) {
+            return false;
+        }
+
+        auto& link = left ? parent->left_ : parent->right_;
+        link = std::make_shared<Node>(value);
+        link->SetParent(parent);
+        link->SetRed(true);
+        if (!begin_ || value < begin_->value_) {
+            begin_ = link.get();
+        }
+        if (!last_ || last_->value_ < value) {
+            last_ = link.get();
+        }
+        RBFixBalanceAfterInsert(link.get());
+        return true;
+    }
+    void RBFixBalanceAfterInsert(NodeBase* from) {
+        // Parent of a red node is never the header: root is black
+        while (from->Parent() != end_.get() && from->Parent()->IsRed()) {
+            auto parent = from->Parent();
+            auto grandparent = parent->Parent();
+            if (grandparent->left_.get() == parent) {
+                auto uncle = grandparent->right_.get();
+                // Uncle is red
+                if (IsRed(uncle)) {
+                    parent->SetRed(false);
+                    uncle->SetRed(false);
+                    grandparent->SetRed(true);
+                    from = grandparent;
+                    continue;
+                }
+                // Node is right
+                if (parent->right_.get() == from) {
+                    from = parent;
+                    LeftRotate(from);
+                    parent = from->Parent();
+                }
+                parent->SetRed(false);
+                grandparent->SetRed(true);
+                RightRotate(grandparent);
+            } else {
+                auto uncle = grandparent->left_.get();
+                // Uncle is red
+                if (IsRed(uncle)) {
+                    parent->SetRed(false);
+                    uncle->SetRed(false);
+                    grandparent->SetRed(true);
+                    from = grandparent;
+                    continue;
+                }
+                // Node is left
+                if (parent->left_.get() == from) {
+                    from = parent;
+                    RightRotate(from);
+                    parent = from->Parent();
+                }
+                parent->SetRed(false);
+                grandparent->SetRed(true);
+                LeftRotate(grandparent);
+            }
+        }
+        Root()->SetRed(false);
+    }
+
+    /**
+     * Unlinks the node from the tree. Erased node keeps its own links,
+     * so that iterators pointing to it can still move forward
+     * @param delete_node Node to erase
+     */
+    void EraseImplementation(NodeBase* delete_node) {
+        // Child, which takes the place of the removed one, and its parent
+        std::shared_ptr<Node> child_node;
+        NodeBase* parent;
+        bool removed_red;
+        if (!delete_node->left_ || !delete_node->right_) {
+            child_node = delete_node->left_ ? delete_node->left_ : delete_node->right_;
+            parent = delete_node->Parent();
+            removed_red = delete_node->IsRed();
+            Transplant(delete_node, child_node);
+        } else {
+            // Successor takes the place and the color of the deleted node
+            auto swap_node = delete_node->right_;
+            while (swap_node->left_) {
+                swap_node = swap_node->left_;
+            }
+            child_node = swap_node->right_;
+            removed_red = swap_node->IsRed();
+            if (swap_node->Parent() == delete_node) {
+                parent = swap_node.get();
+            } else {
+                parent = swap_node->Parent();
+                Transplant(swap_node.get(), child_node);
+                swap_node->right_ = delete_node->right_;
+                swap_node->right_->SetParent(swap_node.get());
+            }
+            swap_node->left_ = delete_node->left_;
+            swap_node->left_->SetParent(swap_node.get());
+            swap_node->SetRed(delete_node->IsRed());
+            Transplant(delete_node, swap_node);
+        }
+        if (!removed_red) {
+            RBFixBalanceAfterErase(child_node.get(), parent);
+        }
+    }
+
+    /**
+     * Hangs the subtree on the place of the node, the node itself is left as is
+     * @param node Node to replace
+     * @param subtree Subtree to hang, may be empty
+     */
+    void Transplant(NodeBase* node, std::shared_ptr<Node> subtree) {
+        auto parent = node->Parent();
+        if (subtree) {
+            subtree->SetParent(parent);
+        }
+        Link(node) = std::move(subtree);
+    }
+
+    /**
+     * Restores black heights after a black node was removed
+     * @param from Node with an extra black, may be null
+     * @param parent Parent of the node
+     */
+    void RBFixBalanceAfterErase(NodeBase* from, NodeBase* parent) {
+        while (from != Root() && !IsRed(from)) {
+            if (parent->left_.get() == from) {
+                auto sibling = parent->right_.get();
+                // Brother is red
+                if (sibling->IsRed()) {
+                    sibling->SetRed(false);
+                    parent->SetRed(true);
+                    LeftRotate(parent);
+                    sibling = parent->right_.get();
+                }
+                // Brother and children are black
+                if (!IsRed(sibling->left_.get()) && !IsRed(sibling->right_.get())) {
+                    sibling->SetRed(true);
+                    from = parent;
+                    parent = from->Parent();
+                } else {
+                    if (!IsRed(sibling->right_.get())) {
+                        sibling->left_->SetRed(false);
+                        sibling->SetRed(true);
+                        RightRotate(sibling);
+                        sibling = parent->right_.get();
+                    }
+                    sibling->SetRed(parent->IsRed());
+                    parent->SetRed(false);
+                    sibling->right_->SetRed(false);
+                    LeftRotate(parent);
+                    from = Root();
+                }
+            } else {
+                auto sibling = parent->left_.get();
+                // Brother is red
+                if (sibling->IsRed()) {
+                    sibling->SetRed(false);
+                    parent->SetRed(true);
+                    RightRotate(parent);
+                    sibling = parent->left_.get();
+                }
+                // Brother and children are black
+                if (!IsRed(sibling->left_.get()) && !IsRed(sibling->right_.get())) {
+                    sibling->SetRed(true);
+                    from = parent;
+                    parent = from->Parent();
+                } else {
+                    if (!IsRed(sibling->left_.get())) {
+                        sibling->right_->SetRed(false);
+                        sibling->SetRed(true);
+                        LeftRotate(sibling);
+                        sibling = parent->left_.get();
+                    }
+                    sibling->SetRed(parent->IsRed());
+                    parent->SetRed(false);
+                    sibling->left_->SetRed(false);
+                    RightRotate(parent);
+                    from = Root();
+                }
+            }
+        }
+        if (from) {
+            from->SetRed(false);
+        }
+    }
+
+    void LeftRotate(NodeBase* from) {
+        auto parent = from->Parent();
+        auto& link = Link(from);
+        auto right_node = from->right_;
+
+        from->right_ = right_node->left_;
+        if (from->right_) {
+            from->right_->SetParent(from);
+        }
+        right_node->left_ = std::move(link);
+        from->SetParent(right_node.get());
+        right_node->SetParent(parent);
+        link = std::move(right_node);
+    }
+    void RightRotate(NodeBase* from) {
+        auto parent = from->Parent();
+        auto& link = Link(from);
+        auto left_node = from->left_;
+
+        from->left_ = left_node->right_;
+        if (from->left_) {
+            from->left_->SetParent(from);
+        }
+        left_node->right_ = std::move(link);
+        from->SetParent(left_node.get());
+        left_node->SetParent(parent);
+        link = std::move(left_node);
+    }
+};
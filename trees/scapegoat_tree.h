@@ -0,0 +1,645 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+template <class T>
+class ITree;
+
+template <class T>
+class ScapegoatTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    struct Node;
+
+    /**
+     * Links of a node. The header of the tree is a bare NodeBase without a value:
+     * its left child is the root and it is the only node without a parent.
+     * Nodes keep no balance data, subtree sizes are counted when a rebuild is needed
+     */
+    struct NodeBase {
+        NodeBase* Parent() const {
+            return parent_;
+        }
+        void SetParent(NodeBase* parent) {
+            parent_ = parent;
+        }
+
+        std::shared_ptr<Node> left_;
+        std::shared_ptr<Node> right_;
+        NodeBase* parent_ = nullptr;
+    };
+
+    struct Node : NodeBase {
+        explicit Node(const T& value) : value_(value) {
+        }
+
+        T value_;
+    };
+
+    ScapegoatTree() : ScapegoatTree(kDefaultAlpha) {
+    }
+
+    /**
+     * Makes an empty tree with the given balance.
+     * Lower alpha keeps the tree lower at the cost of more frequent rebuilds.
+     * @param alpha Largest allowed share of a child subtree in its parent subtree, in [0.5, 1)
+     */
+    explicit ScapegoatTree(double alpha) {
+        if (!(alpha >= 0.5 && alpha < 1.0)) {
+            throw std::invalid_argument("Alpha must be in [0.5, 1)");
+        }
+        alpha_ = alpha;
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+        max_size_ = 0;
+    }
+
+    template <class InitIterator>
+    ScapegoatTree(InitIterator begin, InitIterator end) : ScapegoatTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    ScapegoatTree(std::initializer_list<T> list) : ScapegoatTree() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    ScapegoatTree(const ScapegoatTree& other) : ScapegoatTree(other.alpha_) {
+        for (const T& value : other) {
+            Insert(value);
+        }
+    }
+    ScapegoatTree(ScapegoatTree&& other) noexcept : ScapegoatTree() {
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        std::swap(max_size_, other.max_size_);
+        std::swap(alpha_, other.alpha_);
+    }
+    ScapegoatTree(std::shared_ptr<ITree<T>> other)
+        : ScapegoatTree(*dynamic_cast<ScapegoatTree<T>*>(other.get())) {
+    }
+    ScapegoatTree& operator=(const ScapegoatTree& other) {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Clear();
+        alpha_ = other.alpha_;
+        for (const T& value : other) {
+            Insert(value);
+        }
+        return *this;
+    }
+    ScapegoatTree& operator=(ScapegoatTree&& other) noexcept {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        std::swap(max_size_, other.max_size_);
+        std::swap(alpha_, other.alpha_);
+        return *this;
+    }
+
+    ~ScapegoatTree() override {
+        begin_ = nullptr;
+        last_ = nullptr;
+        end_ = nullptr;
+        size_ = 0;
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !static_cast<bool>(size_);
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        InsertImplementation(value);
+    }
+    void Erase(const T& value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+        max_size_ = 0;
+    }
+
+    /**
+     * Builds a perfectly balanced tree in linear time
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        std::vector<std::shared_ptr<Node>> nodes;
+        nodes.reserve(values.size());
+        for (const T& value : values) {
+            nodes.push_back(std::make_shared<Node>(value));
+        }
+        if (!nodes.empty()) {
+            begin_ = nodes.front().get();
+            last_ = nodes.back().get();
+        }
+        size_ = max_size_ = nodes.size();
+        end_->left_ = Build(nodes, 0, nodes.size(), end_.get());
+    }
+
+    /**
+     * @return Largest allowed share of a child subtree in its parent subtree
+     */
+    [[nodiscard]] double GetAlpha() const {
+        return alpha_;
+    }
+
+    void CheckScapegoat() const {
+        if (Root()) {
+            // Every insertion keeps the depth within the bound, erasures do not increase it
+            int height = CheckScapegoatRecursive(Root());
+            if (height > DepthLimit(max_size_) + 1) {
+                throw std::runtime_error("Tree is higher than alpha allows");
+            }
+        }
+        if (size_ < alpha_ * max_size_) {
+            throw std::runtime_error("Tree was not rebuilt after erasures");
+        }
+        NodeBase* node = end_.get();
+        while (node->left_) {
+            node = node->left_.get();
+        }
+        if (node != (begin_ ? begin_ : end_.get())) {
+            throw std::runtime_error("Begin is not the leftmost node");
+        }
+        CheckLast();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        EraseImpl(key);
+    }
+
+private:
+    /// Leftmost node, nullptr if the tree is empty
+    Node* begin_;
+    /// Header of the tree: its left child is the root, so every node has a parent
+    std::shared_ptr<NodeBase> end_;
+    /// Rightmost node, nullptr if the tree is empty
+    Node* last_;
+    size_t size_;
+    /// Largest size since the last rebuild of the whole tree
+    size_t max_size_;
+    double alpha_;
+
+    static constexpr double kDefaultAlpha = 0.7;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class ScapegoatTreeItImpl : public BaseImpl {
+    public:
+        ScapegoatTreeItImpl() = delete;
+        explicit ScapegoatTreeItImpl(NodeBase* pointer) : it_(pointer) {
+            Pin();
+        }
+        ScapegoatTreeItImpl(const ScapegoatTreeItImpl& other) : it_(other.it_), pin_(other.pin_) {
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<ScapegoatTreeItImpl>(*this);
+        }
+        void Increment() override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (it_->right_) {
+                it_ = it_->right_.get();
+                while (it_->left_) {
+                    it_ = it_->left_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent->right_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                it_ = parent;
+            }
+            Pin();
+        }
+        void Decrement() override {
+            if (it_->left_) {
+                it_ = it_->left_.get();
+                while (it_->right_) {
+                    it_ = it_->right_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent && parent->left_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                if (parent) {
+                    it_ = parent;
+                } else {
+                    throw std::runtime_error("Index out of range while decreasing");
+                }
+            }
+            Pin();
+        }
+
+        const T Dereferencing() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return static_cast<Node*>(it_)->value_;
+        }
+        const T* Arrow() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return& static_cast<Node*>(it_)->value_;
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<ScapegoatTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+        NodeBase* GetPointer() const {
+            return it_;
+        }
+
+    private:
+        /**
+         * Takes shared ownership of the current node through the link of its parent,
+         * so that the node survives its erasure. Header is owned by the tree itself
+         */
+        void Pin() {
+            auto parent = it_->Parent();
+            if (!parent) {
+                pin_ = nullptr;
+            } else if (parent->left_.get() == it_) {
+                pin_ = parent->left_;
+            } else {
+                pin_ = parent->right_;
+            }
+        }
+
+        NodeBase* it_;
+        std::shared_ptr<Node> pin_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<ScapegoatTreeItImpl>(begin_ ? begin_ : end_.get());
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<ScapegoatTreeItImpl>(end_.get());
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    Node* Root() const {
+        return end_->left_.get();
+    }
+
+    /**
+     * @param node Node in the tree
+     * @return Link of the parent, which owns the node
+     */
+    static std::shared_ptr<Node>& Link(NodeBase* node) {
+        auto parent = node->Parent();
+        return parent->left_.get() == node ? parent->left_ : parent->right_;
+    }
+
+    /**
+     * Finds the first node not less than the key.
+     * Links are followed instead of copying pointers, so lookups do not touch reference counts
+     * @param key Lookup key
+     * @return Lower bound node, nullptr if there is none
+     */
+    template <class K>
+    Node* LowerBoundNode(const K& key) const {
+        Node* result = nullptr;
+        Node* node = Root();
+        while (node) {
+            if (node->value_ < key) {
+                node = node->right_.get();
+            } else {
+                result = node;
+                node = node->left_.get();
+            }
+        }
+        return result;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        Node* node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return End();
+        }
+        return std::make_shared<ScapegoatTreeItImpl>(node);
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        Node* node = LowerBoundNode(key);
+        return std::make_shared<ScapegoatTreeItImpl>(node ? node : end_.get());
+    }
+
+    template <class K>
+    void EraseImpl(const K& key) {
+        Node* node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return;
+        }
+        // Keeps the node alive until it is unlinked
+        std::shared_ptr<Node> delete_node = Link(node);
+        if (node == last_) {
+            if (node == begin_) {
+                last_ = nullptr;
+            } else {
+                ScapegoatTreeItImpl prev(last_);
+                prev.Decrement();
+                last_ = static_cast<Node*>(prev.GetPointer());
+            }
+        }
+        if (node == begin_) {
+            ScapegoatTreeItImpl next(begin_);
+            next.Increment();
+            auto next_node = next.GetPointer();
+            begin_ = next_node == end_.get() ? nullptr : static_cast<Node*>(next_node);
+        }
+
+        EraseImplementation(delete_node.get());
+        --size_;
+        if (size_ < alpha_ * max_size_) {
+            if (size_) {
+                Rebuild(Root(), size_);
+            }
+            max_size_ = size_;
+        }
+    }
+
+    /**
+     * @return Number of nodes on the longest path down from the node
+     */
+    int CheckScapegoatRecursive(const NodeBase* from) const {
+        int height_left = 0, height_right = 0;
+        if (from->left_) {
+            if (from->left_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            height_left = CheckScapegoatRecursive(from->left_.get());
+        }
+        if (from->right_) {
+            if (from->right_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            height_right = CheckScapegoatRecursive(from->right_.get());
+        }
+        return std::max(height_left, height_right) + 1;
+    }
+
+    void CheckLast() const {
+        if (!size_) {
+            if (last_) {
+                throw std::runtime_error("Last is set in an empty tree");
+            }
+            return;
+        }
+        ScapegoatTreeItImpl prev(end_.get());
+        prev.Decrement();
+        if (prev.GetPointer() != last_) {
+            throw std::runtime_error("Last is not the node before end");
+        }
+    }
+
+    /**
+     * @param size Number of nodes in the tree
+     * @return Largest depth of a node in an alpha-balanced tree of that size, log_{1/alpha}(size)
+     */
+    int DepthLimit(size_t size) const {
+        return static_cast<int>(std::log(static_cast<double>(size)) / -std::log(alpha_));
+    }
+
+    static size_t SubtreeSize(const NodeBase* node) {
+        return node ? SubtreeSize(node->left_.get()) + SubtreeSize(node->right_.get()) + 1 : 0;
+    }
+
+    /**
+     * Finds the lowest ancestor of a too deep node, which is not alpha-balanced,
+     * and rebuilds its subtree
+     * @param node Inserted node
+     */
+    void RebuildScapegoat(NodeBase* node) {
+        size_t size = 1;
+        while (node->Parent() != end_.get()) {
+            auto parent = node->Parent();
+            auto sibling = parent->left_.get() == node ? parent->right_.get() : parent->left_.get();
+            size_t parent_size = size + SubtreeSize(sibling) + 1;
+            if (size > alpha_ * parent_size) {
+                Rebuild(parent, parent_size);
+                if (parent_size == size_) {
+                    max_size_ = size_;
+                }
+                return;
+            }
+            node = parent;
+            size = parent_size;
+        }
+    }
+
+    /**
+     * Rebuilds the subtree into a perfectly balanced one. Nodes are collected in order
+     * into a contiguous buffer and relinked, so iterators stay valid
+     * @param node Root of the subtree
+     * @param size Number of nodes in the subtree
+     */
+    void Rebuild(NodeBase* node, size_t size) {
+        auto parent = node->Parent();
+        auto& link = Link(node);
+        std::vector<std::shared_ptr<Node>> nodes;
+        nodes.reserve(size);
+        Flatten(link, nodes);
+        link = Build(nodes, 0, nodes.size(), parent);
+    }
+
+    static void Flatten(const std::shared_ptr<Node>& node,
+                        std::vector<std::shared_ptr<Node>>& nodes) {
+        if (!node) {
+            return;
+        }
+        Flatten(node->left_, nodes);
+        nodes.push_back(node);
+        Flatten(node->right_, nodes);
+    }
+
+    /**
+     * @param nodes Nodes in order
+     * @param begin First node of the range
+     * @param end Node after the last one of the range
+     * @param parent Parent for the root of the range
+     * @return Root of a perfectly balanced tree made of the range
+     */
+    static std::shared_ptr<Node> Build(std::vector<std::shared_ptr<Node>>& nodes, size_t begin,
+                                       size_t end, NodeBase* parent) {
+        if (begin == end) {
+            return nullptr;
+        }
+        size_t middle = begin + (end - begin) / 2;
+        auto& node = nodes[middle];
+        node->SetParent(parent);
+        node->left_ = Build(nodes, begin, middle, node.get());
+        node->right_ = Build(nodes, middle + 1, end, node.get());
+        return std::move(node);
+    }
+
+    /**
+     * Finds a node to hang the new value on. Values less than the minimum or greater than
+     * the maximum go next to 'begin_' or 'last_' without descending from the root
+     * @param value Value to insert
+     * @param left Used to return the side of the new node
+     * @return Parent for the new node, nullptr if the value is already in the tree
+     */
+    NodeBase* FindParentForInsert(const T& value, bool& left) const {
+        left = true;
+        if (begin_ && value < begin_->value_) {
+            return begin_;
+        }
+        if (last_ && last_->value_ < value) {
+            left = false;
+            return last_;
+        }
+        NodeBase* parent = end_.get();
+        Node* cur_node = Root();
+        while (cur_node) {
+            parent = cur_node;
+            if (value < cur_node->value_) {
+                left = true;
+                cur_node = cur_node->left_.get();
+            } else if (cur_node->value_ < value) {
+                left = false;
+                cur_node = cur_node->right_.get();
+            } else {
+                return nullptr;
+            }
+        }
+        return parent;
+    }
+
+    void InsertImplementation(const T& value) {
+        bool left;
+        NodeBase* parent = FindParentForInsert(value, left);
+        if (!parent) {
+            return;
+        }
+
+        auto& link = left ? parent->left_ : parent->right_;
+        link = std::make_shared<Node>(value);
+        link->SetParent(parent);
+        if (!begin_ || value < begin_->value_) {
+            begin_ = link.get();
+        }
+        if (!last_ || last_->value_ < value) {
+            last_ = link.get();
+        }
+        ++size_;
+        max_size_ = std::max(max_size_, size_);
+
+        NodeBase* node = link.get();
+        int depth = 0;
+        for (auto cur = parent; cur != end_.get(); cur = cur->Parent()) {
+            ++depth;
+        }
+        if (depth > DepthLimit(size_)) {
+            RebuildScapegoat(node);
+        }
+    }
+
+    /**
+     * Unlinks the node from the tree. Erased node keeps its own links,
+     * so that iterators pointing to it can still move forward
+     * @param delete_node Node to erase
+     */
+    void EraseImplementation(NodeBase* delete_node) {
+        if (!delete_node->left_ || !delete_node->right_) {
+            Transplant(delete_node, delete_node->left_ ? delete_node->left_ : delete_node->right_);
+            return;
+        }
+        // Successor takes the place of the deleted node
+        auto swap_node = delete_node->right_;
+        while (swap_node->left_) {
+            swap_node = swap_node->left_;
+        }
+        if (swap_node->Parent() != delete_node) {
+            Transplant(swap_node.get(), swap_node->right_);
+            swap_node->right_ = delete_node->right_;
+            swap_node->right_->SetParent(swap_node.get());
+        }
+        swap_node->left_ = delete_node->left_;
+        swap_node->left_->SetParent(swap_node.get());
+        Transplant(delete_node, swap_node);
+    }
+
+    /**
+     * Hangs the subtree on the place of the node, the node itself is left as is
+     * @param node Node to replace
+     * @param subtree Subtree to hang, may be empty
+     */
+    void Transplant(NodeBase* node, std::shared_ptr<Node> subtree) {
+        auto parent = node->Parent();
+        if (subtree) {
+            subtree->SetParent(parent);
+        }
+        Link(node) = std::move(subtree);
+    }
+};
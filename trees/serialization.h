@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+template <class T>
+class ITree;
+
+/**
+ * Value types, which trees can be saved with: arithmetic types and strings
+ */
+template <class T>
+struct IsSerializable
+    : std::integral_constant<bool, std::is_arithmetic_v<T> || std::is_same_v<T, std::string>> {
+};
+
+/**
+ * Binary format of a saved tree. Values go in increasing order, so loading builds the tree
+ * in linear time with build_from_sorted() instead of inserting them one by one.
+ *
+ * Header: magic "TREE", format version and value size as uint32, number of values as uint64.
+ * Arithmetic values are stored as raw bytes, strings as uint64 length and bytes.
+ * Numbers are written in the byte order of the machine.
+ */
+namespace serialization {
+constexpr char kMagic[4] = {'T', 'R', 'E', 'E'};
+constexpr uint32_t kVersion = 1;
+/// Bytes collected before a write to the stream
+constexpr size_t kBufferSize = 1 << 16;
+
+/**
+ * @return Size of a stored value, 0 for strings
+ */
+template <class T>
+constexpr uint32_t ValueSize() {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return sizeof(T);
+    } else {
+        return 0;
+    }
+}
+
+template <class Number>
+void Append(std::string& buffer, Number number) {
+    buffer.append(reinterpret_cast<const char*>(&number), sizeof(number));
+}
+
+template <class Number>
+Number Read(std::istream& in) {
+    Number number;
+    if (!in.read(reinterpret_cast<char*>(&number), sizeof(number))) {
+        throw std::runtime_error("Stream ends in the middle of a tree");
+    }
+    return number;
+}
+
+/**
+ * Appends a value: raw bytes of a number or length and bytes of a string
+ */
+template <class T>
+void AppendValue(std::string& buffer, const T& value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        Append(buffer, value);
+    } else {
+        Append(buffer, static_cast<uint64_t>(value.size()));
+        buffer += value;
+    }
+}
+
+/**
+ * Reads a value written by AppendValue()
+ */
+template <class T>
+T ReadValue(std::istream& in) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return Read<T>(in);
+    } else {
+        auto length = Read<uint64_t>(in);
+        std::string value;
+        // Read in blocks, so a broken length can't make a huge allocation at once
+        while (value.size() < length) {
+            size_t loaded = value.size();
+            value.resize(loaded + std::min<uint64_t>(length - loaded, kBufferSize));
+            if (!in.read(value.data() + loaded, value.size() - loaded)) {
+                throw std::runtime_error("Stream ends in the middle of a tree");
+            }
+        }
+        return value;
+    }
+}
+}  // namespace serialization
+
+/**
+ * Writes the values of the tree to the stream
+ * @tparam T Tree value type
+ * @param tree Tree to save
+ * @param out Binary stream
+ */
+template <class T>
+void SaveTree(const ITree<T>& tree, std::ostream& out) {
+    static_assert(IsSerializable<T>::value, "Only arithmetic values and strings are saved");
+    std::string buffer(serialization::kMagic, sizeof(serialization::kMagic));
+    serialization::Append(buffer, serialization::kVersion);
+    serialization::Append(buffer, serialization::ValueSize<T>());
+    serialization::Append(buffer, static_cast<uint64_t>(tree.size()));
+    auto end = tree.end();
+    for (auto it = tree.begin(); it != end; ++it) {
+        serialization::AppendValue(buffer, *it.operator->());
+        if (buffer.size() >= serialization::kBufferSize) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    if (!out) {
+        throw std::runtime_error("Failed to write the tree");
+    }
+}
+
+/**
+ * Replaces the content of the tree with values read from the stream
+ * @tparam T Tree value type
+ * @param tree Tree to load into, its type may differ from the type of the saved one
+ * @param in Binary stream written by SaveTree()
+ */
+template <class T>
+void LoadTree(ITree<T>& tree, std::istream& in) {
+    static_assert(IsSerializable<T>::value, "Only arithmetic values and strings are loaded");
+    char magic[sizeof(serialization::kMagic)];
+    if (!in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, serialization::kMagic, sizeof(magic))) {
+        throw std::runtime_error("Stream doesn't contain a saved tree");
+    }
+    if (serialization::Read<uint32_t>(in) != serialization::kVersion) {
+        throw std::runtime_error("Unknown format version of a saved tree");
+    }
+    if (serialization::Read<uint32_t>(in) != serialization::ValueSize<T>()) {
+        throw std::runtime_error("Saved tree has values of another type");
+    }
+    auto count = serialization::Read<uint64_t>(in);
+    std::vector<T> values;
+    if constexpr (std::is_arithmetic_v<T>) {
+        // Read in blocks, so a broken count can't make a huge allocation at once
+        while (values.size() < count) {
+            size_t loaded = values.size();
+            size_t block = std::min<uint64_t>(count - loaded, serialization::kBufferSize);
+            values.resize(loaded + block);
+            if (!in.read(reinterpret_cast<char*>(values.data() + loaded), block * sizeof(T))) {
+                throw std::runtime_error("Stream ends in the middle of a tree");
+            }
+        }
+    } else {
+        for (uint64_t i = 0; i < count; ++i) {
+            values.push_back(serialization::ReadValue<T>(in));
+        }
+    }
+    tree.build_from_sorted(std::move(values));
+}
@@ -1,8 +1,15 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
 #include <exception>
 #include <initializer_list>
 #include <iostream>
 #include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "fast_random.h"
 
 template <class T>
 class ITree;
@@ -12,118 +19,106 @@ class SkipList : public ITree<T> {
 private:
     typedef typename ITree<T>::ITreeItImpl BaseImpl;
 
-    class Optional {
-    private:
-        std::shared_ptr<T> value_;
-        char info_;
-
-    public:
-        Optional() = delete;
-        Optional(Optional&&) = delete;
-
-        Optional(char newinfo) {
-            info_ = newinfo;
-        }
-
-        Optional(const T& value) {
-            value_ = std::make_shared<T>(const_cast<T&>(value));
-            info_ = 'v';
-        }
-
-        Optional(const Optional& other) {
-            value_ = other.value_;
-            info_ = other.info_;
+public:
+    /// Upper bound for the tower height
+    static constexpr uint32_t kMaxLevel = 64;
+    /// Default tower height cap, enough for 2^32 elements with promotion probability 1/2
+    static constexpr uint32_t kDefaultMaxLevel = 32;
+    /// Default probability of promoting a tower to the next level
+    static constexpr double kDefaultProbability = 0.5;
+
+    /**
+     * Whole tower of the skip list, allocated as a single block:
+     * the node itself is followed by 'height_' forward pointers.
+     * Only the bottom level has a backward pointer.
+     * Sentinels (head and end) have no value: end is the only node
+     * without a forward pointer and head is the only node without a backward one.
+     *
+     * Bottom level forward pointer owns the next tower, so a tower erased while
+     * an iterator points to it still leads to the rest of the list.
+     */
+    struct Node {
+        Node() = delete;
+        Node(const Node& other) = delete;
+
+        explicit Node(uint32_t height) {
+            links_ = 1;
+            prev_ = nullptr;
+            height_ = height;
+            has_value_ = false;
+            for (uint32_t level = 0; level < height; ++level) {
+                Next()[level] = nullptr;
+            }
         }
 
-        ~Optional() {
-            value_ = nullptr;
+        /**
+         * @return Value stored in the tower
+         */
+        const T& Value() const {
+            return *std::launder(reinterpret_cast<const T*>(storage_));
         }
 
-        std::shared_ptr<T> GetValue() const {
-            return this->value_;
+        /**
+         * @return Array of 'height_' forward pointers placed right after the node
+         */
+        Node** Next() {
+            return reinterpret_cast<Node**>(this + 1);
         }
 
-        char GetInfo() const {
-            return this->info_;
+        Node* const* Next() const {
+            return reinterpret_cast<Node* const*>(this + 1);
         }
 
-        bool operator<(const Optional& other) const {
-            if (this->info_ == 'v') {
-                if (other.info_ == 'v') {
-                    return *(this->value_) < *(other.value_);
-                } else {
-                    return other.info_ != 'b';
-                }
-            } else if (this->info_ == 'b') {
-                return other.info_ != 'b';
-            } else {
-                return false;
-            }
-        }
-    };
-    class Random {
-    public:
-        static uint32_t Next(uint32_t to = 1u) {
-            static Random rand = Random();
-            std::uniform_int_distribution<uint32_t> dist(0, to);
-            return dist(rand.gen_);
+        /**
+         * Heterogeneous comparison with a lookup key, no temporary value is built.
+         * End sentinel is larger than any key.
+         * @param key Lookup key
+         * @return True if value < key
+         */
+        template <class K>
+        bool LessThanKey(const K& key) const {
+            return has_value_ && Value() < key;
         }
 
-    private:
-        Random() {
-            std::random_device device;
-            gen_ = std::mt19937(device());
+        /**
+         * @param key Lookup key
+         * @return True if key < value
+         */
+        template <class K>
+        bool GreaterThanKey(const K& key) const {
+            return !has_value_ || key < Value();
         }
 
-        std::mt19937 gen_;
+        /// Number of owners: the previous tower and iterators
+        size_t links_;
+        Node* prev_;
+        uint32_t height_;
+        bool has_value_;
+        alignas(T) unsigned char storage_[sizeof(T)];
     };
 
-public:
-    struct Node {
-        Node() = delete;
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "Over-aligned types are not supported");
 
-        explicit Node(char value_info) : value_(value_info) {
-            left_ = std::weak_ptr<Node>();
-            down_ = nullptr;
-            right_ = nullptr;
-        }
-
-        explicit Node(const T& value) : value_(value) {
-            left_ = std::weak_ptr<Node>();
-            down_ = nullptr;
-            right_ = nullptr;
-        }
+    SkipList() : SkipList(kDefaultProbability, kDefaultMaxLevel) {
+    }
 
-        explicit Node(const Optional& value_info) : value_(value_info) {
-            left_ = std::weak_ptr<Node>();
-            down_ = nullptr;
-            right_ = nullptr;
+    /**
+     * Makes an empty skip list with the given shape.
+     * Lower probability and lower height cap save memory at the cost of longer searches.
+     * @param probability Probability of promoting a tower to the next level, in (0, 1)
+     * @param max_level Tower height cap, see 'MaxLevelFor()'
+     */
+    SkipList(double probability, uint32_t max_level) {
+        if (!(probability > 0.0 && probability < 1.0)) {
+            throw std::invalid_argument("Promotion probability must be in (0, 1)");
         }
-
-        Node(const Node& other) : value_(other.value_) {
-            left_ = other.left_;
-            down_ = other.down_;
-            right_ = other.right_;
+        if (max_level < 1 || max_level > kMaxLevel) {
+            throw std::invalid_argument("Tower height cap must be in [1, kMaxLevel]");
         }
-
-        ~Node() {
-            left_ = right_ = down_ = nullptr;
-        }
-
-        std::shared_ptr<Node> down_;
-        std::weak_ptr<Node> left_;
-        std::shared_ptr<Node> right_;
-        Optional value_;
-    };
-
-    SkipList() {
-        head_bot = std::make_shared<Node>('b');
-        end_bot = std::make_shared<Node>('e');
-        head_bot->right_ = end_bot;
-        end_bot->left_ = head_bot;
-        head_top = head_bot;
-        end_top = end_bot;
-        size_ = 0;
+        threshold_ = static_cast<uint32_t>(std::ldexp(probability, 32) - 1.0);
+        max_level_ = max_level;
+        Init();
     }
 
     template <class InitIterator>
@@ -140,31 +135,23 @@ public:
     }
 
     SkipList(const SkipList& other) : SkipList() {
+        CopyShape(other);
         for (const T& value : other) {
             Insert(value);
         }
     }
-    SkipList(SkipList&& other) noexcept {
-        std::swap(head_top, other.head_top);
-        std::swap(end_top, other.end_top);
-        std::swap(head_bot, other.head_bot);
-        std::swap(end_bot, other.end_bot);
-        std::swap(size_, other.size_);
+    SkipList(SkipList&& other) noexcept : SkipList() {
+        Swap(other);
     }
     SkipList(std::shared_ptr<ITree<T>> other) : SkipList(*dynamic_cast<SkipList<T>*>(other.get())) {
     }
 
     SkipList& operator=(const SkipList& other) {
-        if (head_top == other.head_top) {
+        if (head_ == other.head_) {
             return *this;
         }
-        head_bot = std::make_shared<Node>('b');
-        end_bot = std::make_shared<Node>('e');
-        head_bot->right_ = end_bot;
-        end_bot->left_ = head_bot;
-        head_top = head_bot;
-        end_top = end_bot;
-        size_ = 0;
+        Clear();
+        CopyShape(other);
         for (const T& value : other) {
             Insert(value);
         }
@@ -172,19 +159,17 @@ public:
     }
 
     SkipList& operator=(SkipList&& other) noexcept {
-        if (head_top == other.head_top) {
+        if (head_ == other.head_) {
             return *this;
         }
-        std::swap(head_top, other.head_top);
-        std::swap(end_top, other.end_top);
-        std::swap(head_bot, other.head_bot);
-        std::swap(end_bot, other.end_bot);
-        std::swap(size_, other.size_);
+        Swap(other);
         return *this;
     }
 
     ~SkipList() override {
-        head_top = head_bot = end_top = end_bot = nullptr;
+        Release(head_);
+        Release(end_);
+        head_ = end_ = nullptr;
         size_ = 0;
     }
 
@@ -197,45 +182,106 @@ public:
     }
 
     std::shared_ptr<BaseImpl> Find(const T& value) const override {
-        Optional val(value);
-        return FindImpl(head_top, val);
+        return FindImpl(value);
     }
 
     void Erase(const T& value) override {
-        Optional val(value);
-        if (EraseImpl(head_top, val)) {
+        if (EraseImpl(value)) {
             --size_;
         }
     }
 
     std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
-        Optional val(value);
-        return LowerBoundImpl(head_top, val);
+        return LowerBoundImpl(value);
     }
 
     void Insert(const T& value) override {
-        std::shared_ptr<Node> new_node = std::make_shared<Node>(value);
-        if (InsertImpl(head_top, new_node)) {
+        if (InsertImpl(value)) {
             ++size_;
         }
     }
 
     void Clear() override {
-        head_bot = std::make_shared<Node>('b');
-        end_bot = std::make_shared<Node>('e');
-        head_bot->right_ = end_bot;
-        end_bot->left_ = head_bot;
-        head_top = head_bot;
-        end_top = end_bot;
-        size_ = 0;
+        Release(head_);
+        Release(end_);
+        Init();
+    }
+
+    /**
+     * Builds the list in linear time: every tower is appended after the last tower
+     * of each of its levels, no searches are needed
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        Node* tails[kMaxLevel];
+        std::fill(tails, tails + max_level_, head_);
+        for (const T& value : values) {
+            uint32_t height = BuildLvl();
+            level_ = std::max(level_, height);
+            Node* new_node = CreateNode(height);
+            new (new_node->storage_) T(value);
+            new_node->has_value_ = true;
+            // The new tower takes over the reference to the end from the previous one
+            new_node->prev_ = tails[0];
+            for (uint32_t level = 0; level < height; ++level) {
+                new_node->Next()[level] = tails[level]->Next()[level];
+                tails[level]->Next()[level] = new_node;
+                tails[level] = new_node;
+            }
+            end_->prev_ = new_node;
+        }
+        size_ = values.size();
+    }
+
+    /**
+     * Tower height cap for the expected number of elements:
+     * log base 1/p of the size, so that the top level holds about one tower.
+     * @param probability Probability of promoting a tower to the next level
+     * @param expected_size Expected number of elements
+     * @return Height cap for the constructor
+     */
+    static uint32_t MaxLevelFor(double probability, size_t expected_size) {
+        double levels = std::ceil(std::log(std::max<double>(expected_size, 2.0)) /
+                                  -std::log(probability));
+        return static_cast<uint32_t>(std::min<double>(std::max(levels, 1.0), kMaxLevel));
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        if (EraseImpl(key)) {
+            --size_;
+        }
     }
 
 private:
-    std::shared_ptr<Node> head_top;
-    std::shared_ptr<Node> end_top;
-    std::shared_ptr<Node> head_bot;
-    std::shared_ptr<Node> end_bot;
+    Node* head_;
+    Node* end_;
+    /// Number of levels in use
+    uint32_t level_;
+    /// Tower height cap
+    uint32_t max_level_;
+    /// Tower is promoted while a random 32-bit number does not exceed the threshold
+    uint32_t threshold_;
     size_t size_;
+
     /* ---------------------------------------------------
      * --------------ITERATOR IMPLEMENTATION--------------
      * ---------------------------------------------------
@@ -243,15 +289,21 @@ private:
 
     class SkipListItImpl : public BaseImpl {
     private:
-        std::shared_ptr<Node> it_;
+        Node* it_;
 
     public:
         SkipListItImpl() = delete;
 
-        explicit SkipListItImpl(std::shared_ptr<Node> ptr) : it_(ptr) {
+        explicit SkipListItImpl(Node* ptr) : it_(ptr) {
+            ++it_->links_;
         }
 
         SkipListItImpl(const SkipListItImpl& other) : it_(other.it_) {
+            ++it_->links_;
+        }
+
+        ~SkipListItImpl() override {
+            Release(it_);
         }
 
         std::shared_ptr<BaseImpl> Clone() const override {
@@ -259,31 +311,37 @@ private:
         }
 
         void Increment() override {
-            if (!it_->right_) {
+            Node* next = it_->Next()[0];
+            if (!next) {
                 throw std::runtime_error("Index out of range while increasing");
             }
-            it_ = it_->right_;
+            ++next->links_;
+            Release(it_);
+            it_ = next;
         }
 
         void Decrement() override {
-            it_ = it_->left_.lock();
-            if (!it_->left_.lock()) {
+            Node* prev = it_->prev_;
+            if (!prev || !prev->prev_) {
                 throw std::runtime_error("Index out of range while decreasing");
             }
+            ++prev->links_;
+            Release(it_);
+            it_ = prev;
         }
 
         const T Dereferencing() const override {
-            if (it_->value_.GetInfo() != 'v') {
+            if (!it_->has_value_) {
                 throw std::runtime_error("Index out of range on operator*");
             }
-            return *(it_->value_.GetValue());
+            return it_->Value();
         }
 
         const T* Arrow() const override {
-            if (it_->value_.GetInfo() != 'v') {
+            if (!it_->has_value_) {
                 throw std::runtime_error("Index out of range on operator->");
             }
-            return &(*it_->value_.GetValue());
+            return &it_->Value();
         }
 
         bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
@@ -296,141 +354,168 @@ private:
     };
 
     std::shared_ptr<BaseImpl> Begin() const override {
-        return std::make_shared<SkipListItImpl>(head_bot->right_);
+        return std::make_shared<SkipListItImpl>(head_->Next()[0]);
     }
 
     std::shared_ptr<BaseImpl> End() const override {
-        return std::make_shared<SkipListItImpl>(end_bot);
+        return std::make_shared<SkipListItImpl>(end_);
     }
 
-    std::shared_ptr<BaseImpl> FindImpl(std::shared_ptr<Node> from, const Optional& value) const {
-        while (true) {
-            if (!from->right_) {
-                return End();
-            }
-            if (from->right_->value_ < value) {
-                from = from->right_;
-            } else if (!from->down_) {
-                if (value < from->right_->value_) {
-                    return End();
-                }
-                return std::make_shared<SkipListItImpl>(from->right_);
-            } else {
-                from = from->down_;
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    /**
+     * Allocates a tower with uninitialized value and empty forward pointers
+     * @param height Number of levels in the tower
+     * @return Pointer to the new tower owned by the caller
+     */
+    static Node* CreateNode(uint32_t height) {
+        void* memory = ::operator new(sizeof(Node) + height * sizeof(Node*));
+        return new (memory) Node(height);
+    }
+
+    /**
+     * Drops one reference to the tower.
+     * Towers without owners are destroyed along with the rest of the chain they own.
+     * It works iteratively, so long lists don't overflow the stack.
+     * @param node Tower to release
+     */
+    static void Release(Node* node) {
+        while (node && --node->links_ == 0) {
+            Node* next = node->Next()[0];
+            if (node->has_value_) {
+                node->Value().~T();
             }
+            node->~Node();
+            ::operator delete(node);
+            node = next;
         }
     }
 
-    bool EraseImpl(std::shared_ptr<Node>& from, const Optional& value) {
-        if (!from->right_) {
-            return false;
-        }
-        if (from->right_->value_ < value) {
-            return EraseImpl(from->right_, value);
-        }
-        if (value < from->right_->value_) {
-            if (!from->down_) {
-                return false;
-            } else {
-                return EraseImpl(from->down_, value);
-            }
+    void Init() {
+        head_ = CreateNode(max_level_);
+        end_ = CreateNode(1);
+        for (uint32_t level = 0; level < max_level_; ++level) {
+            head_->Next()[level] = end_;
         }
-        auto cur_node = from->right_;
-        auto next_node = cur_node->right_;
-        next_node->left_ = from;
-        from->right_ = next_node;
-        if (from == head_top && from->right_ == end_top) {
-            if (head_top->down_) {
-                head_top = head_top->down_;
-                end_top = end_top->down_;
+        // One reference from the head and one from the tree itself
+        ++end_->links_;
+        end_->prev_ = head_;
+        level_ = 1;
+        size_ = 0;
+    }
+
+    /**
+     * Makes this empty list shaped as the other one
+     * @param other List to take promotion probability and height cap from
+     */
+    void CopyShape(const SkipList& other) {
+        Release(head_);
+        Release(end_);
+        threshold_ = other.threshold_;
+        max_level_ = other.max_level_;
+        Init();
+    }
+
+    void Swap(SkipList& other) {
+        std::swap(head_, other.head_);
+        std::swap(end_, other.end_);
+        std::swap(level_, other.level_);
+        std::swap(max_level_, other.max_level_);
+        std::swap(threshold_, other.threshold_);
+        std::swap(size_, other.size_);
+    }
+
+    /**
+     * Finds the rightmost tower less than key on every level
+     * @param key Lookup key
+     * @param update Array of size 'kMaxLevel' to store towers for every level or nullptr
+     * @return Rightmost tower less than key on the bottom level
+     */
+    template <class K>
+    Node* FindPredecessor(const K& key, Node** update) const {
+        Node* from = head_;
+        for (uint32_t level = level_; level-- > 0;) {
+            Node* next = from->Next()[level];
+            while (next->LessThanKey(key)) {
+                from = next;
+                next = from->Next()[level];
             }
-        }
-        while (cur_node->down_) {
-            cur_node = cur_node->down_;
-            auto prev_from = cur_node->left_.lock();
-            next_node = cur_node->right_;
-            prev_from->right_ = next_node;
-            next_node->left_ = prev_from;
-            if (prev_from == head_top && prev_from->right_ == end_top) {
-                if (head_top->down_) {
-                    head_top = head_top->down_;
-                    end_top = end_top->down_;
-                }
+            if (update) {
+                update[level] = from;
             }
         }
-        return true;
+        return from;
     }
 
-    static std::shared_ptr<BaseImpl> LowerBoundImpl(std::shared_ptr<Node> from,
-                                                    const Optional& value) {
-        while (true) {
-            if (from->right_->value_ < value) {
-                from = from->right_;
-            } else if (!from->down_) {
-                return std::make_shared<SkipListItImpl>(from->right_);
-            } else {
-                from = from->down_;
-            }
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        Node* next = FindPredecessor(key, nullptr)->Next()[0];
+        if (next->GreaterThanKey(key)) {
+            return End();
         }
+        return std::make_shared<SkipListItImpl>(next);
     }
 
-    bool InsertImpl(std::shared_ptr<Node> from, std::shared_ptr<Node> new_node) {
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        return std::make_shared<SkipListItImpl>(FindPredecessor(key, nullptr)->Next()[0]);
+    }
 
-        std::vector<std::shared_ptr<Node>> node_path;
-        while (true) {
-            if (!from->right_) {
-                return false;
-            } else if (from->right_->value_ < new_node->value_) {
-                from = from->right_;
-            } else {
-                if (from->down_) {
-                    node_path.push_back(from);
-                    from = from->down_;
-                } else {
-                    if (new_node->value_ < from->right_->value_) {
-                        new_node->left_ = from;
-                        new_node->right_ = from->right_;
-                        from->right_->left_ = new_node;
-                        from->right_ = new_node;
-                        BuildLvl(node_path, new_node);
-                        return true;
-                    }
-                    return false;
-                }
-            }
+    template <class K>
+    bool EraseImpl(const K& key) {
+        Node* update[kMaxLevel];
+        Node* target = FindPredecessor(key, update)->Next()[0];
+        if (target->GreaterThanKey(key)) {
+            return false;
         }
+        for (uint32_t level = 0; level < target->height_; ++level) {
+            update[level]->Next()[level] = target->Next()[level];
+        }
+        // Erased tower keeps owning its successor, the predecessor gets one more reference
+        Node* next = target->Next()[0];
+        ++next->links_;
+        next->prev_ = update[0];
+        Release(target);
+        while (level_ > 1 && head_->Next()[level_ - 1] == end_) {
+            --level_;
+        }
+        return true;
     }
 
-    void BuildLvl(std::vector<std::shared_ptr<Node>> node_path, std::shared_ptr<Node> from) {
-        while (!Random::Next()) {
-            std::shared_ptr<Node> up_node;
-            up_node = std::make_shared<Node>(from->value_);
-            up_node->down_ = from;
-            if (node_path.size() != 0) {
-                auto prev = node_path.back();
-                up_node->left_ = prev;
-                up_node->right_ = prev->right_;
-                prev->right_->left_ = up_node;
-                prev->right_ = up_node;
-                node_path.pop_back();
-            } else {
-                std::shared_ptr<Node> new_head, new_end, tmp_head, tmp_end;
-                tmp_head = head_top;
-                tmp_end = end_top;
-                new_head = std::make_shared<Node>('b');
-                new_end = std::make_shared<Node>('e');
-                new_head->down_ = tmp_head;
-                new_head->right_ = up_node;
-                up_node->left_ = new_head;
-                up_node->right_ = new_end;
-                new_end->down_ = tmp_end;
-                new_end->left_ = up_node;
-                head_top = new_head;
-                end_top = new_end;
-                break;
-            }
-            from = up_node;
+    bool InsertImpl(const T& value) {
+        Node* update[kMaxLevel];
+        Node* prev = FindPredecessor(value, update);
+        if (!prev->Next()[0]->GreaterThanKey(value)) {
+            return false;
+        }
+        uint32_t height = BuildLvl();
+        for (; level_ < height; ++level_) {
+            update[level_] = head_;
+        }
+        Node* new_node = CreateNode(height);
+        new (new_node->storage_) T(value);
+        new_node->has_value_ = true;
+        for (uint32_t level = 0; level < height; ++level) {
+            new_node->Next()[level] = update[level]->Next()[level];
+            update[level]->Next()[level] = new_node;
+        }
+        // The new tower takes over the reference to its successor from the predecessor
+        new_node->prev_ = prev;
+        new_node->Next()[0]->prev_ = new_node;
+        return true;
+    }
+
+    /**
+     * @return Random height of a new tower
+     */
+    uint32_t BuildLvl() const {
+        uint32_t height = 1;
+        while (height < max_level_ && FastRandom::Next32() <= threshold_) {
+            ++height;
         }
-        return;
+        return height;
     }
 };
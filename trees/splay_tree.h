@@ -1,521 +1,953 @@
-#pragma once
-#include <exception>
-#include <initializer_list>
-#include <iostream>
-#include <memory>
-#include <optional>
-#include <queue>
-
-template <class T>
-class ITree;
-
-template <class T>
-class SplayTree : public ITree<T> {
-private:
-    typedef typename ITree<T>::ITreeItImpl BaseImpl;
-
-public:
-    struct Node {
-        Node() {
-            parent_ = left_ = right_ = nullptr;
-            value_ = std::nullopt;
-        }
-
-        explicit Node(const T& value) : value_(value) {
-            parent_ = left_ = right_ = nullptr;
-        }
-
-        Node(const Node& other) : value_(other.value_) {
-            left_ = other.left_;
-            parent_ = other.parent_;
-            right_ = other.right_;
-        }
-
-        ~Node() {
-            left_ = nullptr;
-            right_ = nullptr;
-        }
-
-        std::shared_ptr<Node> left_;
-        std::shared_ptr<Node> right_;
-        std::weak_ptr<Node> parent_;
-        std::optional<T> value_;
-    };
-
-    SplayTree() {
-        begin_ = end_ = root_ = std::make_shared<Node>();
-        size_ = 0;
-    }
-
-    template <class InitIterator>
-    SplayTree(InitIterator begin, InitIterator end) : SplayTree() {
-        for (InitIterator cur(begin); cur != end; ++cur) {
-            Insert(*cur);
-        }
-    }
-
-    SplayTree(std::initializer_list<T> list) : SplayTree() {
-        for (const T& value : list) {
-            Insert(value);
-        }
-    }
-
-    SplayTree(const SplayTree& other) : SplayTree() {
-        for (const T& value : other) {
-            Insert(value);
-        }
-    }
-
-    SplayTree(SplayTree&& other) noexcept : SplayTree() {
-        std::swap(root_, other.root_);
-        std::swap(begin_, other.begin_);
-        std::swap(end_, other.end_);
-        std::swap(size_, other.size_);
-    }
-
-    SplayTree(std::shared_ptr<ITree<T>> other)
-        : SplayTree(*dynamic_cast<SplayTree<T>*>(other.get())) {
-    }
-
-    SplayTree& operator=(const SplayTree& other) {
-        if (root_ == other.root_) {
-            return *this;
-        }
-        begin_ = end_ = root_ = std::make_shared<Node>();
-        size_ = 0;
-        for (const T& value : other) {
-            Insert(value);
-        }
-        return *this;
-    }
-
-    SplayTree& operator=(SplayTree&& other) noexcept {
-        if (root_ == other.root_) {
-            return *this;
-        }
-        std::swap(root_, other.root_);
-        std::swap(begin_, other.begin_);
-        std::swap(end_, other.end_);
-        std::swap(size_, other.size_);
-        return *this;
-    }
-
-    ~SplayTree() override {
-        size_ = 0;
-        std::queue<std::shared_ptr<Node>> nodes;
-        nodes.emplace(root_);
-        begin_ = end_ = root_ = nullptr;
-        while (!nodes.empty()) {
-            std::shared_ptr<Node> cur = nodes.front();
-            nodes.pop();
-            if (cur->left_) {
-                nodes.emplace(cur->left_);
-            }
-            if (cur->right_) {
-                nodes.emplace(cur->right_);
-            }
-            cur->left_ = nullptr;
-            cur->right_ = nullptr;
-        }
-    }
-
-    [[nodiscard]] size_t Size() const override {
-        return size_;
-    }
-
-    [[nodiscard]] bool Empty() const override {
-        return !size_;
-    }
-
-    std::shared_ptr<BaseImpl> Find(const T& value) const override {
-        std::optional<T> val(value);
-        std::shared_ptr<Node> cur_node = root_;
-        while (cur_node) {
-            if (val < cur_node->value_) {
-                if (cur_node->left_) {
-                    cur_node = cur_node->left_;
-                } else {
-                    const_cast<SplayTree<T>*>(this)->Splay(cur_node);
-                    return End();
-                }
-            } else if (cur_node->value_ < val) {
-                if (cur_node->right_) {
-                    cur_node = cur_node->right_;
-                } else {
-                    const_cast<SplayTree<T>*>(this)->Splay(cur_node);
-                    return End();
-                }
-            } else {
-                const_cast<SplayTree<T>*>(this)->Splay(cur_node);
-                return std::make_shared<SplayTreeItImpl>(root_);
-            }
-        }
-        return End();
-    }
-
-    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
-        std::optional<T> val(value);
-        std::shared_ptr<Node> cur = root_;
-        while (true) {
-            if (val < cur->value_) {
-                if (cur->left_) {
-                    cur = cur->left_;
-                } else {
-                    const_cast<SplayTree<T>*>(this)->Splay(cur);
-                    return std::make_shared<SplayTreeItImpl>(root_);
-                }
-            } else if (cur->value_ < val) {
-                if (cur->right_) {
-                    cur = cur->right_;
-                } else {
-                    auto it = std::make_shared<SplayTreeItImpl>(cur);
-                    it->Increment();
-                    const_cast<SplayTree<T>*>(this)->Splay(it->GetPointer());
-                    return it;
-                }
-            } else {
-                const_cast<SplayTree<T>*>(this)->Splay(cur);
-                return std::make_shared<SplayTreeItImpl>(root_);
-            }
-        }
-    }
-
-    void Insert(const T& value) override {
-        std::shared_ptr<Node> new_node = std::make_shared<Node>(value);
-        std::shared_ptr<Node> cur = root_;
-        while (true) {
-            if (new_node->value_ < cur->value_) {
-                if (cur->left_) {
-                    cur = cur->left_;
-                } else {
-                    new_node->parent_ = cur;
-                    cur->left_ = new_node;
-                    if (begin_ == cur) {
-                        begin_ = new_node;
-                    }
-                    cur = cur->left_;
-                    break;
-                }
-            } else if (cur->value_ < new_node->value_) {
-                if (cur->right_) {
-                    cur = cur->right_;
-                } else {
-                    new_node->parent_ = cur;
-                    cur->right_ = new_node;
-                    cur = cur->right_;
-                    break;
-                }
-            } else {
-                Splay(cur);
-                return;
-            }
-        }
-        Splay(cur);
-        ++size_;
-    }
-
-    void Erase(const T& value) override {
-        std::optional<T> val(value);
-        auto cur_node = root_;
-        while (true) {
-            if (val < cur_node->value_) {
-                if (cur_node->left_) {
-                    cur_node = cur_node->left_;
-                } else {
-                    Splay(cur_node);
-                    return;
-                }
-            } else if (cur_node->value_ < val) {
-                if (cur_node->right_) {
-                    cur_node = cur_node->right_;
-                } else {
-                    Splay(cur_node);
-                    return;
-                }
-            } else {
-                break;
-            }
-        }
-        Splay(cur_node);
-        if (root_ == begin_) {
-            auto it = std::dynamic_pointer_cast<SplayTreeItImpl>(Begin());
-            it->Increment();
-            begin_ = it->GetPointer();
-        }
-        --size_;
-        std::shared_ptr<Node> left_sub = root_->left_, right_sub = root_->right_;
-        root_ = right_sub;
-        cur_node = root_;
-        while (left_sub) {
-            right_sub = right_sub->left_;
-            cur_node->left_ = left_sub;
-            left_sub->parent_ = cur_node;
-            cur_node = cur_node->left_;
-            if (right_sub) {
-                left_sub = left_sub->right_;
-                cur_node->right_ = right_sub;
-                right_sub->parent_ = cur_node;
-                cur_node = cur_node->right_;
-            } else {
-                break;
-            }
-        }
-    }
-
-    void Clear() override {
-        size_ = 0;
-        std::queue<std::shared_ptr<Node>> nodes;
-        nodes.emplace(root_);
-        begin_ = end_ = root_ = nullptr;
-        while (!nodes.empty()) {
-            std::shared_ptr<Node> cur = nodes.front();
-            nodes.pop();
-            if (cur->left_) {
-                nodes.emplace(cur->left_);
-            }
-            if (cur->right_) {
-                nodes.emplace(cur->right_);
-            }
-            cur->left_ = nullptr;
-            cur->right_ = nullptr;
-        }
-        begin_ = end_ = root_ = std::make_shared<Node>();
-    }
-
-private:
-    std::shared_ptr<Node> begin_;
-    std::shared_ptr<Node> end_;
-    std::shared_ptr<Node> root_;
-    size_t size_;
-
-    /* ---------------------------------------------------
-     * --------------ITERATOR IMPLEMENTATION--------------
-     * ---------------------------------------------------
-     */
-
-    class SplayTreeItImpl : public BaseImpl {
-    private:
-        std::shared_ptr<Node> it_;
-
-    public:
-        SplayTreeItImpl() = delete;
-
-        explicit SplayTreeItImpl(std::shared_ptr<Node> other) : it_(other) {
-        }
-
-        SplayTreeItImpl(const SplayTreeItImpl& other) : it_(other.it_) {
-        }
-
-        std::shared_ptr<Node> GetPointer() {
-            return it_;
-        }
-
-        std::shared_ptr<BaseImpl> Clone() const override {
-            return std::make_shared<SplayTreeItImpl>(*this);
-        }
-
-        void Increment() override {
-            if (!it_->value_) {
-                throw std::runtime_error("Index out of range while increasing");
-            }
-            if (it_->right_) {
-                it_ = it_->right_;
-                while (it_->left_) {
-                    it_ = it_->left_;
-                }
-            } else {
-                while (it_->parent_.lock()->right_ == it_) {
-                    it_ = it_->parent_.lock();
-                }
-                it_ = it_->parent_.lock();
-            }
-        }
-
-        void Decrement() override {
-            if (it_->left_) {
-                it_ = it_->left_;
-                while (it_->right_) {
-                    it_ = it_->right_;
-                }
-            } else {
-                auto parent = it_->parent_.lock();
-                while (parent && parent->left_ == it_) {
-                    it_ = parent;
-                    parent = it_->parent_.lock();
-                }
-                if (parent) {
-                    it_ = parent;
-                } else {
-                    throw std::runtime_error("Index out of range while decreasing");
-                }
-            }
-        }
-
-        const T Dereferencing() const override {
-            if (!it_->value_) {
-                throw std::runtime_error("Index out of range on operator*");
-            }
-            return *(it_->value_);
-        }
-
-        const T* Arrow() const override {
-            if (!it_->value_) {
-                throw std::runtime_error("Index out of range on operator->");
-            }
-            return &(*it_->value_);
-        }
-
-        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
-            auto casted = std::dynamic_pointer_cast<SplayTreeItImpl>(other);
-            if (!casted) {
-                return false;
-            }
-            return it_ == casted->it_;
-        }
-    };
-
-    std::shared_ptr<BaseImpl> Begin() const override {
-        return std::make_shared<SplayTreeItImpl>(begin_);
-    }
-
-    std::shared_ptr<BaseImpl> End() const override {
-        return std::make_shared<SplayTreeItImpl>(end_);
-    }
-
-    void Splay(std::shared_ptr<Node> from) {
-        std::shared_ptr<Node> parent = from->parent_.lock();
-        while (parent) {
-            std::shared_ptr<Node> grandparent = parent->parent_.lock();
-            if (!grandparent) {
-                if (parent->right_ == from) {
-                    Zag(from, parent);
-                } else {
-                    Zig(from, parent);
-                }
-                break;
-            }
-            if (grandparent->right_ == parent) {
-                if (parent->right_ == from) {
-                    ZagZag(from, parent, grandparent);
-                } else {
-                    ZagZig(from, parent, grandparent);
-                }
-            } else {
-                if (parent->right_ == from) {
-                    ZigZag(from, parent, grandparent);
-                } else {
-                    ZigZig(from, parent, grandparent);
-                }
-            }
-            parent = from->parent_.lock();
-        }
-        root_ = from;
-    }
-
-    static void Zig(std::shared_ptr<Node> x, std::shared_ptr<Node> y) {
-        std::shared_ptr<Node> hanger = y->parent_.lock();
-        bool left_child = hanger && hanger->left_ == y;
-        y->left_ = x->right_;
-        if (y->left_) {
-            y->left_->parent_ = y;
-        }
-        x->right_ = y;
-        y->parent_ = x;
-        SetHanger(x, hanger, left_child);
-    }
-
-    static void Zag(std::shared_ptr<Node> x, std::shared_ptr<Node> y) {
-        std::shared_ptr<Node> hanger = y->parent_.lock();
-        bool left_child = hanger && hanger->left_ == y;
-        y->right_ = x->left_;
-        if (y->right_) {
-            y->right_->parent_ = y;
-        }
-        x->left_ = y;
-        y->parent_ = x;
-        SetHanger(x, hanger, left_child);
-    }
-
-    static void ZigZig(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
-        std::shared_ptr<Node> hanger = z->parent_.lock();
-        bool left_child = hanger && hanger->left_ == z;
-        z->left_ = y->right_;
-        if (z->left_) {
-            z->left_->parent_ = z;
-        }
-        z->parent_ = y;
-        y->right_ = z;
-        y->left_ = x->right_;
-        if (y->left_) {
-            y->left_->parent_ = y;
-        }
-        y->parent_ = x;
-        x->right_ = y;
-        SetHanger(x, hanger, left_child);
-    }
-
-    static void ZagZag(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
-        std::shared_ptr<Node> hanger = z->parent_.lock();
-        bool left_child = hanger && hanger->left_ == z;
-        z->right_ = y->left_;
-        if (z->right_) {
-            z->right_->parent_ = z;
-        }
-        z->parent_ = y;
-        y->left_ = z;
-        y->right_ = x->left_;
-        if (y->right_) {
-            y->right_->parent_ = y;
-        }
-        y->parent_ = x;
-        x->left_ = y;
-        SetHanger(x, hanger, left_child);
-    }
-
-    static void ZigZag(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
-        std::shared_ptr<Node> hanger = z->parent_.lock();
-        bool left_child = hanger && hanger->left_ == z;
-        z->left_ = x->right_;
-        if (z->left_) {
-            z->left_->parent_ = z;
-        }
-        z->parent_ = x;
-        x->right_ = z;
-        y->right_ = x->left_;
-        if (y->right_) {
-            y->right_->parent_ = y;
-        }
-        y->parent_ = x;
-        x->left_ = y;
-        SetHanger(x, hanger, left_child);
-    }
-
-    static void ZagZig(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
-        std::shared_ptr<Node> hanger = z->parent_.lock();
-        bool left_child = hanger && hanger->left_ == z;
-        z->right_ = x->left_;
-        if (z->right_) {
-            z->right_->parent_ = z;
-        }
-        z->parent_ = x;
-        x->left_ = z;
-        y->left_ = x->right_;
-        if (y->left_) {
-            y->left_->parent_ = y;
-        }
-        y->parent_ = x;
-        x->right_ = y;
-        SetHanger(x, hanger, left_child);
-    }
-
-    static void SetHanger(std::shared_ptr<Node> x, std::shared_ptr<Node> hanger, bool left_child) {
-        x->parent_ = hanger;
-        if (hanger) {
-            if (left_child) {
-                hanger->left_ = x;
-            } else {
-                hanger->right_ = x;
-            }
-        }
-    }
+#pragma once
+#include <cmath>
+#include <exception>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+#include "fast_random.h"
+
+template <class T>
+class ITree;
+
+template <class T>
+class SplayTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    /// How the tree brings an accessed node to the root
+    enum class SplayMode {
+        /// Descend to the node, then rotate it up along parent links
+        kBottomUp,
+        /// Rotate while descending, in a single pass from the root
+        kTopDown
+    };
+
+    /// When lookups (find, lower_bound) restructure the tree
+    enum class ReadSplayPolicy {
+        /// Splay on every lookup
+        kAlways,
+        /// Splay on every k-th lookup
+        kEveryKth,
+        /// Splay with the given probability
+        kRandom,
+        /// Splay only if the node found lies deeper than the given depth
+        kDeep,
+        /// Never restructure on lookups, so concurrent lookups are safe
+        kNever
+    };
+
+    struct Node;
+
+    /**
+     * Links of a node. The header of the tree is a bare NodeBase without a value:
+     * its left child is the root and it is the only node without a parent
+     */
+    struct NodeBase {
+        std::shared_ptr<Node> left_;
+        std::shared_ptr<Node> right_;
+        std::weak_ptr<NodeBase> parent_;
+    };
+
+    struct Node : NodeBase {
+        explicit Node(const T& value) : value_(value) {
+        }
+
+        T value_;
+    };
+
+    SplayTree() {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        size_ = 0;
+    }
+
+    template <class InitIterator>
+    SplayTree(InitIterator begin, InitIterator end) : SplayTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+
+    SplayTree(std::initializer_list<T> list) : SplayTree() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    SplayTree(const SplayTree& other) : SplayTree() {
+        splay_mode_ = other.splay_mode_;
+        read_policy_ = other.read_policy_;
+        read_parameter_ = other.read_parameter_;
+        for (const T& value : other) {
+            Insert(value);
+        }
+    }
+
+    SplayTree(SplayTree&& other) noexcept : SplayTree() {
+        std::swap(begin_, other.begin_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        std::swap(splay_mode_, other.splay_mode_);
+        std::swap(read_policy_, other.read_policy_);
+        std::swap(read_parameter_, other.read_parameter_);
+        std::swap(read_count_, other.read_count_);
+    }
+
+    SplayTree(std::shared_ptr<ITree<T>> other)
+        : SplayTree(*dynamic_cast<SplayTree<T>*>(other.get())) {
+    }
+
+    SplayTree& operator=(const SplayTree& other) {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Clear();
+        splay_mode_ = other.splay_mode_;
+        read_policy_ = other.read_policy_;
+        read_parameter_ = other.read_parameter_;
+        for (const T& value : other) {
+            Insert(value);
+        }
+        return *this;
+    }
+
+    SplayTree& operator=(SplayTree&& other) noexcept {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        std::swap(begin_, other.begin_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        std::swap(splay_mode_, other.splay_mode_);
+        std::swap(read_policy_, other.read_policy_);
+        std::swap(read_parameter_, other.read_parameter_);
+        std::swap(read_count_, other.read_count_);
+        return *this;
+    }
+
+    ~SplayTree() override {
+        size_ = 0;
+        std::queue<std::shared_ptr<Node>> nodes;
+        if (Root()) {
+            nodes.emplace(Root());
+        }
+        begin_ = nullptr;
+        end_ = nullptr;
+        while (!nodes.empty()) {
+            std::shared_ptr<Node> cur = nodes.front();
+            nodes.pop();
+            if (cur->left_) {
+                nodes.emplace(cur->left_);
+            }
+            if (cur->right_) {
+                nodes.emplace(cur->right_);
+            }
+            cur->left_ = nullptr;
+            cur->right_ = nullptr;
+        }
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+
+    [[nodiscard]] bool Empty() const override {
+        return !size_;
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        std::shared_ptr<Node> new_node = std::make_shared<Node>(value);
+        if (!Root()) {
+            new_node->parent_ = end_;
+            Root() = begin_ = new_node;
+            ++size_;
+            return;
+        }
+        if (splay_mode_ == SplayMode::kTopDown) {
+            InsertTopDown(new_node);
+            return;
+        }
+        std::shared_ptr<Node> cur = Root();
+        while (true) {
+            if (new_node->value_ < cur->value_) {
+                if (cur->left_) {
+                    cur = cur->left_;
+                } else {
+                    new_node->parent_ = cur;
+                    cur->left_ = new_node;
+                    if (begin_ == cur) {
+                        begin_ = new_node;
+                    }
+                    cur = cur->left_;
+                    break;
+                }
+            } else if (cur->value_ < new_node->value_) {
+                if (cur->right_) {
+                    cur = cur->right_;
+                } else {
+                    new_node->parent_ = cur;
+                    cur->right_ = new_node;
+                    cur = cur->right_;
+                    break;
+                }
+            } else {
+                Splay(cur);
+                return;
+            }
+        }
+        Splay(cur);
+        ++size_;
+    }
+
+    void Erase(const T& value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        size_ = 0;
+        std::queue<std::shared_ptr<Node>> nodes;
+        if (Root()) {
+            nodes.emplace(Root());
+        }
+        begin_ = nullptr;
+        end_ = nullptr;
+        while (!nodes.empty()) {
+            std::shared_ptr<Node> cur = nodes.front();
+            nodes.pop();
+            if (cur->left_) {
+                nodes.emplace(cur->left_);
+            }
+            if (cur->right_) {
+                nodes.emplace(cur->right_);
+            }
+            cur->left_ = nullptr;
+            cur->right_ = nullptr;
+        }
+        end_ = std::make_shared<NodeBase>();
+    }
+
+    /**
+     * Builds a tree with minimal height in linear time
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        size_ = values.size();
+        Root() = BuildBalanced(values, 0, size_, end_);
+        if (Root()) {
+            for (begin_ = Root(); begin_->left_; begin_ = begin_->left_) {
+            }
+        }
+    }
+
+    /**
+     * Switches the splaying strategy, the tree itself is left as is
+     * @param mode New splaying strategy
+     */
+    void SetSplayMode(SplayMode mode) {
+        splay_mode_ = mode;
+    }
+
+    /**
+     * @return Current splaying strategy
+     */
+    [[nodiscard]] SplayMode GetSplayMode() const {
+        return splay_mode_;
+    }
+
+    /**
+     * Sets when lookups restructure the tree, insert and erase always splay.
+     * Only 'kNever' makes lookups read-only, others still need lookups to be serialized
+     * @param policy New read policy
+     * @param parameter Period for 'kEveryKth', probability in (0, 1] for 'kRandom',
+     * depth for 'kDeep', ignored otherwise
+     */
+    void SetReadSplayPolicy(ReadSplayPolicy policy, double parameter = 0) {
+        if (policy == ReadSplayPolicy::kEveryKth && !(parameter >= 1)) {
+            throw std::invalid_argument("Splay period must be at least 1");
+        }
+        if (policy == ReadSplayPolicy::kRandom && !(parameter > 0 && parameter <= 1)) {
+            throw std::invalid_argument("Splay probability must be in (0, 1]");
+        }
+        if (policy == ReadSplayPolicy::kDeep && !(parameter >= 0)) {
+            throw std::invalid_argument("Splay depth must be non-negative");
+        }
+        read_policy_ = policy;
+        if (policy == ReadSplayPolicy::kRandom) {
+            read_parameter_ = static_cast<uint64_t>(std::ldexp(parameter, 32) - 1);
+        } else {
+            read_parameter_ = static_cast<uint64_t>(parameter);
+        }
+        read_count_ = 0;
+    }
+
+    /**
+     * @return Current read policy
+     */
+    [[nodiscard]] ReadSplayPolicy GetReadSplayPolicy() const {
+        return read_policy_;
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        EraseImpl(key);
+    }
+
+private:
+    /// Leftmost node, nullptr if the tree is empty
+    std::shared_ptr<Node> begin_;
+    /// Header of the tree: its left child is the root, so every node has a parent
+    std::shared_ptr<NodeBase> end_;
+    size_t size_;
+    SplayMode splay_mode_ = SplayMode::kBottomUp;
+    ReadSplayPolicy read_policy_ = ReadSplayPolicy::kAlways;
+    /// Period, random threshold or depth, depending on the read policy
+    uint64_t read_parameter_ = 0;
+    /// Lookups since the last splay for 'kEveryKth' policy
+    mutable uint64_t read_count_ = 0;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class SplayTreeItImpl : public BaseImpl {
+    private:
+        std::shared_ptr<NodeBase> it_;
+
+    public:
+        SplayTreeItImpl() = delete;
+
+        explicit SplayTreeItImpl(std::shared_ptr<NodeBase> other) : it_(other) {
+        }
+
+        SplayTreeItImpl(const SplayTreeItImpl& other) : it_(other.it_) {
+        }
+
+        std::shared_ptr<NodeBase> GetPointer() {
+            return it_;
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<SplayTreeItImpl>(*this);
+        }
+
+        void Increment() override {
+            if (it_->parent_.expired()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (it_->right_) {
+                it_ = it_->right_;
+                while (it_->left_) {
+                    it_ = it_->left_;
+                }
+            } else {
+                while (it_->parent_.lock()->right_ == it_) {
+                    it_ = it_->parent_.lock();
+                }
+                it_ = it_->parent_.lock();
+            }
+        }
+
+        void Decrement() override {
+            if (it_->left_) {
+                it_ = it_->left_;
+                while (it_->right_) {
+                    it_ = it_->right_;
+                }
+            } else {
+                auto parent = it_->parent_.lock();
+                while (parent && parent->left_ == it_) {
+                    it_ = parent;
+                    parent = it_->parent_.lock();
+                }
+                if (parent) {
+                    it_ = parent;
+                } else {
+                    throw std::runtime_error("Index out of range while decreasing");
+                }
+            }
+        }
+
+        const T Dereferencing() const override {
+            if (it_->parent_.expired()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return static_cast<Node*>(it_.get())->value_;
+        }
+
+        const T* Arrow() const override {
+            if (it_->parent_.expired()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &static_cast<Node*>(it_.get())->value_;
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<SplayTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        if (!begin_) {
+            return End();
+        }
+        return std::make_shared<SplayTreeItImpl>(begin_);
+    }
+
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<SplayTreeItImpl>(end_);
+    }
+
+    /**
+     * @return Link of the header, which owns the root
+     */
+    std::shared_ptr<Node>& Root() const {
+        return end_->left_;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        if (!Root()) {
+            return End();
+        }
+        if (!SplayOnRead()) {
+            auto node = LowerBoundNode(key);
+            if (!node || key < node->value_) {
+                return End();
+            }
+            return std::make_shared<SplayTreeItImpl>(node);
+        }
+        if (splay_mode_ == SplayMode::kTopDown) {
+            const_cast<SplayTree<T>*>(this)->SplayTopDown(key);
+            if (key < Root()->value_ || Root()->value_ < key) {
+                return End();
+            }
+            return std::make_shared<SplayTreeItImpl>(Root());
+        }
+        std::shared_ptr<Node> cur_node = Root();
+        while (cur_node) {
+            if (key < cur_node->value_) {
+                if (cur_node->left_) {
+                    cur_node = cur_node->left_;
+                } else {
+                    const_cast<SplayTree<T>*>(this)->Splay(cur_node);
+                    return End();
+                }
+            } else if (cur_node->value_ < key) {
+                if (cur_node->right_) {
+                    cur_node = cur_node->right_;
+                } else {
+                    const_cast<SplayTree<T>*>(this)->Splay(cur_node);
+                    return End();
+                }
+            } else {
+                const_cast<SplayTree<T>*>(this)->Splay(cur_node);
+                return std::make_shared<SplayTreeItImpl>(Root());
+            }
+        }
+        return End();
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        if (!Root()) {
+            return End();
+        }
+        if (!SplayOnRead()) {
+            auto node = LowerBoundNode(key);
+            if (!node) {
+                return End();
+            }
+            return std::make_shared<SplayTreeItImpl>(node);
+        }
+        if (splay_mode_ == SplayMode::kTopDown) {
+            auto self = const_cast<SplayTree<T>*>(this);
+            self->SplayTopDown(key);
+            if (Root()->value_ < key) {
+                // Every key of the right subtree is greater, so its minimum is the answer
+                auto next = Root()->right_;
+                if (!next) {
+                    return End();
+                }
+                while (next->left_) {
+                    next = next->left_;
+                }
+                return std::make_shared<SplayTreeItImpl>(next);
+            }
+            return std::make_shared<SplayTreeItImpl>(Root());
+        }
+        std::shared_ptr<Node> cur = Root();
+        while (true) {
+            if (key < cur->value_) {
+                if (cur->left_) {
+                    cur = cur->left_;
+                } else {
+                    const_cast<SplayTree<T>*>(this)->Splay(cur);
+                    return std::make_shared<SplayTreeItImpl>(Root());
+                }
+            } else if (cur->value_ < key) {
+                if (cur->right_) {
+                    cur = cur->right_;
+                } else {
+                    auto it = std::make_shared<SplayTreeItImpl>(cur);
+                    it->Increment();
+                    // Key is greater than the maximum, the last visited node is splayed then
+                    auto next = it->GetPointer() == end_
+                                    ? cur
+                                    : std::static_pointer_cast<Node>(it->GetPointer());
+                    const_cast<SplayTree<T>*>(this)->Splay(next);
+                    return it;
+                }
+            } else {
+                const_cast<SplayTree<T>*>(this)->Splay(cur);
+                return std::make_shared<SplayTreeItImpl>(Root());
+            }
+        }
+    }
+
+    /**
+     * Decides whether the current lookup splays, see 'ReadSplayPolicy'
+     * @return True if the lookup should splay
+     */
+    bool SplayOnRead() const {
+        switch (read_policy_) {
+            case ReadSplayPolicy::kAlways:
+                return true;
+            case ReadSplayPolicy::kEveryKth:
+                if (++read_count_ < read_parameter_) {
+                    return false;
+                }
+                read_count_ = 0;
+                return true;
+            case ReadSplayPolicy::kRandom:
+                return FastRandom::Next32() <= read_parameter_;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Finds the first node not less than the key without restructuring the tree,
+     * except for 'kDeep' policy, which splays the node if it lies too deep
+     * @param key Lookup key
+     * @return Lower bound node, nullptr if there is none
+     */
+    template <class K>
+    std::shared_ptr<Node> LowerBoundNode(const K& key) const {
+        // Links are followed instead of copying pointers, so lookups do not touch reference counts
+        const std::shared_ptr<Node>* link = &Root();
+        const std::shared_ptr<Node>* result = nullptr;
+        uint64_t depth = 0, result_depth = 0;
+        while (*link) {
+            if ((*link)->value_ < key) {
+                link = &(*link)->right_;
+            } else {
+                result = link;
+                result_depth = depth;
+                link = &(*link)->left_;
+            }
+            ++depth;
+        }
+        if (!result) {
+            return nullptr;
+        }
+        std::shared_ptr<Node> node = *result;
+        if (read_policy_ == ReadSplayPolicy::kDeep && result_depth > read_parameter_) {
+            const_cast<SplayTree<T>*>(this)->Splay(node);
+        }
+        return node;
+    }
+
+    template <class K>
+    void EraseImpl(const K& key) {
+        if (!Root()) {
+            return;
+        }
+        if (splay_mode_ == SplayMode::kTopDown) {
+            SplayTopDown(key);
+            if (key < Root()->value_ || Root()->value_ < key) {
+                return;
+            }
+        } else {
+            auto cur_node = Root();
+            while (true) {
+                if (key < cur_node->value_) {
+                    if (cur_node->left_) {
+                        cur_node = cur_node->left_;
+                    } else {
+                        Splay(cur_node);
+                        return;
+                    }
+                } else if (cur_node->value_ < key) {
+                    if (cur_node->right_) {
+                        cur_node = cur_node->right_;
+                    } else {
+                        Splay(cur_node);
+                        return;
+                    }
+                } else {
+                    break;
+                }
+            }
+            Splay(cur_node);
+        }
+        if (Root() == begin_) {
+            auto it = std::dynamic_pointer_cast<SplayTreeItImpl>(Begin());
+            it->Increment();
+            begin_ = it->GetPointer() == end_ ? nullptr
+                                              : std::static_pointer_cast<Node>(it->GetPointer());
+        }
+        --size_;
+        std::shared_ptr<Node> left_sub = Root()->left_, right_sub = Root()->right_;
+        if (!right_sub) {
+            Root() = left_sub;
+            if (left_sub) {
+                left_sub->parent_ = end_;
+            }
+            return;
+        }
+        Root() = right_sub;
+        right_sub->parent_ = end_;
+        auto cur_node = right_sub;
+        while (left_sub) {
+            right_sub = right_sub->left_;
+            cur_node->left_ = left_sub;
+            left_sub->parent_ = cur_node;
+            cur_node = cur_node->left_;
+            if (right_sub) {
+                left_sub = left_sub->right_;
+                cur_node->right_ = right_sub;
+                right_sub->parent_ = cur_node;
+                cur_node = cur_node->right_;
+            } else {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Inserts the node as the new root unless its value is already in the tree
+     * @param new_node Node to insert
+     */
+    void InsertTopDown(std::shared_ptr<Node> new_node) {
+        SplayTopDown(new_node->value_);
+        auto root = Root();
+        if (root->value_ < new_node->value_) {
+            new_node->right_ = root->right_;
+            new_node->left_ = root;
+            root->right_ = nullptr;
+        } else if (new_node->value_ < root->value_) {
+            new_node->left_ = root->left_;
+            new_node->right_ = root;
+            root->left_ = nullptr;
+        } else {
+            return;
+        }
+        if (new_node->left_) {
+            new_node->left_->parent_ = new_node;
+        }
+        if (new_node->right_) {
+            new_node->right_->parent_ = new_node;
+        }
+        new_node->parent_ = end_;
+        Root() = new_node;
+        if (new_node->value_ < begin_->value_) {
+            begin_ = new_node;
+        }
+        ++size_;
+    }
+
+    /**
+     * Top-down splay: brings the node with the given key, or the last node on its search path,
+     * to the root of a non-empty tree in a single pass. Nodes less than the key are collected
+     * into the left tree, greater ones into the right tree, and both are hung under the new root
+     * at the end.
+     * Parent links are only written, never followed.
+     * @param key Key to splay
+     */
+    template <class K>
+    void SplayTopDown(const K& key) {
+        std::shared_ptr<Node> left_tree, right_tree;
+        // Last nodes of the side trees and the links to extend them with
+        std::shared_ptr<Node> left_last, right_last;
+        std::shared_ptr<Node>* left_hook = &left_tree;
+        std::shared_ptr<Node>* right_hook = &right_tree;
+        std::shared_ptr<Node> cur = Root();
+        while (true) {
+            if (key < cur->value_) {
+                if (!cur->left_) {
+                    break;
+                }
+                if (key < cur->left_->value_) {
+                    RotateRight(cur);
+                    if (!cur->left_) {
+                        break;
+                    }
+                }
+                *right_hook = cur;
+                cur->parent_ = right_last;
+                right_last = cur;
+                right_hook = &cur->left_;
+                cur = cur->left_;
+            } else if (cur->value_ < key) {
+                if (!cur->right_) {
+                    break;
+                }
+                if (cur->right_->value_ < key) {
+                    RotateLeft(cur);
+                    if (!cur->right_) {
+                        break;
+                    }
+                }
+                *left_hook = cur;
+                cur->parent_ = left_last;
+                left_last = cur;
+                left_hook = &cur->right_;
+                cur = cur->right_;
+            } else {
+                break;
+            }
+        }
+        *left_hook = cur->left_;
+        if (cur->left_) {
+            cur->left_->parent_ = left_last;
+        }
+        *right_hook = cur->right_;
+        if (cur->right_) {
+            cur->right_->parent_ = right_last;
+        }
+        cur->left_ = left_tree;
+        if (left_tree) {
+            left_tree->parent_ = cur;
+        }
+        cur->right_ = right_tree;
+        if (right_tree) {
+            right_tree->parent_ = cur;
+        }
+        cur->parent_ = end_;
+        Root() = cur;
+    }
+
+    /**
+     * @param values Values in order
+     * @param begin First value of the range
+     * @param end Value after the last one of the range
+     * @param parent Parent for the root of the range
+     * @return Root of a tree made of the range, sibling subtrees differ in size by at most one
+     */
+    static std::shared_ptr<Node> BuildBalanced(const std::vector<T>& values, size_t begin,
+                                               size_t end,
+                                               const std::shared_ptr<NodeBase>& parent) {
+        if (begin == end) {
+            return nullptr;
+        }
+        size_t middle = begin + (end - begin) / 2;
+        auto node = std::make_shared<Node>(values[middle]);
+        node->parent_ = parent;
+        node->left_ = BuildBalanced(values, begin, middle, node);
+        node->right_ = BuildBalanced(values, middle + 1, end, node);
+        return node;
+    }
+
+    /**
+     * Rotates the left child of the node above it, parent of the pair is not updated
+     * @param node Node to rotate, replaced with its former left child
+     */
+    static void RotateRight(std::shared_ptr<Node>& node) {
+        std::shared_ptr<Node> child = node->left_;
+        node->left_ = child->right_;
+        if (node->left_) {
+            node->left_->parent_ = node;
+        }
+        child->right_ = node;
+        node->parent_ = child;
+        node = child;
+    }
+
+    /**
+     * Rotates the right child of the node above it, parent of the pair is not updated
+     * @param node Node to rotate, replaced with its former right child
+     */
+    static void RotateLeft(std::shared_ptr<Node>& node) {
+        std::shared_ptr<Node> child = node->right_;
+        node->right_ = child->left_;
+        if (node->right_) {
+            node->right_->parent_ = node;
+        }
+        child->left_ = node;
+        node->parent_ = child;
+        node = child;
+    }
+
+    void Splay(std::shared_ptr<Node> from) {
+        std::shared_ptr<NodeBase> parent_link = from->parent_.lock();
+        while (parent_link != end_) {
+            auto parent = std::static_pointer_cast<Node>(parent_link);
+            std::shared_ptr<NodeBase> grandparent_link = parent->parent_.lock();
+            if (grandparent_link == end_) {
+                if (parent->right_ == from) {
+                    Zag(from, parent);
+                } else {
+                    Zig(from, parent);
+                }
+                break;
+            }
+            auto grandparent = std::static_pointer_cast<Node>(grandparent_link);
+            if (grandparent->right_ == parent) {
+                if (parent->right_ == from) {
+                    ZagZag(from, parent, grandparent);
+                } else {
+                    ZagZig(from, parent, grandparent);
+                }
+            } else {
+                if (parent->right_ == from) {
+                    ZigZag(from, parent, grandparent);
+                } else {
+                    ZigZig(from, parent, grandparent);
+                }
+            }
+            parent_link = from->parent_.lock();
+        }
+    }
+
+    static void Zig(std::shared_ptr<Node> x, std::shared_ptr<Node> y) {
+        std::shared_ptr<NodeBase> hanger = y->parent_.lock();
+        bool left_child = hanger->left_ == y;
+        y->left_ = x->right_;
+        if (y->left_) {
+            y->left_->parent_ = y;
+        }
+        x->right_ = y;
+        y->parent_ = x;
+        SetHanger(x, hanger, left_child);
+    }
+
+    static void Zag(std::shared_ptr<Node> x, std::shared_ptr<Node> y) {
+        std::shared_ptr<NodeBase> hanger = y->parent_.lock();
+        bool left_child = hanger->left_ == y;
+        y->right_ = x->left_;
+        if (y->right_) {
+            y->right_->parent_ = y;
+        }
+        x->left_ = y;
+        y->parent_ = x;
+        SetHanger(x, hanger, left_child);
+    }
+
+    static void ZigZig(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
+        std::shared_ptr<NodeBase> hanger = z->parent_.lock();
+        bool left_child = hanger->left_ == z;
+        z->left_ = y->right_;
+        if (z->left_) {
+            z->left_->parent_ = z;
+        }
+        z->parent_ = y;
+        y->right_ = z;
+        y->left_ = x->right_;
+        if (y->left_) {
+            y->left_->parent_ = y;
+        }
+        y->parent_ = x;
+        x->right_ = y;
+        SetHanger(x, hanger, left_child);
+    }
+
+    static void ZagZag(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
+        std::shared_ptr<NodeBase> hanger = z->parent_.lock();
+        bool left_child = hanger->left_ == z;
+        z->right_ = y->left_;
+        if (z->right_) {
+            z->right_->parent_ = z;
+        }
+        z->parent_ = y;
+        y->left_ = z;
+        y->right_ = x->left_;
+        if (y->right_) {
+            y->right_->parent_ = y;
+        }
+        y->parent_ = x;
+        x->left_ = y;
+        SetHanger(x, hanger, left_child);
+    }
+
+    static void ZigZag(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
+        std::shared_ptr<NodeBase> hanger = z->parent_.lock();
+        bool left_child = hanger->left_ == z;
+        z->left_ = x->right_;
+        if (z->left_) {
+            z->left_->parent_ = z;
+        }
+        z->parent_ = x;
+        x->right_ = z;
+        y->right_ = x->left_;
+        if (y->right_) {
+            y->right_->parent_ = y;
+        }
+        y->parent_ = x;
+        x->left_ = y;
+        SetHanger(x, hanger, left_child);
+    }
+
+    static void ZagZig(std::shared_ptr<Node> x, std::shared_ptr<Node> y, std::shared_ptr<Node> z) {
+        std::shared_ptr<NodeBase> hanger = z->parent_.lock();
+        bool left_child = hanger->left_ == z;
+        z->right_ = x->left_;
+        if (z->right_) {
+            z->right_->parent_ = z;
+        }
+        z->parent_ = x;
+        x->left_ = z;
+        y->left_ = x->right_;
+        if (y->left_) {
+            y->left_->parent_ = y;
+        }
+        y->parent_ = x;
+        x->right_ = y;
+        SetHanger(x, hanger, left_child);
+    }
+
+    static void SetHanger(std::shared_ptr<Node> x, std::shared_ptr<NodeBase> hanger,
+                          bool left_child) {
+        x->parent_ = hanger;
+        if (left_child) {
+            hanger->left_ = x;
+        } else {
+            hanger->right_ = x;
+        }
+    }
 };
\ No newline at end of file
@@ -1,134 +1,173 @@
-#pragma once
-#include <exception>
-#include <initializer_list>
-#include <iostream>
-#include <memory>
-#include <optional>
-#include <queue>
-#include <set>
-
-template <class T>
-class ITree;
-
-template <class T>
-class StdlibSet : public ITree<T> {
-private:
-    typedef typename ITree<T>::ITreeItImpl BaseImpl;
-
-public:
-    StdlibSet() : set_() {
-    }
-
-    template <class InitIterator>
-    StdlibSet(InitIterator begin, InitIterator end) : set_(begin, end) {
-    }
-
-    StdlibSet(std::initializer_list<T> list) : set_(list) {
-    }
-
-    StdlibSet(const StdlibSet& other) : set_(other.set_) {
-    }
-
-    StdlibSet(StdlibSet&& other) noexcept : set_(other.set_) {
-    }
-
-    StdlibSet(std::shared_ptr<ITree<T>> other)
-        : StdlibSet(*dynamic_cast<StdlibSet<T>*>(other.get())) {
-    }
-
-    StdlibSet& operator=(const StdlibSet& other) {
-        set_ = other.set_;
-        return *this;
-    }
-
-    StdlibSet& operator=(StdlibSet&& other) noexcept {
-        set_ = std::move(other.set_);
-        return *this;
-    }
-
-    [[nodiscard]] size_t Size() const override {
-        return set_.size();
-    }
-
-    [[nodiscard]] bool Empty() const override {
-        return set_.empty();
-    }
-
-    std::shared_ptr<BaseImpl> Find(const T& value) const override {
-        return std::make_shared<StdlibSetItImpl>(set_.find(value));
-    }
-
-    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
-        return std::make_shared<StdlibSetItImpl>(set_.lower_bound(value));
-    }
-
-    void Insert(const T& value) override {
-        set_.insert(value);
-    }
-
-    void Erase(const T& value) override {
-        set_.erase(value);
-    }
-
-    void Clear() override {
-        set_.clear();
-    }
-
-private:
-    std::set<T> set_;
-
-    /* ---------------------------------------------------
-     * --------------ITERATOR IMPLEMENTATION--------------
-     * ---------------------------------------------------
-     */
-
-    class StdlibSetItImpl : public BaseImpl {
-    private:
-        typename std::set<T>::iterator it_;
-
-    public:
-        StdlibSetItImpl() = delete;
-
-        StdlibSetItImpl(const StdlibSetItImpl& other) : it_(other.it_) {
-        }
-
-        StdlibSetItImpl(typename std::set<T>::iterator other) : it_(other) {
-        }
-
-        std::shared_ptr<BaseImpl> Clone() const override {
-            return std::make_shared<StdlibSetItImpl>(*this);
-        }
-
-        void Increment() override {
-            ++it_;
-        }
-
-        void Decrement() override {
-            --it_;
-        }
-
-        const T Dereferencing() const override {
-            return *it_;
-        }
-
-        const T* Arrow() const override {
-            return &(*it_);
-        }
-
-        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
-            auto casted = std::dynamic_pointer_cast<StdlibSetItImpl>(other);
-            if (!casted) {
-                return false;
-            }
-            return it_ == casted->it_;
-        }
-    };
-
-    std::shared_ptr<BaseImpl> Begin() const override {
-        return std::make_shared<StdlibSetItImpl>(set_.begin());
-    }
-
-    std::shared_ptr<BaseImpl> End() const override {
-        return std::make_shared<StdlibSetItImpl>(set_.end());
-    }
+#pragma once
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <set>
+#include <vector>
+
+template <class T>
+class ITree;
+
+template <class T>
+class StdlibSet : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    StdlibSet() : set_() {
+    }
+
+    template <class InitIterator>
+    StdlibSet(InitIterator begin, InitIterator end) : set_(begin, end) {
+    }
+
+    StdlibSet(std::initializer_list<T> list) : set_(list) {
+    }
+
+    StdlibSet(const StdlibSet& other) : set_(other.set_) {
+    }
+
+    StdlibSet(StdlibSet&& other) noexcept : set_(other.set_) {
+    }
+
+    StdlibSet(std::shared_ptr<ITree<T>> other)
+        : StdlibSet(*dynamic_cast<StdlibSet<T>*>(other.get())) {
+    }
+
+    StdlibSet& operator=(const StdlibSet& other) {
+        set_ = other.set_;
+        return *this;
+    }
+
+    StdlibSet& operator=(StdlibSet&& other) noexcept {
+        set_ = std::move(other.set_);
+        return *this;
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return set_.size();
+    }
+
+    [[nodiscard]] bool Empty() const override {
+        return set_.empty();
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return std::make_shared<StdlibSetItImpl>(set_.find(value));
+    }
+
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return std::make_shared<StdlibSetItImpl>(set_.lower_bound(value));
+    }
+
+    void Insert(const T& value) override {
+        set_.insert(value);
+    }
+
+    void Erase(const T& value) override {
+        set_.erase(value);
+    }
+
+    void Clear() override {
+        set_.clear();
+    }
+
+    /**
+     * Sorted ranges are inserted into 'std::set' in linear time
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        set_ = std::set<T, std::less<>>(std::make_move_iterator(values.begin()),
+                                        std::make_move_iterator(values.end()));
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(std::make_shared<StdlibSetItImpl>(set_.find(key)));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(
+            std::make_shared<StdlibSetItImpl>(set_.lower_bound(key)));
+    }
+    template <class K>
+    void erase(const K& key) {
+        auto it = set_.find(key);
+        if (it != set_.end()) {
+            set_.erase(it);
+        }
+    }
+
+private:
+    /// 'std::less<>' is transparent, so lookups by keys other than T don't build a temporary T
+    std::set<T, std::less<>> set_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class StdlibSetItImpl : public BaseImpl {
+    private:
+        typename std::set<T, std::less<>>::iterator it_;
+
+    public:
+        StdlibSetItImpl() = delete;
+
+        StdlibSetItImpl(const StdlibSetItImpl& other) : it_(other.it_) {
+        }
+
+        StdlibSetItImpl(typename std::set<T, std::less<>>::iterator other) : it_(other) {
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<StdlibSetItImpl>(*this);
+        }
+
+        void Increment() override {
+            ++it_;
+        }
+
+        void Decrement() override {
+            --it_;
+        }
+
+        const T Dereferencing() const override {
+            return *it_;
+        }
+
+        const T* Arrow() const override {
+            return &(*it_);
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<StdlibSetItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<StdlibSetItImpl>(set_.begin());
+    }
+
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<StdlibSetItImpl>(set_.end());
+    }
 };
\ No newline at end of file
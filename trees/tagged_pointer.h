@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Raw pointer with a small tag kept in its low bits.
+ * Those bits are always zero for pointers to aligned objects,
+ * so tree nodes can keep their color or balance there for free.
+ * @tparam P Pointee type, may be incomplete at the point of declaration
+ * @tparam Bits Number of tag bits
+ */
+template <class P, unsigned Bits>
+class TaggedPointer {
+public:
+    /**
+     * @return Stored pointer without the tag
+     */
+    P* Get() const {
+        CheckAlignment();
+        return reinterpret_cast<P*>(bits_ & ~kTagMask);
+    }
+
+    /**
+     * Stores the pointer and keeps the tag
+     * @param pointer New pointer
+     */
+    void Set(P* pointer) {
+        CheckAlignment();
+        bits_ = reinterpret_cast<uintptr_t>(pointer) | (bits_ & kTagMask);
+    }
+
+    /**
+     * @return Stored tag
+     */
+    [[nodiscard]] unsigned Tag() const {
+        return static_cast<unsigned>(bits_ & kTagMask);
+    }
+
+    /**
+     * Stores the tag and keeps the pointer
+     * @param tag New tag, must fit into 'Bits' bits
+     */
+    void SetTag(unsigned tag) {
+        bits_ = (bits_ & ~kTagMask) | (static_cast<uintptr_t>(tag) & kTagMask);
+    }
+
+private:
+    static constexpr uintptr_t kTagMask = (static_cast<uintptr_t>(1) << Bits) - 1;
+
+    static void CheckAlignment() {
+        static_assert(alignof(P) >= (1u << Bits), "Pointee alignment leaves no room for the tag");
+    }
+
+    uintptr_t bits_ = 0;
+};
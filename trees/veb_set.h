@@ -0,0 +1,493 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+template <class T>
+class ITree;
+
+/**
+ * Value types with a bounded universe: integral types other than bool
+ */
+template <class T>
+struct IsVEBKey : std::bool_constant<std::is_integral_v<T> && !std::is_same_v<T, bool>> {};
+
+/**
+ * Node of a van Emde Boas tree over the universe [0, 2^Bits).
+ * Small universes are plain bitmaps, larger ones are split recursively.
+ */
+template <int Bits, bool IsBitmap = (Bits <= 8)>
+struct VEBNode;
+
+/**
+ * Bitmap for a universe of at most 256 keys
+ */
+template <int Bits>
+struct VEBNode<Bits, true> {
+    static constexpr int kWords = ((1 << Bits) + 63) / 64;
+
+    [[nodiscard]] bool Empty() const {
+        for (uint64_t word : words_) {
+            if (word) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool Contains(uint64_t key) const {
+        return words_[key / 64] >> (key % 64) & 1;
+    }
+
+    void Insert(uint64_t key) {
+        words_[key / 64] |= uint64_t(1) << (key % 64);
+    }
+
+    void Erase(uint64_t key) {
+        words_[key / 64] &= ~(uint64_t(1) << (key % 64));
+    }
+
+    /**
+     * @return Least key, the bitmap must not be empty
+     */
+    [[nodiscard]] uint64_t Min() const {
+        uint64_t result = 0;
+        LowerBound(0, result);
+        return result;
+    }
+
+    /**
+     * @return Greatest key, the bitmap must not be empty
+     */
+    [[nodiscard]] uint64_t Max() const {
+        for (int word = kWords - 1;; --word) {
+            if (words_[word]) {
+                return word * 64 + 63 - __builtin_clzll(words_[word]);
+            }
+        }
+    }
+
+    /**
+     * @param key Lookup key
+     * @param result Least key not less than the lookup key
+     * @return False if there is no such key
+     */
+    bool LowerBound(uint64_t key, uint64_t& result) const {
+        int word = static_cast<int>(key / 64);
+        uint64_t bits = words_[word] & (~uint64_t(0) << (key % 64));
+        while (!bits) {
+            if (++word == kWords) {
+                return false;
+            }
+            bits = words_[word];
+        }
+        result = word * 64 + __builtin_ctzll(bits);
+        return true;
+    }
+
+    /**
+     * @param key Lookup key
+     * @param result Greatest key less than the lookup key
+     * @return False if there is no such key
+     */
+    bool Predecessor(uint64_t key, uint64_t& result) const {
+        if (!key) {
+            return false;
+        }
+        --key;
+        int word = static_cast<int>(key / 64);
+        uint64_t bits = words_[word] & (~uint64_t(0) >> (63 - key % 64));
+        while (!bits) {
+            if (--word < 0) {
+                return false;
+            }
+            bits = words_[word];
+        }
+        result = word * 64 + 63 - __builtin_clzll(bits);
+        return true;
+    }
+
+    uint64_t words_[kWords]{};
+};
+
+/**
+ * Recursive node: the key is split into high and low halves, the low half goes
+ * to the cluster of the high half and the summary keeps high halves of non-empty clusters.
+ * The least key is stored only in the node itself, so an insertion into an empty cluster
+ * does not recurse and every operation makes a single recursive call of half the width.
+ * Clusters are hashed, so a sparse universe takes memory only for the keys in it.
+ */
+template <int Bits>
+struct VEBNode<Bits, false> {
+    static constexpr int kLowBits = Bits / 2;
+    static constexpr int kHighBits = Bits - kLowBits;
+    static constexpr uint64_t kLowMask = (uint64_t(1) << kLowBits) - 1;
+
+    using Cluster = VEBNode<kLowBits>;
+    using Summary = VEBNode<kHighBits>;
+
+    VEBNode() = default;
+    VEBNode(const VEBNode& other)
+        : empty_(other.empty_),
+          min_(other.min_),
+          max_(other.max_),
+          summary_(other.summary_ ? std::make_unique<Summary>(*other.summary_) : nullptr),
+          clusters_(other.clusters_) {
+    }
+    VEBNode(VEBNode&& other) noexcept = default;
+
+    [[nodiscard]] bool Empty() const {
+        return empty_;
+    }
+
+    [[nodiscard]] bool Contains(uint64_t key) const {
+        if (empty_) {
+            return false;
+        }
+        if (key == min_ || key == max_) {
+            return true;
+        }
+        auto cluster = clusters_.find(key >> kLowBits);
+        return cluster != clusters_.end() && cluster->second.Contains(key & kLowMask);
+    }
+
+    /**
+     * @param key Key absent from the node
+     */
+    void Insert(uint64_t key) {
+        if (empty_) {
+            empty_ = false;
+            min_ = max_ = key;
+            return;
+        }
+        if (key < min_) {
+            std::swap(key, min_);
+        }
+        if (key > max_) {
+            max_ = key;
+        }
+        auto [cluster, created] = clusters_.try_emplace(key >> kLowBits);
+        if (created) {
+            if (!summary_) {
+                summary_ = std::make_unique<Summary>();
+            }
+            summary_->Insert(key >> kLowBits);
+        }
+        cluster->second.Insert(key & kLowMask);
+    }
+
+    /**
+     * @param key Key present in the node
+     */
+    void Erase(uint64_t key) {
+        if (min_ == max_) {
+            empty_ = true;
+            return;
+        }
+        if (key == min_) {
+            // The least key of the clusters takes the place of the minimum
+            uint64_t high = summary_->Min();
+            key = high << kLowBits | clusters_.find(high)->second.Min();
+            min_ = key;
+        }
+        uint64_t high = key >> kLowBits;
+        auto cluster = clusters_.find(high);
+        cluster->second.Erase(key & kLowMask);
+        if (cluster->second.Empty()) {
+            clusters_.erase(cluster);
+            summary_->Erase(high);
+            if (summary_->Empty()) {
+                summary_ = nullptr;
+            }
+            if (key == max_) {
+                max_ = summary_ ? MaxOfCluster(summary_->Max()) : min_;
+            }
+        } else if (key == max_) {
+            max_ = high << kLowBits | cluster->second.Max();
+        }
+    }
+
+    [[nodiscard]] uint64_t Min() const {
+        return min_;
+    }
+
+    [[nodiscard]] uint64_t Max() const {
+        return max_;
+    }
+
+    /**
+     * @param key Lookup key
+     * @param result Least key not less than the lookup key
+     * @return False if there is no such key
+     */
+    bool LowerBound(uint64_t key, uint64_t& result) const {
+        if (empty_ || key > max_) {
+            return false;
+        }
+        if (key <= min_) {
+            result = min_;
+            return true;
+        }
+        uint64_t high = key >> kLowBits;
+        auto cluster = clusters_.find(high);
+        if (cluster != clusters_.end() && (key & kLowMask) <= cluster->second.Max()) {
+            cluster->second.LowerBound(key & kLowMask, result);
+            result |= high << kLowBits;
+            return true;
+        }
+        // The maximum is greater than the key, so it is in one of the next clusters
+        summary_->LowerBound(high + 1, high);
+        result = high << kLowBits | clusters_.find(high)->second.Min();
+        return true;
+    }
+
+    /**
+     * @param key Lookup key
+     * @param result Greatest key less than the lookup key
+     * @return False if there is no such key
+     */
+    bool Predecessor(uint64_t key, uint64_t& result) const {
+        if (empty_ || key <= min_) {
+            return false;
+        }
+        if (key > max_) {
+            result = max_;
+            return true;
+        }
+        uint64_t high = key >> kLowBits;
+        auto cluster = clusters_.find(high);
+        if (cluster != clusters_.end() && (key & kLowMask) > cluster->second.Min()) {
+            cluster->second.Predecessor(key & kLowMask, result);
+            result |= high << kLowBits;
+            return true;
+        }
+        if (summary_ && summary_->Predecessor(high, high)) {
+            result = MaxOfCluster(high);
+        } else {
+            result = min_;
+        }
+        return true;
+    }
+
+    [[nodiscard]] uint64_t MaxOfCluster(uint64_t high) const {
+        return high << kLowBits | clusters_.find(high)->second.Max();
+    }
+
+    bool empty_ = true;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+    /// High halves of non-empty clusters, nullptr if there are none
+    std::unique_ptr<Summary> summary_;
+    std::unordered_map<uint64_t, Cluster> clusters_;
+};
+
+/**
+ * Ordered set of integers on a van Emde Boas tree: find(), insert(), erase(), lower_bound()
+ * and iterator steps take O(log log U) for the universe U of all values of T.
+ * Signed values are mapped to the universe with the sign bit flipped, so the order is kept.
+ *
+ * Iterators keep the value they point to and the tree they belong to: a step is
+ * a successor or predecessor query, so erasing the value under an iterator does not hurt it.
+ */
+template <class T>
+class VEBSet : public ITree<T> {
+    static_assert(IsVEBKey<T>::value, "VEBSet supports only integral values");
+
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    static constexpr int kBits = 8 * sizeof(T);
+
+    using Node = VEBNode<kBits>;
+
+    VEBSet() {
+        root_ = std::make_shared<Node>();
+        size_ = 0;
+    }
+
+    template <class InitIterator>
+    VEBSet(InitIterator begin, InitIterator end) : VEBSet() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    VEBSet(std::initializer_list<T> list) : VEBSet() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    VEBSet(const VEBSet& other) {
+        root_ = std::make_shared<Node>(*other.root_);
+        size_ = other.size_;
+    }
+    VEBSet(VEBSet&& other) noexcept : VEBSet() {
+        std::swap(root_, other.root_);
+        std::swap(size_, other.size_);
+    }
+    VEBSet(std::shared_ptr<ITree<T>> other) : VEBSet(*dynamic_cast<VEBSet<T>*>(other.get())) {
+    }
+    VEBSet& operator=(const VEBSet& other) {
+        if (root_ == other.root_) {
+            return *this;
+        }
+        root_ = std::make_shared<Node>(*other.root_);
+        size_ = other.size_;
+        return *this;
+    }
+    VEBSet& operator=(VEBSet&& other) noexcept {
+        if (root_ == other.root_) {
+            return *this;
+        }
+        std::swap(root_, other.root_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~VEBSet() override = default;
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !size_;
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        if (!root_->Contains(ToKey(value))) {
+            return End();
+        }
+        return std::make_shared<VEBSetItImpl>(root_, value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        uint64_t key;
+        if (!root_->LowerBound(ToKey(value), key)) {
+            return End();
+        }
+        return std::make_shared<VEBSetItImpl>(root_, FromKey(key));
+    }
+
+    void Insert(const T& value) override {
+        uint64_t key = ToKey(value);
+        if (!root_->Contains(key)) {
+            root_->Insert(key);
+            ++size_;
+        }
+    }
+    void Erase(const T& value) override {
+        uint64_t key = ToKey(value);
+        if (root_->Contains(key)) {
+            root_->Erase(key);
+            --size_;
+        }
+    }
+
+    void Clear() override {
+        root_ = std::make_shared<Node>();
+        size_ = 0;
+    }
+
+private:
+    /// Iterators share the root, so they outlive Clear() and moves of the set
+    std::shared_ptr<Node> root_;
+    size_t size_;
+
+    /**
+     * @return Place of the value in the universe
+     */
+    static uint64_t ToKey(T value) {
+        using Unsigned = std::make_unsigned_t<T>;
+        auto key = static_cast<Unsigned>(value);
+        if constexpr (std::is_signed_v<T>) {
+            key ^= static_cast<Unsigned>(Unsigned(1) << (kBits - 1));
+        }
+        return key;
+    }
+
+    static T FromKey(uint64_t key) {
+        using Unsigned = std::make_unsigned_t<T>;
+        auto bits = static_cast<Unsigned>(key);
+        if constexpr (std::is_signed_v<T>) {
+            bits ^= static_cast<Unsigned>(Unsigned(1) << (kBits - 1));
+        }
+        return static_cast<T>(bits);
+    }
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class VEBSetItImpl : public BaseImpl {
+    public:
+        VEBSetItImpl() = delete;
+        /// Iterator to the end
+        explicit VEBSetItImpl(std::shared_ptr<Node> root) : root_(std::move(root)) {
+        }
+        VEBSetItImpl(std::shared_ptr<Node> root, T value)
+            : root_(std::move(root)), value_(value), is_end_(false) {
+        }
+        VEBSetItImpl(const VEBSetItImpl& other) = default;
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<VEBSetItImpl>(*this);
+        }
+        void Increment() override {
+            if (is_end_) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            uint64_t key = ToKey(value_);
+            is_end_ = key == ToKey(std::numeric_limits<T>::max()) ||
+                      !root_->LowerBound(key + 1, key);
+            value_ = is_end_ ? T() : FromKey(key);
+        }
+        void Decrement() override {
+            uint64_t key;
+            if (is_end_ ? root_->Empty() : !root_->Predecessor(ToKey(value_), key)) {
+                throw std::runtime_error("Index out of range while decreasing");
+            }
+            value_ = FromKey(is_end_ ? root_->Max() : key);
+            is_end_ = false;
+        }
+        const T Dereferencing() const override {
+            if (is_end_) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return value_;
+        }
+        const T* Arrow() const override {
+            if (is_end_) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return &value_;
+        }
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<VEBSetItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return root_ == casted->root_ && is_end_ == casted->is_end_ &&
+                   (is_end_ || value_ == casted->value_);
+        }
+
+    private:
+        std::shared_ptr<Node> root_;
+        T value_{};
+        bool is_end_ = true;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        if (root_->Empty()) {
+            return End();
+        }
+        return std::make_shared<VEBSetItImpl>(root_, FromKey(root_->Min()));
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<VEBSetItImpl>(root_);
+    }
+};
@@ -0,0 +1,705 @@
+#pragma once
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "tagged_pointer.h"
+
+template <class T>
+class ITree;
+
+template <class T>
+class WAVLTree : public ITree<T> {
+private:
+    typedef typename ITree<T>::ITreeItImpl BaseImpl;
+
+public:
+    struct Node;
+
+    /**
+     * Links of a node. The header of the tree is a bare NodeBase without a value:
+     * its left child is the root and it is the only node without a parent.
+     * Parent link is a raw pointer with the rank parity in its lowest bit: rank differences
+     * are always 1 or 2 (0 or 3 only while rebalancing), so the parity is enough to tell them apart
+     */
+    struct NodeBase {
+        NodeBase* Parent() const {
+            return parent_.Get();
+        }
+        void SetParent(NodeBase* parent) {
+            parent_.Set(parent);
+        }
+        /**
+         * @return Parity of the node rank, leaves have rank 0
+         */
+        bool Parity() const {
+            return parent_.Tag();
+        }
+        /**
+         * Changes the rank by one, up or down
+         */
+        void FlipParity() {
+            parent_.SetTag(!parent_.Tag());
+        }
+
+        std::shared_ptr<Node> left_;
+        std::shared_ptr<Node> right_;
+        TaggedPointer<NodeBase, 1> parent_;
+    };
+
+    struct Node : NodeBase {
+        explicit Node(const T& value) : value_(value) {
+        }
+
+        T value_;
+    };
+
+    WAVLTree() {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    template <class InitIterator>
+    WAVLTree(InitIterator begin, InitIterator end) : WAVLTree() {
+        for (InitIterator cur(begin); cur != end; ++cur) {
+            Insert(*cur);
+        }
+    }
+    WAVLTree(std::initializer_list<T> list) : WAVLTree() {
+        for (const T& value : list) {
+            Insert(value);
+        }
+    }
+
+    WAVLTree(const WAVLTree& other) : WAVLTree() {
+        for (const T& value : other) {
+            Insert(value);
+        }
+    }
+    WAVLTree(WAVLTree&& other) noexcept : WAVLTree() {
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+    }
+    WAVLTree(std::shared_ptr<ITree<T>> other) : WAVLTree(*dynamic_cast<WAVLTree<T>*>(other.get())) {
+    }
+    WAVLTree& operator=(const WAVLTree& other) {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        Clear();
+        for (const T& value : other) {
+            Insert(value);
+        }
+        return *this;
+    }
+    WAVLTree& operator=(WAVLTree&& other) noexcept {
+        if (end_ == other.end_) {
+            return *this;
+        }
+        std::swap(begin_, other.begin_);
+        std::swap(last_, other.last_);
+        std::swap(end_, other.end_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~WAVLTree() override {
+        begin_ = nullptr;
+        last_ = nullptr;
+        end_ = nullptr;
+        size_ = 0;
+    }
+
+    [[nodiscard]] size_t Size() const override {
+        return size_;
+    }
+    [[nodiscard]] bool Empty() const override {
+        return !static_cast<bool>(size_);
+    }
+
+    std::shared_ptr<BaseImpl> Find(const T& value) const override {
+        return FindImpl(value);
+    }
+    std::shared_ptr<BaseImpl> LowerBound(const T& value) const override {
+        return LowerBoundImpl(value);
+    }
+
+    void Insert(const T& value) override {
+        if (InsertImplementation(value)) {
+            ++size_;
+        }
+    }
+    void Erase(const T& value) override {
+        EraseImpl(value);
+    }
+
+    void Clear() override {
+        end_ = std::make_shared<NodeBase>();
+        begin_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    /**
+     * Builds a tree with minimal height in linear time, ranks are heights minus one
+     * @param values Strictly increasing values
+     */
+    void BuildFromSorted(std::vector<T> values) override {
+        Clear();
+        size_ = values.size();
+        end_->left_ = BuildBalanced(values, 0, size_, end_.get());
+        if (size_) {
+            for (begin_ = Root(); begin_->left_; begin_ = begin_->left_.get()) {
+            }
+            for (last_ = Root(); last_->right_; last_ = last_->right_.get()) {
+            }
+        }
+    }
+
+    void CheckWAVL() const {
+        if (Root()) {
+            CheckWAVLRecursive(Root());
+        }
+        NodeBase* node = end_.get();
+        while (node->left_) {
+            node = node->left_.get();
+        }
+        if (node != (begin_ ? begin_ : end_.get())) {
+            throw std::runtime_error("Begin is not the leftmost node");
+        }
+        CheckLast();
+    }
+
+    using ITree<T>::find;
+    using ITree<T>::lower_bound;
+    using ITree<T>::erase;
+
+    /**
+     * Heterogeneous versions of find(), lower_bound() and erase().
+     * @tparam K Key type comparable with T (e.g. 'std::string_view' for 'std::string')
+     * @param key Key to look for, no temporary T is built from it
+     */
+    template <class K>
+    typename ITree<T>::iterator find(const K& key) const {
+        return typename ITree<T>::iterator(FindImpl(key));
+    }
+    template <class K>
+    typename ITree<T>::iterator lower_bound(const K& key) const {
+        return typename ITree<T>::iterator(LowerBoundImpl(key));
+    }
+    template <class K>
+    void erase(const K& key) {
+        EraseImpl(key);
+    }
+
+private:
+    /// Leftmost node, nullptr if the tree is empty
+    Node* begin_;
+    /// Header of the tree: its left child is the root, so every node has a parent
+    std::shared_ptr<NodeBase> end_;
+    /// Rightmost node, nullptr if the tree is empty
+    Node* last_;
+    size_t size_;
+
+    /* ---------------------------------------------------
+     * --------------ITERATOR IMPLEMENTATION--------------
+     * ---------------------------------------------------
+     */
+
+    class WAVLTreeItImpl : public BaseImpl {
+    public:
+        WAVLTreeItImpl() = delete;
+        explicit WAVLTreeItImpl(NodeBase* pointer) : it_(pointer) {
+            Pin();
+        }
+        WAVLTreeItImpl(const WAVLTreeItImpl& other) : it_(other.it_), pin_(other.pin_) {
+        }
+
+        std::shared_ptr<BaseImpl> Clone() const override {
+            return std::make_shared<WAVLTreeItImpl>(*this);
+        }
+        void Increment() override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range while increasing");
+            }
+            if (it_->right_) {
+                it_ = it_->right_.get();
+                while (it_->left_) {
+                    it_ = it_->left_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent->right_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                it_ = parent;
+            }
+            Pin();
+        }
+        void Decrement() override {
+            if (it_->left_) {
+                it_ = it_->left_.get();
+                while (it_->right_) {
+                    it_ = it_->right_.get();
+                }
+            } else {
+                auto parent = it_->Parent();
+                while (parent && parent->left_.get() == it_) {
+                    it_ = parent;
+                    parent = it_->Parent();
+                }
+                if (parent) {
+                    it_ = parent;
+                } else {
+                    throw std::runtime_error("Index out of range while decreasing");
+                }
+            }
+            Pin();
+        }
+
+        const T Dereferencing() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator*");
+            }
+            return static_cast<Node*>(it_)->value_;
+        }
+        const T* Arrow() const override {
+            if (!it_->Parent()) {
+                throw std::runtime_error("Index out of range on operator->");
+            }
+            return& static_cast<Node*>(it_)->value_;
+        }
+
+        bool IsEqual(std::shared_ptr<BaseImpl> other) const override {
+            auto casted = std::dynamic_pointer_cast<WAVLTreeItImpl>(other);
+            if (!casted) {
+                return false;
+            }
+            return it_ == casted->it_;
+        }
+        NodeBase* GetPointer() const {
+            return it_;
+        }
+
+    private:
+        /**
+         * Takes shared ownership of the current node through the link of its parent,
+         * so that the node survives its erasure. Header is owned by the tree itself
+         */
+        void Pin() {
+            auto parent = it_->Parent();
+            if (!parent) {
+                pin_ = nullptr;
+            } else if (parent->left_.get() == it_) {
+                pin_ = parent->left_;
+            } else {
+                pin_ = parent->right_;
+            }
+        }
+
+        NodeBase* it_;
+        std::shared_ptr<Node> pin_;
+    };
+
+    std::shared_ptr<BaseImpl> Begin() const override {
+        return std::make_shared<WAVLTreeItImpl>(begin_ ? begin_ : end_.get());
+    }
+    std::shared_ptr<BaseImpl> End() const override {
+        return std::make_shared<WAVLTreeItImpl>(end_.get());
+    }
+
+    /* ---------------------------------------------------
+     * ----------------PRIVATE FUNCTIONS------------------
+     * ---------------------------------------------------
+     */
+
+    Node* Root() const {
+        return end_->left_.get();
+    }
+
+    /**
+     * @param node Node in the tree
+     * @return Link of the parent, which owns the node
+     */
+    static std::shared_ptr<Node>& Link(NodeBase* node) {
+        auto parent = node->Parent();
+        return parent->left_.get() == node ? parent->left_ : parent->right_;
+    }
+
+    /**
+     * Finds the first node not less than the key.
+     * Links are followed instead of copying pointers, so lookups do not touch reference counts
+     * @param key Lookup key
+     * @return Lower bound node, nullptr if there is none
+     */
+    template <class K>
+    Node* LowerBoundNode(const K& key) const {
+        Node* result = nullptr;
+        Node* node = Root();
+        while (node) {
+            if (node->value_ < key) {
+                node = node->right_.get();
+            } else {
+                result = node;
+                node = node->left_.get();
+            }
+        }
+        return result;
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> FindImpl(const K& key) const {
+        Node* node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return End();
+        }
+        return std::make_shared<WAVLTreeItImpl>(node);
+    }
+
+    template <class K>
+    std::shared_ptr<BaseImpl> LowerBoundImpl(const K& key) const {
+        Node* node = LowerBoundNode(key);
+        return std::make_shared<WAVLTreeItImpl>(node ? node : end_.get());
+    }
+
+    template <class K>
+    void EraseImpl(const K& key) {
+        Node* node = LowerBoundNode(key);
+        if (!node || key < node->value_) {
+            return;
+        }
+        // Keeps the node alive until it is unlinked
+        std::shared_ptr<Node> delete_node = Link(node);
+        if (node == last_) {
+            if (node == begin_) {
+                last_ = nullptr;
+            } else {
+                WAVLTreeItImpl prev(last_);
+                prev.Decrement();
+                last_ = static_cast<Node*>(prev.GetPointer());
+            }
+        }
+        if (node == begin_) {
+            WAVLTreeItImpl next(begin_);
+            next.Increment();
+            auto next_node = next.GetPointer();
+            begin_ = next_node == end_.get() ? nullptr : static_cast<Node*>(next_node);
+        }
+
+        EraseImplementation(delete_node.get());
+        --size_;
+    }
+
+    /**
+     * @return Rank of the subtree, which is restored from the ranks of its children and its parity
+     */
+    int CheckWAVLRecursive(const NodeBase* from) const {
+        int rank_left = -1, rank_right = -1;
+        if (from->left_) {
+            if (from->left_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            rank_left = CheckWAVLRecursive(from->left_.get());
+        }
+        if (from->right_) {
+            if (from->right_->Parent() != from) {
+                throw std::runtime_error("Wrong parent link");
+            }
+            rank_right = CheckWAVLRecursive(from->right_.get());
+        }
+        // Of the two ranks allowed by the higher child only one has the stored parity
+        int rank = std::max(rank_left, rank_right) + 1;
+        if ((rank & 1) != from->Parity()) {
+            ++rank;
+        }
+        if (rank - std::min(rank_left, rank_right) > 2) {
+            throw std::runtime_error("Rank difference is more than two");
+        }
+        if (!from->left_ && !from->right_ && rank != 0) {
+            throw std::runtime_error("Leaf rank is not zero");
+        }
+        return rank;
+    }
+
+    void CheckLast() const {
+        if (!size_) {
+            if (last_) {
+                throw std::runtime_error("Last is set in an empty tree");
+            }
+            return;
+        }
+        WAVLTreeItImpl prev(end_.get());
+        prev.Decrement();
+        if (prev.GetPointer() != last_) {
+            throw std::runtime_error("Last is not the node before end");
+        }
+    }
+
+    void LeftRotate(NodeBase* from) {
+        auto parent = from->Parent();
+        auto& link = Link(from);
+        auto right_node = from->right_;
+
+        from->right_ = right_node->left_;
+        if (from->right_) {
+            from->right_->SetParent(from);
+        }
+        right_node->left_ = std::move(link);
+        from->SetParent(right_node.get());
+        right_node->SetParent(parent);
+        link = std::move(right_node);
+    }
+    void RightRotate(NodeBase* from) {
+        auto parent = from->Parent();
+        auto& link = Link(from);
+        auto left_node = from->left_;
+
+        from->left_ = left_node->right_;
+        if (from->left_) {
+            from->left_->SetParent(from);
+        }
+        left_node->right_ = std::move(link);
+        from->SetParent(left_node.get());
+        left_node->SetParent(parent);
+        link = std::move(left_node);
+    }
+
+    /**
+     * @return Rank parity of the node, missing nodes have rank -1
+     */
+    static bool Parity(const NodeBase* node) {
+        return node ? node->Parity() : true;
+    }
+
+    /**
+     * Tells 2-children from 1-children, valid while the difference is known to be 1 or 2
+     * @return True if the rank of the parent is greater by two
+     */
+    static bool IsTwoChild(const NodeBase* node, const NodeBase* parent) {
+        return Parity(node) == parent->Parity();
+    }
+
+    /**
+     * Restores rank rule after the insertion: promotes nodes while the child has the rank
+     * of its parent, then does at most two rotations
+     * @param node Inserted leaf
+     */
+    void RebalanceAfterInsert(NodeBase* node) {
+        auto parent = node->Parent();
+        // Rank difference is 0 or 1 here, so equal parities mean a 0-child
+        while (parent != end_.get() && node->Parity() == parent->Parity()) {
+            bool left = parent->left_.get() == node;
+            NodeBase* sibling = left ? parent->right_.get() : parent->left_.get();
+            if (!IsTwoChild(sibling, parent)) {
+                parent->FlipParity();
+                node = parent;
+                parent = node->Parent();
+                continue;
+            }
+            NodeBase* inner = left ? node->right_.get() : node->left_.get();
+            if (IsTwoChild(inner, node)) {
+                left ? RightRotate(parent) : LeftRotate(parent);
+                parent->FlipParity();
+            } else {
+                left ? LeftRotate(node) : RightRotate(node);
+                left ? RightRotate(parent) : LeftRotate(parent);
+                inner->FlipParity();
+                node->FlipParity();
+                parent->FlipParity();
+            }
+            return;
+        }
+    }
+
+    /**
+     * Restores rank rule after the removal: demotes nodes while there is a 3-child
+     * or a leaf of rank 1, then does at most two rotations
+     * @param parent Node, which lost a child
+     * @param left True if the left child of the parent became lower
+     * @param three True if that child is a 3-child now, false if it is a 2-child
+     */
+    void RebalanceAfterErase(NodeBase* parent, bool left, bool three) {
+        while (parent != end_.get()) {
+            if (!three) {
+                // Only a leaf of rank 1 may have two 2-children
+                if (parent->left_ || parent->right_) {
+                    return;
+                }
+            } else {
+                NodeBase* sibling = left ? parent->right_.get() : parent->left_.get();
+                if (!IsTwoChild(sibling, parent)) {
+                    NodeBase* inner = left ? sibling->left_.get() : sibling->right_.get();
+                    NodeBase* outer = left ? sibling->right_.get() : sibling->left_.get();
+                    if (!IsTwoChild(outer, sibling)) {
+                        left ? LeftRotate(parent) : RightRotate(parent);
+                        sibling->FlipParity();
+                        // Parent is demoted once or, if it became a leaf, twice
+                        if (parent->left_ || parent->right_) {
+                            parent->FlipParity();
+                        }
+                        return;
+                    }
+                    if (!IsTwoChild(inner, sibling)) {
+                        // Inner child is promoted twice and parent is demoted twice
+                        left ? RightRotate(sibling) : LeftRotate(sibling);
+                        left ? LeftRotate(parent) : RightRotate(parent);
+                        sibling->FlipParity();
+                        return;
+                    }
+                    sibling->FlipParity();
+                }
+            }
+            auto grandparent = parent->Parent();
+            three = grandparent != end_.get() && IsTwoChild(parent, grandparent);
+            parent->FlipParity();
+            left = grandparent->left_.get() == parent;
+            parent = grandparent;
+        }
+    }
+
+    /**
+     * Finds a node to hang the new value on. Values less than the minimum or greater than
+     * the maximum go next to 'begin_' or 'last_' without descending from the root
+     * @param value Value to insert
+     * @param left Used to return the side of the new node
+     * @return Parent for the new node, nullptr if the value is already in the tree
+     */
+    NodeBase* FindParentForInsert(const T& value, bool& left) const {
+        left = true;
+        if (begin_ && value < begin_->value_) {
+            return begin_;
+        }
+        if (last_ && last_->value_ < value) {
+            left = false;
+            return last_;
+        }
+        NodeBase* parent = end_.get();
+        Node* cur_node = Root();
+        while (cur_node) {
+            parent = cur_node;
+            if (value < cur_node->value_) {
+                left = true;
+                cur_node = cur_node->left_.get();
+            } else if (cur_node->value_ < value) {
+                left = false;
+                cur_node = cur_node->right_.get();
+            } else {
+                return nullptr;
+            }
+        }
+        return parent;
+    }
+
+    /**
+     * @param values Values in order
+     * @param begin First value of the range
+     * @param end Value after the last one of the range
+     * @param parent Parent for the root of the range
+     * @return Root of a tree made of the range, sibling subtrees differ in size by at most one
+     */
+    static std::shared_ptr<Node> BuildBalanced(const std::vector<T>& values, size_t begin,
+                                               size_t end, NodeBase* parent) {
+        if (begin == end) {
+            return nullptr;
+        }
+        size_t middle = begin + (end - begin) / 2;
+        auto node = std::make_shared<Node>(values[middle]);
+        node->SetParent(parent);
+        // New nodes have the even rank 0
+        if ((HeightOfBalanced(end - begin) - 1) % 2) {
+            node->FlipParity();
+        }
+        node->left_ = BuildBalanced(values, begin, middle, node.get());
+        node->right_ = BuildBalanced(values, middle + 1, end, node.get());
+        return node;
+    }
+
+    /**
+     * @param size Number of nodes in a tree built by BuildBalanced()
+     * @return Height of the tree, which is the bit width of its size
+     */
+    static int HeightOfBalanced(size_t size) {
+        return size ? 64 - __builtin_clzll(size) : 0;
+    }
+
+    bool InsertImplementation(const T& value) {
+        bool left;
+        NodeBase* parent = FindParentForInsert(value, left);
+        if (!parent) {
+            return false;
+        }
+
+        auto& link = left ? parent->left_ : parent->right_;
+        link = std::make_shared<Node>(value);
+        link->SetParent(parent);
+        if (!begin_ || value < begin_->value_) {
+            begin_ = link.get();
+        }
+        if (!last_ || last_->value_ < value) {
+            last_ = link.get();
+        }
+        RebalanceAfterInsert(link.get());
+        return true;
+    }
+
+    /**
+     * Unlinks the node from the tree. Erased node keeps its own links,
+     * so that iterators pointing to it can still move forward
+     * @param delete_node Node to erase
+     */
+    void EraseImplementation(NodeBase* delete_node) {
+        if (!delete_node->left_ || !delete_node->right_) {
+            auto parent = delete_node->Parent();
+            bool left = parent->left_.get() == delete_node;
+            // Removed node has rank 0 or 1 and its only child has rank one less
+            bool three = IsTwoChild(delete_node, parent);
+            Transplant(delete_node, delete_node->left_ ? delete_node->left_ : delete_node->right_);
+            RebalanceAfterErase(parent, left, three);
+            return;
+        }
+        // Successor takes the place and the rank of the deleted node
+        auto swap_node = delete_node->right_;
+        while (swap_node->left_) {
+            swap_node = swap_node->left_;
+        }
+        NodeBase* parent;
+        bool left;
+        bool three = IsTwoChild(swap_node.get(), swap_node->Parent());
+        if (swap_node->Parent() == delete_node) {
+            parent = swap_node.get();
+            left = false;
+        } else {
+            parent = swap_node->Parent();
+            left = true;
+            Transplant(swap_node.get(), swap_node->right_);
+            swap_node->right_ = delete_node->right_;
+            swap_node->right_->SetParent(swap_node.get());
+        }
+        swap_node->left_ = delete_node->left_;
+        swap_node->left_->SetParent(swap_node.get());
+        if (swap_node->Parity() != delete_node->Parity()) {
+            swap_node->FlipParity();
+        }
+        Transplant(delete_node, swap_node);
+        RebalanceAfterErase(parent, left, three);
+    }
+
+    /**
+     * Hangs the subtree on the place of the node, the node itself is left as is
+     * @param node Node to replace
+     * @param subtree Subtree to hang, may be empty
+     */
+    void Transplant(NodeBase* node, std::shared_ptr<Node> subtree) {
+        auto parent = node->Parent();
+        if (subtree) {
+            subtree->SetParent(parent);
+        }
+        Link(node) = std::move(subtree);
+    }
+};